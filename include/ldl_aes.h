@@ -35,6 +35,10 @@
  * and no effort has been made to ensure they are hardened against
  * attacks.
  *
+ * The AES implementation is selected by #LDL_AES_BACKEND. If
+ * LDL_AES_BACKEND_PLATFORM is selected the integrator must provide
+ * LDL_AES_init() and LDL_AES_encrypt().
+ *
  * @{
  * */
 
@@ -42,13 +46,32 @@
 extern "C" {
 #endif
 
+#include "ldl_platform.h"
 #include <stdint.h>
+#include <stdbool.h>
 
-/** AES state */
+/** AES state
+ *
+ * Only AES-128 is supported so the expanded key schedule is
+ * 11 round keys of 16 bytes.
+ *
+ * The layout depends on #LDL_AES_BACKEND. A platform backend
+ * can use the word aligned storage however it likes.
+ *
+ * */
 struct ldl_aes_ctx {
 
-    uint8_t k[240U];
+#if (LDL_AES_BACKEND == LDL_AES_BACKEND_COMPACT)
+    uint8_t k[176U];
     uint8_t r;
+#else
+    uint32_t k[44U];
+#endif
+
+#ifdef LDL_ENABLE_AESNI
+    /* k was expanded by the AES-NI backend (so encrypt with it too) */
+    bool aesni;
+#endif
 };
 
 /** Initialise AES block cipher
@@ -39,10 +39,23 @@ extern "C" {
 
 struct ldl_aes_ctx;
 
+/** CMAC subkeys
+ *
+ * These depend only on the key so they can be computed once with
+ * LDL_CMAC_initSubkeys() and reused for every MAC.
+ *
+ * */
+struct ldl_cmac_subkeys {
+
+    uint8_t k1[16U];
+    uint8_t k2[16U];
+};
+
 /** CMAC state */
 struct ldl_cmac_ctx {
 
     const struct ldl_aes_ctx *aes_ctx;
+    const struct ldl_cmac_subkeys *subkeys;
     uint8_t m[16U];
     uint8_t x[16U];
     uint8_t size;
@@ -56,6 +69,23 @@ struct ldl_cmac_ctx {
  * */
 void LDL_CMAC_init(struct ldl_cmac_ctx *ctx, const struct ldl_aes_ctx *aes_ctx);
 
+/** Initialise CMAC state with precomputed subkeys
+ *
+ * @param[in] ctx
+ * @param[in] aes_ctx block cipher state
+ * @param[in] subkeys from LDL_CMAC_initSubkeys() (must remain valid until LDL_CMAC_finish())
+ *
+ * */
+void LDL_CMAC_initWithSubkeys(struct ldl_cmac_ctx *ctx, const struct ldl_aes_ctx *aes_ctx, const struct ldl_cmac_subkeys *subkeys);
+
+/** Compute CMAC subkeys
+ *
+ * @param[out] subkeys
+ * @param[in] aes_ctx block cipher state
+ *
+ * */
+void LDL_CMAC_initSubkeys(struct ldl_cmac_subkeys *subkeys, const struct ldl_aes_ctx *aes_ctx);
+
 /** Update CMAC state
  *
  * @param[in] ctx
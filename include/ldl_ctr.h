@@ -47,7 +47,32 @@ struct ldl_aes_ctx;
  * @param[in] len   size of input
  *
  * */
-void LDL_CTR_encrypt(struct ldl_aes_ctx *ctx, const void *iv, const void *in, void *out, uint8_t len);
+void LDL_CTR_encrypt(const struct ldl_aes_ctx *ctx, const void *iv, const void *in, void *out, uint8_t len);
+
+/** Size of keystream buffer needed to encrypt len bytes */
+#define LDL_CTR_KEYSTREAM_SIZE(len) ((((len) + 15U) / 16U) * 16U)
+
+/** Generate counter mode keystream for all blocks in one call
+ *
+ * The keystream can be generated ahead of time and applied with
+ * LDL_CTR_xor() once the data is available.
+ *
+ * @param[in] ctx   #ldl_aes_ctx
+ * @param[in] iv    16 byte initial value
+ * @param[out] ks   keystream buffer of at least LDL_CTR_KEYSTREAM_SIZE(len) bytes
+ * @param[in] len   number of bytes the keystream will be applied to
+ *
+ * */
+void LDL_CTR_keystream(const struct ldl_aes_ctx *ctx, const void *iv, void *ks, uint8_t len);
+
+/** XOR keystream into data (i.e. encrypt or decrypt in place)
+ *
+ * @param[in,out] data  buffer to encrypt (any alignment)
+ * @param[in] ks        keystream from LDL_CTR_keystream()
+ * @param[in] len       size of data
+ *
+ * */
+void LDL_CTR_xor(void *data, const void *ks, uint8_t len);
 
 #ifdef __cplusplus
 }
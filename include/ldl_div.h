@@ -0,0 +1,121 @@
+/* Copyright (c) 2019-2020 Cameron Harper
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * */
+
+#ifndef LDL_DIV_H
+#define LDL_DIV_H
+
+/** @file
+ *
+ * Division of a uint32_t by an invariant divisor without a divide
+ * instruction.
+ *
+ * A reciprocal of the divisor is calculated once and then each
+ * division is a 32x32->64 bit multiply, an add, and two shifts. The result is
+ * exact for every dividend.
+ *
+ * This follows Granlund and Montgomery, "Division by Invariant
+ * Integers using Multiplication" (1994), figure 4.1.
+ *
+ * */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+struct ldl_div {
+
+    uint32_t m;     /* reciprocal */
+    uint8_t sh1;    /* min(l, 1) */
+    uint8_t sh2;    /* max(l - 1, 0) */
+};
+
+/* ceil(log2(D)) for a constant D (where D > 0) */
+#define LDL_DIV_LOG2_CEIL(D) ( \
+    ((D) > 0x80000000UL) ? 32U : \
+    ((D) > 0x40000000UL) ? 31U : \
+    ((D) > 0x20000000UL) ? 30U : \
+    ((D) > 0x10000000UL) ? 29U : \
+    ((D) > 0x08000000UL) ? 28U : \
+    ((D) > 0x04000000UL) ? 27U : \
+    ((D) > 0x02000000UL) ? 26U : \
+    ((D) > 0x01000000UL) ? 25U : \
+    ((D) > 0x00800000UL) ? 24U : \
+    ((D) > 0x00400000UL) ? 23U : \
+    ((D) > 0x00200000UL) ? 22U : \
+    ((D) > 0x00100000UL) ? 21U : \
+    ((D) > 0x00080000UL) ? 20U : \
+    ((D) > 0x00040000UL) ? 19U : \
+    ((D) > 0x00020000UL) ? 18U : \
+    ((D) > 0x00010000UL) ? 17U : \
+    ((D) > 0x00008000UL) ? 16U : \
+    ((D) > 0x00004000UL) ? 15U : \
+    ((D) > 0x00002000UL) ? 14U : \
+    ((D) > 0x00001000UL) ? 13U : \
+    ((D) > 0x00000800UL) ? 12U : \
+    ((D) > 0x00000400UL) ? 11U : \
+    ((D) > 0x00000200UL) ? 10U : \
+    ((D) > 0x00000100UL) ? 9U : \
+    ((D) > 0x00000080UL) ? 8U : \
+    ((D) > 0x00000040UL) ? 7U : \
+    ((D) > 0x00000020UL) ? 6U : \
+    ((D) > 0x00000010UL) ? 5U : \
+    ((D) > 0x00000008UL) ? 4U : \
+    ((D) > 0x00000004UL) ? 3U : \
+    ((D) > 0x00000002UL) ? 2U : \
+    ((D) > 0x00000001UL) ? 1U : \
+    0U)
+
+/** Initialiser for a constant divisor (evaluated at compile time)
+ *
+ * @param[in] D divisor (> 0)
+ *
+ * */
+#define LDL_DIV_INIT(D) { \
+    .m = (uint32_t)((((uint64_t)1U << 32) * (((uint64_t)1U << LDL_DIV_LOG2_CEIL(D)) - (uint64_t)(D))) / (uint64_t)(D)) + 1U, \
+    .sh1 = (LDL_DIV_LOG2_CEIL(D) > 0U) ? 1U : 0U, \
+    .sh2 = (LDL_DIV_LOG2_CEIL(D) > 0U) ? (LDL_DIV_LOG2_CEIL(D) - 1U) : 0U \
+}
+
+/** Calculate the reciprocal of a divisor at run time
+ *
+ * @param[in] self  #ldl_div
+ * @param[in] d     divisor (> 0)
+ *
+ * */
+void LDL_DIV_init(struct ldl_div *self, uint32_t d);
+
+/** Divide
+ *
+ * @param[in] self  #ldl_div
+ * @param[in] n     dividend
+ *
+ * @return n / d
+ *
+ * */
+uint32_t LDL_DIV_divide(const struct ldl_div *self, uint32_t n);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
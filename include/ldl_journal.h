@@ -0,0 +1,162 @@
+/* Copyright (c) 2019-2020 Cameron Harper
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * */
+
+#ifndef LDL_JOURNAL_H
+#define LDL_JOURNAL_H
+
+/** @file */
+
+/**
+ * @defgroup ldl_journal Session Journal
+ *
+ * Reference store for #ldl_mac_session on byte programmable NOR flash.
+ *
+ * The journal uses two pages of flash. Each #LDL_MAC_SESSION_UPDATED
+ * event appends only the changed fields to the active page. When
+ * the active page is full the current session is written to the
+ * other page which then becomes active. Pages are only erased
+ * when they are about to be reused.
+ *
+ * LDL_Journal_restore() replays the active page at boot to rebuild
+ * the session for LDL_MAC_init().
+ *
+ * Example:
+ *
+ * @code{.c}
+ * static struct ldl_journal journal;
+ *
+ * static void app_handler(void *app, enum ldl_mac_response_type type, const union ldl_mac_response_arg *arg)
+ * {
+ *     if(type == LDL_MAC_SESSION_UPDATED){
+ *
+ *         LDL_Journal_update(&journal, arg->session_updated.session, arg->session_updated.changed);
+ *     }
+ * }
+ * @endcode
+ *
+ * @{
+ * */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "ldl_mac.h"
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/** Flash interface used by #ldl_journal
+ *
+ * Addresses are relative to the start of the first page.
+ * Erased flash reads as 0xff.
+ *
+ * */
+struct ldl_journal_flash {
+
+    /** read size bytes from addr */
+    void (*read)(void *receiver, uint32_t addr, void *data, size_t size);
+
+    /** program size bytes at addr (they will have been erased) */
+    void (*write)(void *receiver, uint32_t addr, const void *data, size_t size);
+
+    /** erase the page that starts at addr */
+    void (*erase)(void *receiver, uint32_t addr);
+};
+
+/** Journal state */
+struct ldl_journal {
+
+    const struct ldl_journal_flash *flash;
+    void *receiver;
+
+    uint32_t pageSize;
+
+    /* sequence number of the active page */
+    uint32_t seq;
+
+    /* next free byte in the active page */
+    uint32_t pos;
+
+    /* active page (0 or 1) */
+    uint8_t page;
+
+    /* active page holds a complete session */
+    bool valid;
+};
+
+/** Passed to LDL_Journal_init() */
+struct ldl_journal_init_arg {
+
+    const struct ldl_journal_flash *flash;  /**< flash interface */
+    void *receiver;                         /**< passed to flash interface */
+
+    /** size of each of the two pages (must be an erasable unit)
+     *
+     * A page must hold at least one copy of every field in #ldl_mac_session
+     * which is less than 256 bytes. Larger pages mean fewer erases.
+     *
+     * */
+    uint32_t pageSize;
+};
+
+/** Initialise journal and find the active page
+ *
+ * The journal will not read or write flash if this fails.
+ *
+ * @param[in] self  #ldl_journal
+ * @param[in] arg   #ldl_journal_init_arg
+ *
+ * @retval true     initialised
+ * @retval false    ldl_journal_init_arg.pageSize cannot hold a session
+ *
+ * */
+bool LDL_Journal_init(struct ldl_journal *self, const struct ldl_journal_init_arg *arg);
+
+/** Replay the active page to rebuild the last saved session
+ *
+ * @param[in] self      #ldl_journal
+ * @param[out] session  #ldl_mac_session
+ *
+ * @retval true     session restored
+ * @retval false    nothing saved
+ *
+ * */
+bool LDL_Journal_restore(const struct ldl_journal *self, struct ldl_mac_session *session);
+
+/** Save the changed fields of a session
+ *
+ * Call from the #LDL_MAC_SESSION_UPDATED handler.
+ *
+ * @param[in] self      #ldl_journal
+ * @param[in] session   #ldl_mac_session
+ * @param[in] changed   changed fields (bit n is #ldl_mac_session_field n)
+ *
+ * */
+void LDL_Journal_update(struct ldl_journal *self, const struct ldl_mac_session *session, uint16_t changed);
+
+#ifdef __cplusplus
+}
+#endif
+
+/** @} */
+#endif
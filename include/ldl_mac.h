@@ -62,9 +62,12 @@ extern "C" {
 #include "ldl_mac_commands.h"
 #include "ldl_mac_internal.h"
 #include "ldl_system.h"
+#include "ldl_div.h"
+#include "ldl_frame.h"
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
 
 struct ldl_mac;
 struct ldl_sm;
@@ -133,7 +136,12 @@ enum ldl_mac_response_type {
 
     /** #ldl_mac_session has changed
      *
-     * The application can choose to save the session at this point
+     * The application can choose to save the session at this point.
+     *
+     * Only the fields flagged in #ldl_mac_response_arg.session_updated.changed
+     * are different from the last time this event was sent, so an
+     * application that stores the session in flash can write only
+     * those (see LDL_MAC_getSessionField()).
      *
      * */
     LDL_MAC_SESSION_UPDATED,
@@ -150,7 +158,8 @@ enum ldl_mac_sme {
     LDL_SME_TIMER_A,
     LDL_SME_TIMER_B,
     LDL_SME_INTERRUPT,
-    LDL_SME_BAND
+    LDL_SME_BAND,
+    LDL_SME_SM
 };
 
 /** MAC state */
@@ -178,7 +187,9 @@ enum ldl_mac_state {
     LDL_STATE_START_RADIO_FOR_RX2,     /**< waiting for second RX window */
     LDL_STATE_RX2,          /**< second RX window */
 
-    LDL_STATE_RX2_LOCKOUT  /**< used to ensure an out of range RX2 window is not clobbered */
+    LDL_STATE_RX2_LOCKOUT,  /**< used to ensure an out of range RX2 window is not clobbered */
+
+    LDL_STATE_WAIT_SM       /**< waiting for SM to complete a MIC (LDL_ENABLE_ASYNC_SM) */
 
 };
 
@@ -253,7 +264,8 @@ union ldl_mac_response_arg {
      * */
     struct {
 
-        const struct ldl_mac_session *session;
+        const struct ldl_mac_session *session;  /**< the whole session */
+        uint16_t changed;   /**< fields that changed (bit n is #ldl_mac_session_field n) */
 
     } session_updated;
 
@@ -325,17 +337,54 @@ struct ldl_timer {
     bool armed;
 };
 
+#ifdef LDL_ENABLE_ATOMIC_TIMERS
+/* two copies of the next deadline so that a reader never waits for
+ * the writer (seq & 1 selects the copy to read)
+ *
+ * plain storage so that this header can be included from C++,
+ * ldl_mac.c only ever accesses it as atomics */
+struct ldl_timer_latch {
+
+    unsigned seq;
+    uint32_t time[2U];
+    bool armed[2U];
+};
+#endif
+
+/* must be a power of two */
+#define LDL_INPUT_RING_SIZE 4U
+
+/* single producer (interrupt) single consumer (mainloop) ring */
 struct ldl_input {
 
-    bool armed;
-    bool state;
-    uint32_t time;
+    volatile bool armed;                            /* written by consumer */
+    volatile uint8_t head;                          /* written by producer */
+    volatile uint8_t tail;                          /* written by consumer */
+    volatile uint32_t time[LDL_INPUT_RING_SIZE];    /* written by producer */
 };
 
+#ifdef LDL_ENABLE_ASYNC_SM
+enum ldl_mac_sm_op {
+
+    LDL_SM_OP_TX,   /* MIC uplink in buffer */
+    LDL_SM_OP_RX    /* verify downlink in rx_buffer (or buffer) */
+};
+
+struct ldl_mac_sm_async {
+
+    enum ldl_mac_sm_op op;
+    uint8_t step;
+    uint8_t len;        /* size of downlink */
+    uint32_t delay;     /* ticks to wait before TX */
+    bool busy;                  /* SM has not answered */
+    volatile bool state;        /* SM has answered (set by producer, cleared by consumer) */
+    volatile uint32_t mic;      /* written by producer */
+};
+#endif
+
 struct ldl_mac_channel {
 
     uint32_t freqAndRate;
-    uint32_t dlFreq;
 };
 
 struct ldl_mac_time {
@@ -343,12 +392,63 @@ struct ldl_mac_time {
     uint32_t ticks;
     uint32_t remainder;
     bool parked;
+    bool changed;   /* band[] or day changed other than by counting down */
 };
 
+/* bits of ldl_mac_session.answers (the fields of pending MAC command answers) */
+enum ldl_mac_answer {
+
+    LDL_ANS_LINK_ADR_POWER,
+    LDL_ANS_LINK_ADR_RATE,
+    LDL_ANS_LINK_ADR_MASK,
+    LDL_ANS_RX_PARAM_RX1_DR_OFFSET,
+    LDL_ANS_RX_PARAM_RX2_RATE,
+    LDL_ANS_RX_PARAM_CHANNEL,
+    LDL_ANS_NEW_CHANNEL_RATE,
+    LDL_ANS_NEW_CHANNEL_FREQ,
+    LDL_ANS_DL_CHANNEL_UPLINK_FREQ,
+    LDL_ANS_DL_CHANNEL_FREQ,
+    LDL_ANS_REJOIN_PARAM_TIME
+};
+
+/** Fields of #ldl_mac_session that are reported as changed
+ *
+ * Each field is a contiguous range of bytes within #ldl_mac_session.
+ * Together they cover the whole structure.
+ *
+ * @see LDL_MAC_getSessionField()
+ *
+ * */
+enum ldl_mac_session_field {
+
+    LDL_SESSION_STATE,      /**< magic, joined, adr, version and region */
+    LDL_SESSION_UP,         /**< uplink counter */
+    LDL_SESSION_DOWN,       /**< downlink counters */
+    LDL_SESSION_NETWORK,    /**< devAddr and netID */
+    LDL_SESSION_RX2_FREQ,   /**< RX2 frequency */
+    LDL_SESSION_JOIN_NONCE, /**< joinNonce */
+    LDL_SESSION_CHANNELS,   /**< channel frequencies and rates */
+    LDL_SESSION_ADR_PARAM,  /**< ADRAckLimit and ADRAckDelay */
+    LDL_SESSION_DEV_NONCE,  /**< devNonce */
+    LDL_SESSION_PENDING,    /**< pending MAC command answers */
+    LDL_SESSION_CH_MASK,    /**< channel mask */
+    LDL_SESSION_TX,         /**< rate, power, maxDutyCycle and nbTrans */
+    LDL_SESSION_RX,         /**< RX1 rate offset, RX1 delay and RX2 rate */
+    LDL_SESSION_STATUS,     /**< DevStatusAns and TxParamSetup settings */
+    LDL_SESSION_UP_RESERVED,    /**< uplink counter is a reservation (#LDL_ENABLE_COUNTER_GAP) */
+    LDL_SESSION_FIELD_MAX
+};
+
+/** all #ldl_mac_session_field bits */
+#define LDL_SESSION_ALL ((1U << LDL_SESSION_FIELD_MAX) - 1U)
+
 /** Session cache */
 struct ldl_mac_session {
 
-    /* sanity check against accepting uninitialised memory as session */
+    /* sanity check against accepting uninitialised memory as session
+     *
+     * changed whenever the layout changes
+     * */
     uint8_t magic;
     bool joined;
     bool adr;
@@ -367,9 +467,17 @@ struct ldl_mac_session {
 
     uint32_t devAddr;
     uint32_t netID;
+    uint32_t rx2Freq;
+    uint32_t joinNonce;
 
     struct ldl_mac_channel chConfig[16U];
 
+    uint16_t adr_ack_limit;
+    uint16_t adr_ack_delay;
+    uint16_t devNonce;
+    uint16_t pending_cmds;
+    uint16_t answers;
+
     uint8_t chMask[72U / 8U];
     uint8_t rate;
     uint8_t power;
@@ -379,25 +487,18 @@ struct ldl_mac_session {
     uint8_t rx1Delay;
     uint8_t rx2DataRate;
 
-    uint32_t rx2Freq;
-
-    uint16_t adr_ack_limit;
-    uint16_t adr_ack_delay;
-
-    struct ldl_rx_param_setup_ans rx_param_setup_ans;
-    struct ldl_dl_channel_ans dl_channel_ans;
-    struct ldl_link_adr_ans link_adr_ans;
     struct ldl_dev_status_ans dev_status_ans;
-    struct ldl_new_channel_ans new_channel_ans;
-    struct ldl_rejoin_param_setup_ans rejoin_param_setup_ans;
-
-    uint32_t joinNonce;
-    uint16_t devNonce;
-    uint16_t pending_cmds;
 
 #ifndef LDL_DISABLE_TX_PARAM_SETUP
     uint8_t tx_param_setup;
 #endif
+
+    /* true when up was saved at the start of a reserved block
+     *
+     * present in every build so that a session saved with
+     * LDL_ENABLE_COUNTER_GAP can be restored without it
+     * */
+    bool upReserved;
 };
 
 struct ldl_mac_tx {
@@ -411,22 +512,83 @@ struct ldl_mac_tx {
 
 };
 
+/** Duty cycle state that can be kept across a reset
+ *
+ * Counters are the time remaining in 1/256 of a second.
+ *
+ * @see LDL_MAC_exportBands() LDL_MAC_importBands()
+ *
+ * */
+struct ldl_mac_band_state {
+
+    uint32_t band[LDL_BAND_MAX];    /**< off-time per band (the last is the global off-time) */
+    uint32_t day;                   /**< time left in the first day of joining */
+};
+
+/** Configuration that does not change after LDL_MAC_init()
+ *
+ * #ldl_mac keeps a copy of this unless #LDL_ENABLE_CONST_CONFIG
+ * is defined. In that case it keeps a pointer to an instance
+ * initialised by the application, which can be const and live in flash.
+ *
+ * The fields have the same meaning as the #ldl_mac_init_arg fields
+ * of the same name, except that none of the function pointers
+ * may be NULL.
+ *
+ * */
+struct ldl_mac_config {
+
+    void *app;                                      /**< #ldl_mac_init_arg.app */
+    ldl_mac_response_fn handler;                    /**< #ldl_mac_init_arg.handler */
+
+    ldl_system_rand_fn rand;                        /**< #ldl_mac_init_arg.rand */
+    ldl_system_ticks_fn ticks;                      /**< #ldl_mac_init_arg.ticks */
+    ldl_system_get_battery_level_fn get_battery_level;  /**< #ldl_mac_init_arg.get_battery_level */
+
+    struct ldl_radio *radio;                        /**< #ldl_mac_init_arg.radio */
+#ifndef LDL_FIXED_RADIO
+    const struct ldl_radio_interface *radio_interface;  /**< #ldl_mac_init_arg.radio_interface */
+#endif
+    struct ldl_sm *sm;                              /**< #ldl_mac_init_arg.sm */
+    const struct ldl_sm_interface *sm_interface;    /**< #ldl_mac_init_arg.sm_interface */
+
+#ifndef LDL_PARAM_TPS
+    uint32_t tps;                                   /**< #ldl_mac_init_arg.tps */
+#endif
+#ifndef LDL_PARAM_A
+    uint32_t a;                                     /**< #ldl_mac_init_arg.a */
+#endif
+#ifndef LDL_PARAM_B
+    uint32_t b;                                     /**< #ldl_mac_init_arg.b */
+#endif
+#ifndef LDL_PARAM_ADVANCE
+    uint32_t advance;                               /**< #ldl_mac_init_arg.advance */
+#endif
+#ifdef LDL_ENABLE_OTAA_DITHER
+    uint32_t otaaDither;                            /**< #ldl_mac_init_arg.otaaDither */
+#endif
+
+    uint8_t joinEUI[8U];                            /**< #ldl_mac_init_arg.joinEUI */
+    uint8_t devEUI[8U];                             /**< #ldl_mac_init_arg.devEUI */
+};
+
 /** MAC layer data */
 struct ldl_mac {
 
+    /* hot: used on (almost) every call to LDL_MAC_process() */
+
     enum ldl_mac_state state;
     enum ldl_mac_operation op;
 
-    bool pendingACK;
-
-    uint8_t joinEUI[8U];
-    uint8_t devEUI[8U];
-
-#ifdef LDL_ENABLE_STATIC_RX_BUFFER
-    uint8_t rx_buffer[LDL_MAX_PACKET];
+    struct ldl_input inputs;
+    struct ldl_timer timers[LDL_TIMER_MAX];
+#ifdef LDL_ENABLE_ATOMIC_TIMERS
+    struct ldl_timer_latch next;    /* earliest of timers[] */
+#else
+    struct ldl_timer next;  /* earliest of timers[] */
 #endif
-    uint8_t buffer[LDL_MAX_PACKET];
-    uint8_t bufferLen;
+
+    struct ldl_mac_time time;
 
     /* down-counters that use the 'time' timebase
      *
@@ -439,78 +601,97 @@ struct ldl_mac {
      * */
     uint32_t day;
 
-    /* 32bit to detect 16bit overflow */
-    uint32_t devNonce;
-    uint32_t joinNonce;
-
-    int16_t rx_snr;
-
     /* the settings currently being used to TX */
     struct ldl_mac_tx tx;
 
-    uint16_t rx1_symbols;
-    uint16_t rx2_symbols;
-
-    struct ldl_mac_session ctx;
+    /* half the extra symbol time for each window (ticks) */
+    uint32_t rx1_margin;
+    uint32_t rx2_margin;
 
-    struct ldl_sm *sm;
-    struct ldl_radio *radio;
-    struct ldl_input inputs;
-    struct ldl_timer timers[LDL_TIMER_MAX];
-
-    const struct ldl_sm_interface *sm_interface;
-    const struct ldl_radio_interface *radio_interface;
-
-    ldl_mac_response_fn handler;
-    void *app;
+    /* number of join/data trials */
+    uint32_t trials;
 
-    uint8_t adrAckCounter;
-    bool adrAckReq;
+#ifndef LDL_PARAM_TPS
+    struct ldl_div tpsDiv;
+#endif
 
-    struct ldl_mac_time time;
+#ifdef LDL_ENABLE_ASYNC_SM
+    struct ldl_mac_sm_async async;
+#endif
 
 #ifndef LDL_DISABLE_DEVICE_TIME
     /* used to provide precise time sync */
     uint32_t ticks_at_tx;
 #endif
 
-    /* number of join/data trials */
-    uint32_t trials;
+    /* 32bit to detect 16bit overflow */
+    uint32_t devNonce;
+    uint32_t joinNonce;
+
+    uint16_t rx1_symbols;
+    uint16_t rx2_symbols;
+
+    int16_t rx_snr;
 
     /* options and overrides applicable to current data service */
     struct ldl_mac_data_opts opts;
 
-    /* system interfaces */
-    ldl_system_rand_fn rand;
-    ldl_system_ticks_fn ticks;
-    ldl_system_get_battery_level_fn get_battery_level;
-
+    uint8_t adrAckCounter;
+    bool adrAckReq;
+    bool pendingACK;
     bool fPending;
 
-#ifndef LDL_PARAM_TPS
-    uint32_t tps;
-#endif
-#ifndef LDL_PARAM_A
-    uint32_t a;
-#endif
-#ifndef LDL_PARAM_B
-    uint32_t b;
+    uint8_t maxDutyCycle;
+
+#ifdef LDL_ENABLE_TEST_MODE
+    bool unlimitedDutyCycle;
 #endif
-#ifndef LDL_PARAM_ADVANCE
-    uint32_t advance;
+
+    uint8_t bufferLen;
+
+    /* channels that belong to each band (bit n is channel n)
+     *
+     * derived from ctx.chConfig and the region so it is
+     * rebuilt rather than saved with the session
+     * */
+    uint8_t chBand[LDL_BAND_GLOBAL][72U / 8U];
+
+    struct ldl_mac_session ctx;
+
+    /* ctx fields changed since the last LDL_MAC_SESSION_UPDATED
+     * (bit n is ldl_mac_session_field n) */
+    uint16_t changed;
+
+    /* cold: fixed at LDL_MAC_init() */
+
+#ifdef LDL_ENABLE_CONST_CONFIG
+    const struct ldl_mac_config *config;
+#else
+    struct ldl_mac_config config;
 #endif
 
-    uint8_t maxDutyCycle;
+    /* frame buffers */
 
-#ifdef LDL_ENABLE_OTAA_DITHER
-    uint32_t otaaDither;
+#if defined(LDL_ENABLE_STATIC_RX_BUFFER) && !defined(LDL_ENABLE_SINGLE_BUFFER)
+    uint8_t rx_buffer[LDL_MAX_PACKET];
 #endif
+    uint8_t buffer[LDL_MAX_PACKET];
 
-#ifdef LDL_ENABLE_TEST_MODE
-    bool unlimitedDutyCycle;
+#ifdef LDL_ENABLE_SINGLE_BUFFER
+    /* downlinks are received into buffer so the uplink
+     * is encoded again from these for each retransmission */
+    struct ldl_frame_data retry;
+    uint8_t retryMacs[30U];
 #endif
 };
 
+/* #ldl_mac_config in use by a #ldl_mac */
+#ifdef LDL_ENABLE_CONST_CONFIG
+    #define LDL_MAC_CONFIG(SELF) ((SELF)->config)
+#else
+    #define LDL_MAC_CONFIG(SELF) (&(SELF)->config)
+#endif
+
 /** Passed as an argument to LDL_MAC_init()
  *
  * */
@@ -522,7 +703,7 @@ struct ldl_mac_init_arg {
     /** pointer to initialised Radio */
     struct ldl_radio *radio;
 
-    /** pointer to Radio interfaces */
+    /** pointer to Radio interfaces (ignored if #LDL_FIXED_RADIO is defined) */
     const struct ldl_radio_interface *radio_interface;
 
     /** pointer to initialised Security Module */
@@ -628,6 +809,18 @@ struct ldl_mac_init_arg {
      * */
     uint32_t otaaDither;
 #endif
+
+#ifdef LDL_ENABLE_CONST_CONFIG
+    /** pointer to configuration that must remain valid for the life of #ldl_mac
+     *
+     * When #LDL_ENABLE_CONST_CONFIG is defined this is used
+     * instead of app, handler, rand, ticks, get_battery_level,
+     * radio, radio_interface, sm, sm_interface, tps, a, b, advance,
+     * otaaDither, joinEUI and devEUI.
+     *
+     * */
+    const struct ldl_mac_config *config;
+#endif
 };
 
 
@@ -660,6 +853,9 @@ struct ldl_mac_init_arg {
  * - ldl_mac_init_arg.rand
  * - ldl_mac_init_arg.get_battery_level
  *
+ * If #LDL_ENABLE_CONST_CONFIG is defined ldl_mac_init_arg.config
+ * is **MANDATORY** and replaces the configuration parameters above.
+ *
  * @param[in] self      #ldl_mac
  * @param[in] region    #ldl_region
  * @param[in] arg       #ldl_mac_init_arg
@@ -762,6 +958,9 @@ enum ldl_mac_status LDL_MAC_abp(struct ldl_mac *self, uint32_t devAddr);
  * An application encountering #LDL_STATUS_MACPRIORITY should try again
  * after the MAC commands have been sent.
  *
+ * If #LDL_ENABLE_SINGLE_BUFFER is defined data must remain valid until
+ * the operation completes since retransmissions are encoded from it.
+ *
  * @param[in] self  #ldl_mac
  * @param[in] port  lorawan port (must be >0)
  * @param[in] data  pointer to message to send
@@ -804,6 +1003,9 @@ enum ldl_mac_status LDL_MAC_unconfirmedData(struct ldl_mac *self, uint8_t port,
  * MAC commands are piggy-backed and prioritised the same as they are for
  * LDL_MAC_unconfirmedData().
  *
+ * If #LDL_ENABLE_SINGLE_BUFFER is defined data must remain valid until
+ * the operation completes since retransmissions are encoded from it.
+ *
  * @param[in] self  #ldl_mac
  * @param[in] port  lorawan port (must be >0)
  * @param[in] data  pointer to message to send
@@ -1021,12 +1223,16 @@ uint8_t LDL_MAC_getMaxDCycle(const struct ldl_mac *self);
  * This can be used by an application to ensure long-running tasks
  * do not cause LDL to miss important events.
  *
+ * Time sensitive events are radio operations in progress (including
+ * starting the radio for TX), and uplinks or RX windows which are
+ * scheduled to start within the interval.
+ *
  * @param[in] self      #ldl_mac
  * @param[in] interval  seconds
  *
  *
- * @retval true
- * @retval false
+ * @retval true     LDL needs to run within the interval
+ * @retval false    another task can run for the interval
  *
  * */
 bool LDL_MAC_priority(const struct ldl_mac *self, uint8_t interval);
@@ -1036,9 +1242,13 @@ bool LDL_MAC_priority(const struct ldl_mac *self, uint8_t interval);
  * Normally this will happen via the function pointer set as an
  * argument in LDL_Radio_setHandler().
  *
+ * Events are timestamped and queued without masking interrupts. Up
+ * to #LDL_INPUT_RING_SIZE events are kept per radio operation and the
+ * first is used to measure lag.
+ *
  * @param[in] self      #ldl_mac
  *
- * @note interrupt safe if LDL_SYSTEM_ENTER_CRITICAL() and LDL_SYSTEM_ENTER_CRITICAL() have been defined
+ * @note interrupt safe
  *
  * */
 void LDL_MAC_radioEvent(struct ldl_mac *self);
@@ -1051,11 +1261,25 @@ void LDL_MAC_radioEvent(struct ldl_mac *self);
  * @param[in] self      #ldl_mac
  * @param[in] ticks             timestamp from LDL_MAC_getTicks()
  *
- * @note interrupt safe if LDL_SYSTEM_ENTER_CRITICAL() and LDL_SYSTEM_ENTER_CRITICAL() have been defined
+ * @note interrupt safe
  *
  * */
 void LDL_MAC_radioEventWithTicks(struct ldl_mac *self, uint32_t ticks);
 
+#ifdef LDL_ENABLE_ASYNC_SM
+/** SM calls this function to pass the result of ldl_sm_interface.begin_mic to MAC
+ *
+ * This feature is only available when #LDL_ENABLE_ASYNC_SM is defined.
+ *
+ * @param[in] self      #ldl_mac
+ * @param[in] mic       result
+ *
+ * @note interrupt safe
+ *
+ * */
+void LDL_MAC_smEvent(struct ldl_mac *self, uint32_t mic);
+#endif
+
 /** Get current tick value
  *
  * @param[in] self  #ldl_mac
@@ -1107,6 +1331,64 @@ bool LDL_MAC_getFPending(const struct ldl_mac *self);
  * */
 bool LDL_MAC_getAckPending(const struct ldl_mac *self);
 
+/** Copy the duty cycle state
+ *
+ * Save this somewhere that survives a reset (e.g. after
+ * #LDL_MAC_DATA_COMPLETE) and pass it to LDL_MAC_importBands()
+ * after the reset.
+ *
+ * Counters are as of the last LDL_MAC_process() so they may
+ * overstate the time remaining but never understate it.
+ *
+ * @param[in] self #ldl_mac
+ * @param[out] state #ldl_mac_band_state
+ *
+ * */
+void LDL_MAC_exportBands(const struct ldl_mac *self, struct ldl_mac_band_state *state);
+
+/** Restore the duty cycle state saved by LDL_MAC_exportBands()
+ *
+ * Call after LDL_MAC_init() and before the first uplink or LDL_MAC_otaa().
+ * The imported state replaces the startup delay (#LDL_STARTUP_DELAY).
+ *
+ * Elapsed time is the wall time between export and import. It is
+ * subtracted from each counter so round it down.
+ *
+ * @param[in] self #ldl_mac
+ * @param[in] state #ldl_mac_band_state
+ * @param[in] elapsed seconds since state was exported
+ *
+ * */
+void LDL_MAC_importBands(struct ldl_mac *self, const struct ldl_mac_band_state *state, uint32_t elapsed);
+
+/** Find a #ldl_mac_session_field within #ldl_mac_session
+ *
+ * Used by applications that save only the changed fields
+ * of a session.
+ *
+ * @param[in] field #ldl_mac_session_field
+ * @param[out] offset offset of field in bytes
+ * @param[out] size size of field in bytes (may be zero)
+ *
+ * @retval true     field exists
+ * @retval false    field does not exist
+ *
+ * */
+bool LDL_MAC_getSessionField(enum ldl_mac_session_field field, size_t *offset, size_t *size);
+
+/** Push the exact frame counters with #LDL_MAC_SESSION_UPDATED
+ *
+ * With #LDL_ENABLE_COUNTER_GAP the saved uplink counter can be up to
+ * #LDL_COUNTER_GAP behind. Call this before a planned power down
+ * so that the restored session continues from the exact counter.
+ *
+ * The next uplink reserves a new block.
+ *
+ * @param[in] self #ldl_mac
+ *
+ * */
+void LDL_MAC_saveCounters(struct ldl_mac *self);
+
 #ifdef __cplusplus
 }
 #endif
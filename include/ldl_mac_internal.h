@@ -27,6 +27,7 @@
 #include <stdbool.h>
 
 struct ldl_mac;
+struct ldl_mac_tx;
 
 enum ldl_timer_inst {
 
@@ -44,10 +45,11 @@ bool LDL_MAC_addChannel(struct ldl_mac *self, uint8_t chIndex, uint32_t freq, ui
 void LDL_MAC_removeChannel(struct ldl_mac *self, uint8_t chIndex);
 bool LDL_MAC_maskChannel(struct ldl_mac *self, uint8_t chIndex);
 bool LDL_MAC_unmaskChannel(struct ldl_mac *self, uint8_t chIndex);
+bool LDL_MAC_selectChannel(const struct ldl_mac *self, uint8_t desired_rate, uint32_t limit, struct ldl_mac_tx *tx);
 
-void LDL_MAC_timerSet(struct ldl_mac *self, enum ldl_timer_inst timer, uint32_t timeout);
+void LDL_MAC_timerSet(struct ldl_mac *self, enum ldl_timer_inst timer, uint32_t now, uint32_t timeout);
 void LDL_MAC_timerAppend(struct ldl_mac *self, enum ldl_timer_inst timer, uint32_t timeout);
-bool LDL_MAC_timerCheck(struct ldl_mac *self, enum ldl_timer_inst timer, uint32_t *lag);
+bool LDL_MAC_timerCheck(struct ldl_mac *self, enum ldl_timer_inst timer, uint32_t now, uint32_t *lag);
 uint32_t LDL_MAC_timerTicksSince(struct ldl_mac *self, enum ldl_timer_inst timer);
 void LDL_MAC_timerClear(struct ldl_mac *self, enum ldl_timer_inst timer);
 uint32_t LDL_MAC_timerTicksUntilNext(const struct ldl_mac *self);
@@ -38,6 +38,8 @@
 #include <stdint.h>
 #include <stdbool.h>
 
+#include "ldl_platform.h"
+
 struct ldl_mac;
 struct ldl_frame_data;
 struct ldl_frame_down;
@@ -58,6 +60,38 @@ uint8_t LDL_OPS_prepareJoinRequest(struct ldl_mac *self, const struct ldl_frame_
 /* apply MIC to a data frame */
 void LDL_OPS_micDataFrame(struct ldl_mac *self, void *buffer, uint8_t size);
 
+/* update MIC of a data frame that was already MIC'd by LDL_OPS_micDataFrame()
+ * before it is retransmitted
+ *
+ * Only the 1.1 MIC depends on channel and rate, and then only the
+ * lower half, so this does nothing for 1.0.x.
+ *
+ * */
+void LDL_OPS_remicDataFrame(struct ldl_mac *self, void *buffer, uint8_t size);
+
+#ifdef LDL_ENABLE_ASYNC_SM
+/* asynchronous versions of LDL_OPS_micDataFrame() and LDL_OPS_remicDataFrame()
+ *
+ * Step 0 is micF (or the whole MIC for 1.0.x) and step 1 is micS. The
+ * begin function returns false if the step is not required. The result
+ * of each step is written into the frame by the finish function.
+ *
+ * LDL_OPS_micDataFrame() is step 0 then 1, LDL_OPS_remicDataFrame() is step 1.
+ *
+ * */
+bool LDL_OPS_beginMicDataFrame(struct ldl_mac *self, const void *buffer, uint8_t size, uint8_t step);
+void LDL_OPS_finishMicDataFrame(struct ldl_mac *self, void *buffer, uint8_t size, uint8_t step, uint32_t mic);
+
+/* asynchronous version of LDL_OPS_receiveFrame() for data frames
+ *
+ * Returns false if the MIC was not started, in which case LDL_OPS_receiveFrame()
+ * should be used. The finish function is called with the MIC returned by the SM.
+ *
+ * */
+bool LDL_OPS_beginReceiveFrame(struct ldl_mac *self, uint8_t *in, uint8_t len);
+bool LDL_OPS_finishReceiveFrame(struct ldl_mac *self, struct ldl_frame_down *f, uint8_t *in, uint8_t len, uint32_t mic);
+#endif
+
 /* derive expected 32 bit downcounter from 16 least significant bits and update the copy in ldl_mac */
 void LDL_OPS_syncDownCounter(struct ldl_mac *self, uint8_t port, uint16_t counter);
 
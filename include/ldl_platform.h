@@ -169,6 +169,152 @@
     #define LDL_ENABLE_STATIC_RX_BUFFER
     #undef LDL_ENABLE_STATIC_RX_BUFFER
 
+    /**
+     * Define to receive downlinks into the same buffer used for
+     * uplinks.
+     *
+     * This saves #LDL_MAX_PACKET bytes from the stack (or from mac state
+     * if #LDL_ENABLE_STATIC_RX_BUFFER is defined) at the cost of ~70
+     * bytes of mac state. Each retransmission is encrypted and MIC'd
+     * again from the frame fields kept in mac state.
+     *
+     * The application data passed to LDL_MAC_unconfirmedData() and
+     * LDL_MAC_confirmedData() must remain valid until the operation
+     * completes.
+     *
+     * */
+    #define LDL_ENABLE_SINGLE_BUFFER
+    #undef LDL_ENABLE_SINGLE_BUFFER
+
+    /**
+     * Define to have #ldl_mac point to an application owned
+     * #ldl_mac_config rather than keep a copy.
+     *
+     * The configuration can then be const and live in flash, saving
+     * about 64 bytes of RAM per #ldl_mac on a 32 bit target. See
+     * ldl_mac_init_arg.config.
+     *
+     * */
+    #define LDL_ENABLE_CONST_CONFIG
+    #undef LDL_ENABLE_CONST_CONFIG
+
+    /**
+     * Define to save the uplink frame counter once every
+     * #LDL_COUNTER_GAP uplinks instead of on every uplink.
+     *
+     * The MAC reserves a block of #LDL_COUNTER_GAP counter values and
+     * only flags #LDL_SESSION_UP in #LDL_MAC_SESSION_UPDATED when a new
+     * block is reserved. A session restored by LDL_MAC_init() skips the
+     * rest of the last reserved block so that a counter value is never
+     * reused after an unclean shutdown.
+     *
+     * Call LDL_MAC_saveCounters() before a planned power down to save
+     * the exact counter and avoid the skip.
+     *
+     * */
+    #define LDL_ENABLE_COUNTER_GAP
+    #undef LDL_ENABLE_COUNTER_GAP
+
+    /**
+     * Define to allow the MAC to wait for data frame MICs to be
+     * completed asynchronously by the security module.
+     *
+     * When ldl_sm_interface.begin_mic is not NULL the MAC will use
+     * it instead of ldl_sm_interface.mic and return from LDL_MAC_process()
+     * while the MIC is in progress. The SM signals completion by
+     * calling LDL_MAC_smEvent().
+     *
+     * Requires #LDL_ENABLE_STATIC_RX_BUFFER or #LDL_ENABLE_SINGLE_BUFFER
+     * so that downlinks can be kept while they are being verified.
+     *
+     * */
+    #define LDL_ENABLE_ASYNC_SM
+    #undef LDL_ENABLE_ASYNC_SM
+
+    /**
+     * Define to publish the next timer deadline using C11 atomics
+     * instead of LDL_SYSTEM_ENTER_CRITICAL().
+     *
+     * The timer API will not mask interrupts. The deadline read by
+     * LDL_MAC_ticksUntilNextEvent() is published in two copies under
+     * a sequence counter, so a reader in an interrupt never waits for
+     * the mainloop.
+     *
+     * Requires a C11 compiler with <stdatomic.h> for the LDL sources.
+     * The public headers do not use atomic types and can still be
+     * included from C++.
+     *
+     * */
+    #define LDL_ENABLE_ATOMIC_TIMERS
+    #undef LDL_ENABLE_ATOMIC_TIMERS
+
+    /**
+     * Define to build the MAC for exactly one region.
+     *
+     * e.g.
+     *
+     * @code
+     * #define LDL_FIXED_REGION LDL_EU_863_870
+     * @endcode
+     *
+     * Region lookups use this constant instead of the region
+     * saved in the session, and the region passed to LDL_MAC_init()
+     * must match. Only enable this region so that the tables for
+     * the other regions are left out of the build.
+     *
+     * */
+    #define LDL_FIXED_REGION
+    #undef LDL_FIXED_REGION
+
+    /**
+     * Define to call one radio driver directly rather than through
+     * ldl_mac_init_arg.radio_interface.
+     *
+     * e.g.
+     *
+     * @code
+     * #define LDL_FIXED_RADIO LDL_RADIO_SX1262
+     * @endcode
+     *
+     * ldl_mac_init_arg.radio_interface is ignored and
+     * ldl_mac_init_arg.radio must be of this type. Only the driver
+     * family (SX127X or SX126X) of this radio may be enabled.
+     *
+     * With link time optimisation the driver functions can then be
+     * inlined into the MAC.
+     *
+     * */
+    #define LDL_FIXED_RADIO
+    #undef LDL_FIXED_RADIO
+
+    /**
+     * Define to keep the expanded AES key schedule for each key
+     * in the default security module.
+     *
+     * Keys are expanded on first use and the result reused until the key
+     * is changed by LDL_SM_init() or a session key update. This saves
+     * a key expansion on every MIC, ECB, and CTR operation, and the
+     * CMAC subkey generation on every MIC, at the expense of about 210
+     * bytes of RAM per key.
+     *
+     * */
+    #define LDL_ENABLE_SM_KEY_CACHE
+    #undef LDL_ENABLE_SM_KEY_CACHE
+
+    /**
+     * Define to use AES-NI instructions on x86 targets.
+     *
+     * Support is detected at run time using CPUID. If the instructions
+     * are not available the implementation selected by
+     * #LDL_AES_BACKEND is used instead.
+     *
+     * This is intended for host builds (e.g. simulation) using GCC or
+     * clang.
+     *
+     * */
+    #define LDL_ENABLE_AESNI
+    #undef LDL_ENABLE_AESNI
+
     /**
      * Define to make use of PROGMEM if using avr-libc
      *
@@ -336,6 +482,22 @@
     #define LDL_STARTUP_DELAY 0
 #endif
 
+#ifndef LDL_COUNTER_GAP
+    /**
+     * Redefine to change the number of uplink frame counter values
+     * reserved at a time by #LDL_ENABLE_COUNTER_GAP.
+     *
+     * Larger values mean fewer writes to flash and a larger
+     * skip after an unclean shutdown.
+     *
+     * Builds without #LDL_ENABLE_COUNTER_GAP still use this to skip a
+     * reserved block when restoring a session saved with it, so keep
+     * it the same if the option is later removed.
+     *
+     * */
+    #define LDL_COUNTER_GAP 32
+#endif
+
 #ifndef LDL_PARAM_XTAL_DELAY
     /**
      * Define to change the fixed millisecond delay that is inserted
@@ -394,6 +556,58 @@
     #error "unrecognised LDL_L2_VERSION"
 #endif
 
+#define LDL_AES_BACKEND_COMPACT     1
+#define LDL_AES_BACKEND_TTABLE      2
+#define LDL_AES_BACKEND_PLATFORM    3
+
+#ifndef LDL_AES_BACKEND
+    /** Define to change the AES implementation used by the default
+     * cryptography functions.
+     *
+     * Must be one of:
+     *
+     * - **LDL_AES_BACKEND_COMPACT** byte oriented implementation with
+     *   a 256 byte S-box, suits 8 bit targets
+     * - **LDL_AES_BACKEND_TTABLE** 32 bit implementation with an
+     *   additional 1KB lookup table, suits Cortex-M3/M4 and host targets
+     * - **LDL_AES_BACKEND_PLATFORM** LDL_AES_init() and LDL_AES_encrypt()
+     *   are supplied by the integrator (e.g. to use a hardware peripheral)
+     *
+     * e.g.
+     *
+     * @code
+     * #define LDL_AES_BACKEND   LDL_AES_BACKEND_TTABLE
+     * @endcode
+     *
+     * */
+    #define LDL_AES_BACKEND LDL_AES_BACKEND_COMPACT
+#endif
+
+#if (LDL_AES_BACKEND != LDL_AES_BACKEND_COMPACT) && (LDL_AES_BACKEND != LDL_AES_BACKEND_TTABLE) && (LDL_AES_BACKEND != LDL_AES_BACKEND_PLATFORM)
+    #error "unrecognised LDL_AES_BACKEND"
+#endif
+
+#if defined(LDL_ENABLE_AESNI) && (LDL_AES_BACKEND == LDL_AES_BACKEND_PLATFORM)
+    #error "LDL_ENABLE_AESNI cannot be used with LDL_AES_BACKEND_PLATFORM"
+#endif
+
+#if defined(LDL_ENABLE_ASYNC_SM) && !defined(LDL_ENABLE_STATIC_RX_BUFFER) && !defined(LDL_ENABLE_SINGLE_BUFFER)
+    #error "LDL_ENABLE_ASYNC_SM requires LDL_ENABLE_STATIC_RX_BUFFER or LDL_ENABLE_SINGLE_BUFFER"
+#endif
+
+#if (LDL_COUNTER_GAP < 1)
+    #error "LDL_COUNTER_GAP must be at least 1"
+#endif
+
+/* C++ only sees the plain storage in ldl_mac.h */
+#if defined(LDL_ENABLE_ATOMIC_TIMERS) && !defined(__cplusplus) && (!defined(__STDC_VERSION__) || (__STDC_VERSION__ < 201112L) || defined(__STDC_NO_ATOMICS__))
+    #error "LDL_ENABLE_ATOMIC_TIMERS requires C11 atomics"
+#endif
+
+#if defined(LDL_FIXED_RADIO) && (defined(LDL_ENABLE_SX1272) || defined(LDL_ENABLE_SX1276)) && (defined(LDL_ENABLE_SX1261) || defined(LDL_ENABLE_SX1262) || defined(LDL_ENABLE_WL55))
+    #error "LDL_FIXED_RADIO requires only one radio driver family to be enabled"
+#endif
+
 #ifdef LDL_DISABLE_TX_PARAM_SETUP
     #if defined(LDL_ENABLE_AU_915_928)
         /* AU_915_928 region requires the tx param setup mac command */
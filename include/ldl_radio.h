@@ -383,6 +383,22 @@ int16_t LDL_Radio_getMinSNR(enum ldl_spreading_factor sf);
  * */
 uint32_t LDL_Radio_getAirTime(enum ldl_signal_bandwidth bw, enum ldl_spreading_factor sf, uint8_t size, bool crc);
 
+/** Time taken to transmit a message of certain size in ticks
+ *
+ * Unlike LDL_Radio_getAirTime() the result is rounded up to the
+ * next tick rather than overestimated by a millisecond.
+ *
+ * @param[in] bw
+ * @param[in] sf
+ * @param[in] size
+ * @param[in] crc
+ * @param[in] tps   ticks per second
+ *
+ * @retval ticks
+ *
+ * */
+uint32_t LDL_Radio_getAirTimeTicks(enum ldl_signal_bandwidth bw, enum ldl_spreading_factor sf, uint8_t size, bool crc, uint32_t tps);
+
 /** Convert bandwidth enumeration to Hz
  *
  * @param[in] bw bandwidth
@@ -34,6 +34,8 @@ extern "C" {
 
 #include "ldl_platform.h"
 #include "ldl_sm_internal.h"
+#include "ldl_aes.h"
+#include "ldl_cmac.h"
 
 #include <stdint.h>
 
@@ -44,12 +46,29 @@ struct ldl_key {
     uint8_t value[LDL_KEY_SIZE];
 };
 
-/** default in-memory security module state */
-struct ldl_sm {
 #if defined(LDL_ENABLE_L2_1_1)
-    struct ldl_key keys[8U];
+#define LDL_SM_NUM_KEYS 8U
 #else
-    struct ldl_key keys[3U];
+#define LDL_SM_NUM_KEYS 3U
+#endif
+
+/** default in-memory security module state */
+struct ldl_sm {
+
+    struct ldl_key keys[LDL_SM_NUM_KEYS];
+
+#ifdef LDL_ENABLE_SM_KEY_CACHE
+    /* expanded key schedule for each key in keys[] */
+    struct ldl_aes_ctx schedule[LDL_SM_NUM_KEYS];
+
+    /* CMAC subkeys for each key in keys[] */
+    struct ldl_cmac_subkeys subkeys[LDL_SM_NUM_KEYS];
+
+    /* bit n set means schedule[n] is valid */
+    uint8_t cached;
+
+    /* bit n set means subkeys[n] is valid */
+    uint8_t cachedSubkeys;
 #endif
 };
 
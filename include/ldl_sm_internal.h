@@ -58,12 +58,45 @@ enum ldl_sm_key {
     LDL_SM_KEY_NWK         /**< network root key */
 };
 
+/** A range of data to be CTR decrypted by #ldl_sm_interface.mic_decrypt */
+struct ldl_sm_range {
+
+    enum ldl_sm_key desc;   /**< key to decrypt with */
+    const void *iv;         /**< 16B block to be used as a nonce/initial value */
+    uint8_t offset;         /**< offset from start of data */
+    uint8_t len;            /**< length of range */
+};
+
+/** A session key to be derived by #ldl_sm_interface.update_session_keys */
+struct ldl_sm_derivation {
+
+    enum ldl_sm_key desc;   /**< key to update */
+    const void *iv;         /**< 16B of text used to derive key */
+};
+
 struct ldl_sm_interface {
 
     void (*update_session_key)(struct ldl_sm *self, enum ldl_sm_key key_desc, enum ldl_sm_key root_desc, const void *iv);
     uint32_t (*mic)(struct ldl_sm *self, enum ldl_sm_key desc, const void *hdr, uint8_t hdrLen, const void *data, uint8_t dataLen);
     void (*ecb)(struct ldl_sm *self, enum ldl_sm_key desc, void *b);
     void (*ctr)(struct ldl_sm *self, enum ldl_sm_key desc, const void *iv, void *data, uint8_t len);
+
+    /* optional (may be NULL), LDL falls back to update_session_key */
+    void (*update_session_keys)(struct ldl_sm *self, enum ldl_sm_key root_desc, const struct ldl_sm_derivation *keys, uint8_t numKeys);
+
+    /* optional (may be NULL), LDL falls back to mic and ctr */
+    bool (*mic_decrypt)(struct ldl_sm *self, enum ldl_sm_key desc, const void *hdr, uint8_t hdrLen, void *data, uint8_t dataLen, uint32_t mic, const struct ldl_sm_range *range, uint8_t numRanges);
+
+    /* optional (may be NULL), used instead of mic for data frames when
+     * LDL_ENABLE_ASYNC_SM is defined
+     *
+     * Starts the same operation as mic and returns immediately. The
+     * result is passed to LDL_MAC_smEvent() when it is ready. hdr is only
+     * valid for the duration of the call, data remains valid until
+     * LDL_MAC_smEvent() is called.
+     *
+     * */
+    void (*begin_mic)(struct ldl_sm *self, enum ldl_sm_key desc, const void *hdr, uint8_t hdrLen, const void *data, uint8_t dataLen);
 };
 
 /** MAC can use this interface to talk to the default SM implementation
@@ -98,6 +131,19 @@ const struct ldl_sm_interface *LDL_SM_getInterface(void);
  * */
 void LDL_SM_updateSessionKey(struct ldl_sm *self, enum ldl_sm_key keyDesc, enum ldl_sm_key rootDesc, const void *iv);
 
+/** Update several session keys from the same root key
+ *
+ * The same as calling LDL_SM_updateSessionKey() for each key except
+ * that the root key is only expanded once.
+ *
+ * @param[in] self
+ * @param[in] rootDesc  #ldl_sm_key the key to use as root key in derivation
+ * @param[in] keys      #ldl_sm_derivation
+ * @param[in] numKeys
+ *
+ * */
+void LDL_SM_updateSessionKeys(struct ldl_sm *self, enum ldl_sm_key rootDesc, const struct ldl_sm_derivation *keys, uint8_t numKeys);
+
 /** Lookup a key and use it to produce a MIC
  *
  * The MIC is the four least-significant bytes of an AES-128 CMAC digest of (hdr|data), intepreted
@@ -135,6 +181,31 @@ void LDL_SM_ecb(struct ldl_sm *self, enum ldl_sm_key desc, void *b);
  * */
 void LDL_SM_ctr(struct ldl_sm *self, enum ldl_sm_key desc, const void *iv, void *data, uint8_t len);
 
+/** Verify a MIC and, if it matches, CTR AES-128 decrypt ranges of data in-place
+ *
+ * The MIC is calculated over (hdr|data) as per LDL_SM_mic(). Ranges
+ * must be in ascending order, must not overlap, and must fit within data.
+ *
+ * This is the same as LDL_SM_mic() followed by LDL_SM_ctr() for
+ * each range, except that each key is only expanded once. A secure
+ * element can implement this as a single transaction.
+ *
+ * @param[in] self
+ * @param[in] desc      #ldl_sm_key used for the MIC
+ * @param[in] hdr       may be NULL
+ * @param[in] hdrLen
+ * @param[in] data
+ * @param[in] dataLen
+ * @param[in] mic       expected MIC
+ * @param[in] range     #ldl_sm_range (may be NULL if numRanges is 0)
+ * @param[in] numRanges
+ *
+ * @retval true     MIC matches and ranges have been decrypted
+ * @retval false    MIC does not match and data is unchanged
+ *
+ * */
+bool LDL_SM_micDecrypt(struct ldl_sm *self, enum ldl_sm_key desc, const void *hdr, uint8_t hdrLen, void *data, uint8_t dataLen, uint32_t mic, const struct ldl_sm_range *range, uint8_t numRanges);
+
 
 #ifdef __cplusplus
 }
@@ -37,12 +37,15 @@
  * - #ldl_mac_init_arg.get_battery_level
  *
  * In addition to function pointers, the following macros *MUST* be
- * defined if LDL_MAC_radioEvent(), LDL_MAC_radioEventWithTicks(), or LDL_MAC_ticksUntilNextEvent()
- * are called from an interrupt:
+ * defined if LDL_MAC_ticksUntilNextEvent() is called from an interrupt:
  *
  * - LDL_SYSTEM_ENTER_CRITICAL()
  * - LDL_SYSTEM_LEAVE_CRITICAL()
  *
+ * LDL_MAC_radioEvent(), LDL_MAC_radioEventWithTicks() and
+ * LDL_MAC_smEvent() do not mask interrupts. LDL_SYSTEM_BARRIER() may need to be defined if the
+ * interrupt and mainloop run on different cores.
+ *
  * @{
  * */
 
@@ -146,6 +149,30 @@ typedef uint8_t (*ldl_system_get_battery_level_fn)(void *app);
 #define LDL_SYSTEM_LEAVE_CRITICAL(APP)
 #endif
 
+#ifndef LDL_SYSTEM_BARRIER
+
+/** Expanded between writing an event and publishing it to the other
+ * side of the interrupt event ring.
+ *
+ * The ring indices are volatile so nothing is required for a
+ * single core MCU.
+ *
+ * If you are using CMSIS on a multi-core device:
+ * @code{.c}
+ * #define LDL_SYSTEM_BARRIER() __DMB();
+ * @endcode
+ *
+ * If you are using C11:
+ * @code{.c}
+ * #include <stdatomic.h>
+ *
+ * #define LDL_SYSTEM_BARRIER() atomic_thread_fence(memory_order_seq_cst);
+ * @endcode
+ *
+ * */
+#define LDL_SYSTEM_BARRIER()
+#endif
+
 #ifdef __cplusplus
 }
 #endif
@@ -65,6 +65,41 @@ void LDL_CMAC_init(struct ldl_cmac_ctx *ctx, const struct ldl_aes_ctx *aes_ctx)
     ctx->aes_ctx = aes_ctx;
 }
 
+void LDL_CMAC_initWithSubkeys(struct ldl_cmac_ctx *ctx, const struct ldl_aes_ctx *aes_ctx, const struct ldl_cmac_subkeys *subkeys)
+{
+    LDL_PEDANTIC(subkeys != NULL)
+
+    LDL_CMAC_init(ctx, aes_ctx);
+    ctx->subkeys = subkeys;
+}
+
+void LDL_CMAC_initSubkeys(struct ldl_cmac_subkeys *subkeys, const struct ldl_aes_ctx *aes_ctx)
+{
+    LDL_PEDANTIC(subkeys != NULL)
+    LDL_PEDANTIC(aes_ctx != NULL)
+
+    uint8_t k[BLOCK_SIZE];
+
+    (void)memset(k, 0, sizeof(k));
+    LDL_AES_encrypt(aes_ctx, k);
+
+    (void)memcpy(subkeys->k1, k, sizeof(subkeys->k1));
+    leftShift128(subkeys->k1);
+
+    if((k[0] & 0x80U) == 0x80U){
+
+        subkeys->k1[15] ^= 0x87U;
+    }
+
+    (void)memcpy(subkeys->k2, subkeys->k1, sizeof(subkeys->k2));
+    leftShift128(subkeys->k2);
+
+    if((subkeys->k1[0] & 0x80U) == 0x80U){
+
+        subkeys->k2[15] ^= 0x87U;
+    }
+}
+
 void LDL_CMAC_update(struct ldl_cmac_ctx *ctx, const void *data, uint8_t len)
 {
     LDL_PEDANTIC(ctx != NULL)
@@ -123,34 +158,23 @@ void LDL_CMAC_finish(const struct ldl_cmac_ctx *ctx, void *out, uint8_t outMax)
 {
     LDL_PEDANTIC(ctx != NULL)
 
-    uint8_t k[BLOCK_SIZE];
-
-    uint8_t k1[BLOCK_SIZE];
-    uint8_t k2[BLOCK_SIZE];
+    struct ldl_cmac_subkeys generated;
+    const struct ldl_cmac_subkeys *subkeys;
 
     uint8_t m_last[BLOCK_SIZE];
 
     uint8_t part;
 
-    /* generate subkeys */
+    /* generate subkeys if they were not provided */
 
-    (void)memset(k, 0, sizeof(k));
-    LDL_AES_encrypt(ctx->aes_ctx, k);
-
-    (void)memcpy(k1, k, sizeof(k1));
-    leftShift128(k1);
-
-    if((k[0] & 0x80U) == 0x80U){
+    if(ctx->subkeys != NULL){
 
-        k1[15] ^= 0x87U;
+        subkeys = ctx->subkeys;
     }
+    else{
 
-    (void)memcpy(k2, k1, sizeof(k2));
-    leftShift128(k2);
-
-    if((k1[0] & 0x80U) == 0x80U){
-
-        k2[15] ^= 0x87U;
+        LDL_CMAC_initSubkeys(&generated, ctx->aes_ctx);
+        subkeys = &generated;
     }
 
     /* process last block (m_last) */
@@ -164,13 +188,13 @@ void LDL_CMAC_finish(const struct ldl_cmac_ctx *ctx, void *out, uint8_t outMax)
         (void)memcpy(m_last, ctx->m, part);
 
         m_last[part] = 0x80U;
-        xor128(m_last, k2);
+        xor128(m_last, subkeys->k2);
     }
     else{
 
         (void)memcpy(m_last, ctx->m, sizeof(m_last));
 
-        xor128(m_last, k1);
+        xor128(m_last, subkeys->k1);
     }
 
     xor128(m_last, ctx->x);
@@ -28,74 +28,89 @@
 
 /* static function prototypes *****************************************/
 
-static void xor128(uint8_t *acc, const uint8_t *op);
+static void xorWords(uint8_t *out, const uint8_t *in, const uint8_t *mask, uint8_t len);
 
 /* functions **********************************************************/
 
-void LDL_CTR_encrypt(struct ldl_aes_ctx *ctx, const void *iv, const void *in, void *out, uint8_t len)
+void LDL_CTR_encrypt(const struct ldl_aes_ctx *ctx, const void *iv, const void *in, void *out, uint8_t len)
 {
     LDL_PEDANTIC(ctx != NULL)
 
     uint8_t a[16U];
     uint8_t s[16U];
-    uint8_t pld[16U];
-    uint8_t k;
-    uint8_t i;
     uint8_t pos;
     uint8_t size;
     const uint8_t *ptr_in;
     uint8_t *ptr_out;
 
-    /* number of blocks */
-    k = (len / 16U) + (((len % 16U) != 0U) ? 1U : 0U);
-
-    pos = 0U;
-
     ptr_in = (const uint8_t *)in;
     ptr_out = (uint8_t *)out;
 
     (void)memcpy(a, iv, sizeof(a));
 
-    for(i=0U; i < k; i++){
+    for(pos=0U; pos < len; pos += size){
 
         size = ((len - pos) >= U8(sizeof(a))) ? U8(sizeof(a)) : (len - pos);
 
-        (void)memset(pld, 0, sizeof(pld));
-
-        (void)memcpy(pld, &ptr_in[pos], size);
-
         (void)memcpy(s, a, sizeof(s));
 
         a[15U]++;
 
         LDL_AES_encrypt(ctx, s);
 
-        xor128(pld, s);
+        xorWords(&ptr_out[pos], &ptr_in[pos], s, size);
+    }
+}
+
+void LDL_CTR_keystream(const struct ldl_aes_ctx *ctx, const void *iv, void *ks, uint8_t len)
+{
+    LDL_PEDANTIC(ctx != NULL)
+
+    uint8_t a[16U];
+    uint8_t *ptr_ks;
+    uint16_t pos;
+
+    ptr_ks = (uint8_t *)ks;
+
+    (void)memcpy(a, iv, sizeof(a));
+
+    for(pos=0U; pos < len; pos += U16(sizeof(a))){
 
-        (void)memcpy(&ptr_out[pos], pld, size);
+        (void)memcpy(&ptr_ks[pos], a, sizeof(a));
 
-        pos += U8(sizeof(a));
+        a[15U]++;
+
+        LDL_AES_encrypt(ctx, &ptr_ks[pos]);
     }
 }
 
+void LDL_CTR_xor(void *data, const void *ks, uint8_t len)
+{
+    xorWords((uint8_t *)data, (const uint8_t *)data, (const uint8_t *)ks, len);
+}
+
 /* static functions ***************************************************/
 
-static void xor128(uint8_t *acc, const uint8_t *op)
+static void xorWords(uint8_t *out, const uint8_t *in, const uint8_t *mask, uint8_t len)
 {
-    acc[0] ^= op[0];
-    acc[1] ^= op[1];
-    acc[2] ^= op[2];
-    acc[3] ^= op[3];
-    acc[4] ^= op[4];
-    acc[5] ^= op[5];
-    acc[6] ^= op[6];
-    acc[7] ^= op[7];
-    acc[8] ^= op[8];
-    acc[9] ^= op[9];
-    acc[10] ^= op[10];
-    acc[11] ^= op[11];
-    acc[12] ^= op[12];
-    acc[13] ^= op[13];
-    acc[14] ^= op[14];
-    acc[15] ^= op[15];
+    uint32_t w;
+    uint32_t m;
+    uint8_t pos;
+
+    /* memcpy lets the compiler pick the widest access the
+     * target allows for any alignment */
+    for(pos=0U; (len - pos) >= U8(sizeof(w)); pos += U8(sizeof(w))){
+
+        (void)memcpy(&w, &in[pos], sizeof(w));
+        (void)memcpy(&m, &mask[pos], sizeof(m));
+
+        w ^= m;
+
+        (void)memcpy(&out[pos], &w, sizeof(w));
+    }
+
+    for(; pos < len; pos++){
+
+        out[pos] = in[pos] ^ mask[pos];
+    }
 }
@@ -0,0 +1,51 @@
+/* Copyright (c) 2019-2020 Cameron Harper
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * */
+
+#include "ldl_div.h"
+#include "ldl_debug.h"
+#include "ldl_internal.h"
+
+/* functions **********************************************************/
+
+void LDL_DIV_init(struct ldl_div *self, uint32_t d)
+{
+    uint8_t l = 0U;
+
+    LDL_PEDANTIC(self != NULL)
+    LDL_PEDANTIC(d > 0U)
+
+    while((l < 32U) && ((U64(1) << l) < U64(d))){
+
+        l++;
+    }
+
+    /* the only division, and it only happens once */
+    self->m = U32(((U64(1) << 32) * ((U64(1) << l) - U64(d))) / U64(d)) + U32(1);
+    self->sh1 = (l > 0U) ? U8(1) : U8(0);
+    self->sh2 = (l > 0U) ? U8(l - 1U) : U8(0);
+}
+
+uint32_t LDL_DIV_divide(const struct ldl_div *self, uint32_t n)
+{
+    uint32_t t = U32((U64(self->m) * U64(n)) >> 32);
+
+    return (t + ((n - t) >> self->sh1)) >> self->sh2;
+}
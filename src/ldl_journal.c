@@ -0,0 +1,372 @@
+/* Copyright (c) 2019-2020 Cameron Harper
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * */
+
+#include "ldl_journal.h"
+#include "ldl_debug.h"
+#include "ldl_internal.h"
+
+#include <string.h>
+
+/* A page starts with a header (sequence number then a commit byte)
+ * and is followed by records (field, size, data then a commit byte).
+ *
+ * Commit bytes are written last so that an interrupted write
+ * can be detected.
+ * */
+#define HEADER_SIZE 5U
+#define RECORD_OVERHEAD 3U
+
+#define COMMITTED 0x00U
+#define ERASED 0xffU
+
+/* static function prototypes *****************************************/
+
+static uint32_t pageAddr(const struct ldl_journal *self, uint8_t page);
+static uint32_t recordSize(enum ldl_mac_session_field field);
+static uint32_t snapshotSize(void);
+static bool readHeader(const struct ldl_journal *self, uint8_t page, uint32_t *seq);
+static uint32_t replay(const struct ldl_journal *self, struct ldl_mac_session *session);
+static bool append(struct ldl_journal *self, const struct ldl_mac_session *session, enum ldl_mac_session_field field);
+static void compact(struct ldl_journal *self, const struct ldl_mac_session *session);
+
+/* functions **********************************************************/
+
+bool LDL_Journal_init(struct ldl_journal *self, const struct ldl_journal_init_arg *arg)
+{
+    LDL_PEDANTIC(self != NULL)
+    LDL_PEDANTIC(arg != NULL)
+    LDL_PEDANTIC(arg->flash != NULL)
+
+    uint32_t seq[2U];
+    bool valid[2U];
+    bool retval;
+
+    /* flash stays NULL on failure so nothing is read or written */
+    (void)memset(self, 0, sizeof(*self));
+
+    /* a page must hold a complete session */
+    if(arg->pageSize < snapshotSize()){
+
+        LDL_ERROR("journal: pageSize=%" PRIu32 " cannot hold a session (%" PRIu32 ")", arg->pageSize, snapshotSize())
+        retval = false;
+    }
+    else{
+
+        self->flash = arg->flash;
+        self->receiver = arg->receiver;
+        self->pageSize = arg->pageSize;
+
+        valid[0] = readHeader(self, 0U, &seq[0]);
+        valid[1] = readHeader(self, 1U, &seq[1]);
+
+        if(valid[0] && valid[1]){
+
+            /* the newer page is active (works across wrap) */
+            self->page = ((seq[1] - seq[0]) < U32(0x80000000)) ? 1U : 0U;
+            self->valid = true;
+        }
+        else if(valid[0]){
+
+            self->page = 0U;
+            self->valid = true;
+        }
+        else if(valid[1]){
+
+            self->page = 1U;
+            self->valid = true;
+        }
+        else{
+
+            LDL_DEBUG("journal is empty")
+        }
+
+        if(self->valid){
+
+            self->seq = seq[self->page];
+            self->pos = replay(self, NULL);
+
+            LDL_DEBUG("journal: page=%u seq=%" PRIu32 " pos=%" PRIu32, self->page, self->seq, self->pos)
+        }
+
+        retval = true;
+    }
+
+    return retval;
+}
+
+bool LDL_Journal_restore(const struct ldl_journal *self, struct ldl_mac_session *session)
+{
+    LDL_PEDANTIC(self != NULL)
+    LDL_PEDANTIC(session != NULL)
+
+    bool retval;
+
+    if(self->valid){
+
+        (void)replay(self, session);
+        retval = true;
+    }
+    else{
+
+        retval = false;
+    }
+
+    return retval;
+}
+
+void LDL_Journal_update(struct ldl_journal *self, const struct ldl_mac_session *session, uint16_t changed)
+{
+    LDL_PEDANTIC(self != NULL)
+    LDL_PEDANTIC(session != NULL)
+
+    uint32_t size;
+    bool fits;
+    uint8_t i;
+
+    if(self->flash != NULL){
+
+        size = 0U;
+
+        for(i=0U; i < U8(LDL_SESSION_FIELD_MAX); i++){
+
+            if((changed & (U16(1) << i)) > 0U){
+
+                size += recordSize((enum ldl_mac_session_field)i);
+            }
+        }
+
+        fits = self->valid && ((self->pos + size) <= self->pageSize);
+
+        for(i=0U; fits && (i < U8(LDL_SESSION_FIELD_MAX)); i++){
+
+            if((changed & (U16(1) << i)) > 0U){
+
+                fits = append(self, session, (enum ldl_mac_session_field)i);
+            }
+        }
+
+        /* also taken if a record would not fit */
+        if(!fits){
+
+            compact(self, session);
+        }
+    }
+}
+
+/* static functions ***************************************************/
+
+static uint32_t pageAddr(const struct ldl_journal *self, uint8_t page)
+{
+    return (page == 0U) ? 0U : self->pageSize;
+}
+
+static uint32_t recordSize(enum ldl_mac_session_field field)
+{
+    size_t offset;
+    size_t size;
+    uint32_t retval;
+
+    retval = 0U;
+
+    if(LDL_MAC_getSessionField(field, &offset, &size)){
+
+        /* empty fields are not recorded */
+        if(size > 0U){
+
+            retval = U32(size) + RECORD_OVERHEAD;
+        }
+    }
+
+    return retval;
+}
+
+static uint32_t snapshotSize(void)
+{
+    uint32_t retval;
+    uint8_t i;
+
+    retval = HEADER_SIZE;
+
+    for(i=0U; i < U8(LDL_SESSION_FIELD_MAX); i++){
+
+        retval += recordSize((enum ldl_mac_session_field)i);
+    }
+
+    return retval;
+}
+
+static bool readHeader(const struct ldl_journal *self, uint8_t page, uint32_t *seq)
+{
+    uint8_t header[HEADER_SIZE];
+
+    self->flash->read(self->receiver, pageAddr(self, page), header, sizeof(header));
+
+    *seq = U32(header[0])
+        | (U32(header[1]) << 8)
+        | (U32(header[2]) << 16)
+        | (U32(header[3]) << 24);
+
+    return (header[4] == COMMITTED);
+}
+
+static uint32_t replay(const struct ldl_journal *self, struct ldl_mac_session *session)
+{
+    uint32_t base;
+    uint32_t pos;
+    uint8_t record[2U];
+    uint8_t commit;
+    size_t offset;
+    size_t size;
+    bool done;
+
+    base = pageAddr(self, self->page);
+    pos = HEADER_SIZE;
+    done = false;
+
+    while(!done){
+
+        if((pos + RECORD_OVERHEAD) > self->pageSize){
+
+            done = true;
+        }
+        else{
+
+            self->flash->read(self->receiver, base + pos, record, sizeof(record));
+
+            if(record[0] == ERASED){
+
+                /* end of journal */
+                done = true;
+            }
+            else if(
+                LDL_MAC_getSessionField((enum ldl_mac_session_field)record[0], &offset, &size)
+                &&
+                (size > 0U)
+                &&
+                (U32(record[1]) == U32(size))
+                &&
+                ((pos + RECORD_OVERHEAD + U32(size)) <= self->pageSize)
+            ){
+                self->flash->read(self->receiver, base + pos + 2U + U32(size), &commit, sizeof(commit));
+
+                if(commit == COMMITTED){
+
+                    if(session != NULL){
+
+                        self->flash->read(self->receiver, base + pos + 2U, &((uint8_t *)session)[offset], size);
+                    }
+
+                    pos += RECORD_OVERHEAD + U32(size);
+                }
+                else{
+
+                    LDL_INFO("journal: interrupted record at %" PRIu32, pos)
+
+                    /* cannot write over this so compact on next update */
+                    pos = self->pageSize;
+                    done = true;
+                }
+            }
+            else{
+
+                LDL_ERROR("journal: bad record at %" PRIu32, pos)
+
+                pos = self->pageSize;
+                done = true;
+            }
+        }
+    }
+
+    return pos;
+}
+
+static bool append(struct ldl_journal *self, const struct ldl_mac_session *session, enum ldl_mac_session_field field)
+{
+    uint32_t addr;
+    uint8_t record[2U];
+    uint8_t commit;
+    size_t offset;
+    size_t size;
+    bool retval;
+
+    retval = true;
+
+    if(!LDL_MAC_getSessionField(field, &offset, &size) || (size == 0U)){
+
+        /* empty fields are not recorded */
+    }
+    else if((self->pos + RECORD_OVERHEAD + U32(size)) > self->pageSize){
+
+        /* never write past the end of the page */
+        retval = false;
+    }
+    else{
+
+        addr = pageAddr(self, self->page) + self->pos;
+
+        record[0] = U8(field);
+        record[1] = U8(size);
+        commit = COMMITTED;
+
+        self->flash->write(self->receiver, addr, record, sizeof(record));
+        self->flash->write(self->receiver, addr + 2U, &((const uint8_t *)session)[offset], size);
+        self->flash->write(self->receiver, addr + 2U + U32(size), &commit, sizeof(commit));
+
+        self->pos += U32(size) + RECORD_OVERHEAD;
+    }
+
+    return retval;
+}
+
+static void compact(struct ldl_journal *self, const struct ldl_mac_session *session)
+{
+    uint8_t header[HEADER_SIZE];
+    uint32_t seq;
+    uint8_t i;
+
+    seq = self->valid ? (self->seq + 1U) : 0U;
+
+    /* the other page is only erased now that it is needed */
+    self->page = (self->page == 0U) ? 1U : 0U;
+    self->pos = HEADER_SIZE;
+
+    LDL_DEBUG("journal: compact to page=%u seq=%" PRIu32, self->page, seq)
+
+    self->flash->erase(self->receiver, pageAddr(self, self->page));
+
+    /* LDL_Journal_init() checked that a complete session fits */
+    for(i=0U; i < U8(LDL_SESSION_FIELD_MAX); i++){
+
+        (void)append(self, session, (enum ldl_mac_session_field)i);
+    }
+
+    /* page becomes valid once the header is written */
+    header[0] = U8(seq);
+    header[1] = U8(seq >> 8);
+    header[2] = U8(seq >> 16);
+    header[3] = U8(seq >> 24);
+    header[4] = COMMITTED;
+
+    self->flash->write(self->receiver, pageAddr(self, self->page), header, sizeof(header));
+
+    self->seq = seq;
+    self->valid = true;
+}
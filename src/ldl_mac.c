@@ -29,8 +29,23 @@
 #include "ldl_sm_internal.h"
 #include "ldl_ops.h"
 #include "ldl_internal.h"
+#include "ldl_div.h"
 #include <string.h>
 
+#ifdef LDL_ENABLE_ATOMIC_TIMERS
+#include <stdatomic.h>
+
+/* struct ldl_timer_latch is declared with plain types so that ldl_mac.h
+ * stays usable from C++, these check it can be accessed as atomics */
+_Static_assert((sizeof(atomic_uint) == sizeof(unsigned)) && (_Alignof(atomic_uint) == _Alignof(unsigned)), "atomic_uint differs from unsigned");
+_Static_assert((sizeof(_Atomic(uint32_t)) == sizeof(uint32_t)) && (_Alignof(_Atomic(uint32_t)) == _Alignof(uint32_t)), "_Atomic(uint32_t) differs from uint32_t");
+_Static_assert((sizeof(atomic_bool) == sizeof(bool)) && (_Alignof(atomic_bool) == _Alignof(bool)), "atomic_bool differs from bool");
+
+#define LATCH_SEQ(SELF) ((atomic_uint *)&(SELF)->next.seq)
+#define LATCH_TIME(SELF, N) ((_Atomic(uint32_t) *)&(SELF)->next.time[N])
+#define LATCH_ARMED(SELF, N) ((atomic_bool *)&(SELF)->next.armed[N])
+#endif
+
 enum {
 
     ADRAckLimit = 64U,
@@ -41,25 +56,87 @@ enum {
 #ifdef LDL_PARAM_TPS
     #define GET_TPS() U32(LDL_PARAM_TPS)
 #else
-    #define GET_TPS() self->tps
+    #define GET_TPS() LDL_MAC_CONFIG(self)->tps
+#endif
+
+#ifdef LDL_PARAM_TPS
+    static const struct ldl_div tpsDiv = LDL_DIV_INIT(LDL_PARAM_TPS);
+    #define GET_TPS_DIV() (&tpsDiv)
+#else
+    #define GET_TPS_DIV() (&self->tpsDiv)
 #endif
 
 #ifdef LDL_PARAM_A
     #define GET_A() U32(LDL_PARAM_A)
 #else
-    #define GET_A() self->a
+    #define GET_A() LDL_MAC_CONFIG(self)->a
 #endif
 
 #ifdef LDL_PARAM_B
     #define GET_B() U32(LDL_PARAM_B)
 #else
-    #define GET_B() self->b
+    #define GET_B() LDL_MAC_CONFIG(self)->b
 #endif
 
 #ifdef LDL_PARAM_ADVANCE
     #define GET_ADVANCE() U32(LDL_PARAM_ADVANCE)
 #else
-    #define GET_ADVANCE() self->advance
+    #define GET_ADVANCE() LDL_MAC_CONFIG(self)->advance
+#endif
+
+#define GET_APP(SELF) (LDL_MAC_CONFIG(SELF)->app)
+#define GET_TICKS(SELF) LDL_MAC_CONFIG(SELF)->ticks(GET_APP(SELF))
+#define GET_RAND(SELF) LDL_MAC_CONFIG(SELF)->rand(GET_APP(SELF))
+#define GET_BATTERY_LEVEL(SELF) LDL_MAC_CONFIG(SELF)->get_battery_level(GET_APP(SELF))
+#define NOTIFY(SELF, ...) LDL_MAC_CONFIG(SELF)->handler(GET_APP(SELF), __VA_ARGS__)
+
+#ifdef LDL_FIXED_REGION
+    #define GET_REGION() (LDL_FIXED_REGION)
+#else
+    #define GET_REGION() (self->ctx.region)
+#endif
+
+#ifdef LDL_FIXED_RADIO
+    #if defined(LDL_ENABLE_SX1272) || defined(LDL_ENABLE_SX1276)
+        #define RADIO_FN(NAME) LDL_SX127X_##NAME
+    #else
+        #define RADIO_FN(NAME) LDL_SX126X_##NAME
+    #endif
+    #define RADIO_SET_MODE(SELF, ...) RADIO_FN(setMode)(LDL_MAC_CONFIG(SELF)->radio, __VA_ARGS__)
+    #define RADIO_READ_ENTROPY(SELF) RADIO_FN(readEntropy)(LDL_MAC_CONFIG(SELF)->radio)
+    #define RADIO_READ_BUFFER(SELF, ...) RADIO_FN(readBuffer)(LDL_MAC_CONFIG(SELF)->radio, __VA_ARGS__)
+    #define RADIO_TRANSMIT(SELF, ...) RADIO_FN(transmit)(LDL_MAC_CONFIG(SELF)->radio, __VA_ARGS__)
+    #define RADIO_RECEIVE(SELF, ...) RADIO_FN(receive)(LDL_MAC_CONFIG(SELF)->radio, __VA_ARGS__)
+    #define RADIO_RECEIVE_ENTROPY(SELF) RADIO_FN(receiveEntropy)(LDL_MAC_CONFIG(SELF)->radio)
+    #define RADIO_GET_STATUS(SELF, ...) RADIO_FN(getStatus)(LDL_MAC_CONFIG(SELF)->radio, __VA_ARGS__)
+#else
+    #define RADIO_SET_MODE(SELF, ...) LDL_MAC_CONFIG(SELF)->radio_interface->set_mode(LDL_MAC_CONFIG(SELF)->radio, __VA_ARGS__)
+    #define RADIO_READ_ENTROPY(SELF) LDL_MAC_CONFIG(SELF)->radio_interface->read_entropy(LDL_MAC_CONFIG(SELF)->radio)
+    #define RADIO_READ_BUFFER(SELF, ...) LDL_MAC_CONFIG(SELF)->radio_interface->read_buffer(LDL_MAC_CONFIG(SELF)->radio, __VA_ARGS__)
+    #define RADIO_TRANSMIT(SELF, ...) LDL_MAC_CONFIG(SELF)->radio_interface->transmit(LDL_MAC_CONFIG(SELF)->radio, __VA_ARGS__)
+    #define RADIO_RECEIVE(SELF, ...) LDL_MAC_CONFIG(SELF)->radio_interface->receive(LDL_MAC_CONFIG(SELF)->radio, __VA_ARGS__)
+    #define RADIO_RECEIVE_ENTROPY(SELF) LDL_MAC_CONFIG(SELF)->radio_interface->receive_entropy(LDL_MAC_CONFIG(SELF)->radio)
+    #define RADIO_GET_STATUS(SELF, ...) LDL_MAC_CONFIG(SELF)->radio_interface->get_status(LDL_MAC_CONFIG(SELF)->radio, __VA_ARGS__)
+#endif
+
+#ifdef LDL_ENABLE_ATOMIC_TIMERS
+    /* timers[] are only accessed by the mainloop and next is published
+     * through a latch */
+    #define TIMER_ENTER_CRITICAL(APP)
+    #define TIMER_LEAVE_CRITICAL(APP)
+#else
+    #define TIMER_ENTER_CRITICAL(APP) LDL_SYSTEM_ENTER_CRITICAL(APP)
+    #define TIMER_LEAVE_CRITICAL(APP) LDL_SYSTEM_LEAVE_CRITICAL(APP)
+#endif
+
+#ifdef LDL_ENABLE_SINGLE_BUFFER
+    /* downlinks share buffer with the uplink which must be
+     * encoded and MIC'd again before each retransmission */
+    #define RX_BUFFER(SELF) ((SELF)->buffer)
+    #define RETRY_MIC_STEP 0U
+#else
+    #define RX_BUFFER(SELF) ((SELF)->rx_buffer)
+    #define RETRY_MIC_STEP 1U
 #endif
 
 #ifdef LDL_DISABLE_SF12
@@ -71,37 +148,48 @@ enum {
 /* static function prototypes *****************************************/
 
 
-static void processInit(struct ldl_mac *self);
-static void processRadioReset(struct ldl_mac *self, enum ldl_mac_sme event);
+static void processInit(struct ldl_mac *self, uint32_t now);
+static void processRadioReset(struct ldl_mac *self, enum ldl_mac_sme event, uint32_t now);
 
-static void processRadioBoot(struct ldl_mac *self, enum ldl_mac_sme event);
+static void processRadioBoot(struct ldl_mac *self, enum ldl_mac_sme event, uint32_t now);
 
 static void processWait(struct ldl_mac *self, enum ldl_mac_sme event, uint32_t lag);
 
-static void processWaitOTAA(struct ldl_mac *self, enum ldl_mac_sme event);
+static void processWaitOTAA(struct ldl_mac *self, enum ldl_mac_sme event, uint32_t now);
 
-static void processStartRadioForEntropy(struct ldl_mac *self, enum ldl_mac_sme event);
-static void processEntropy(struct ldl_mac *self, enum ldl_mac_sme event);
+static void processStartRadioForEntropy(struct ldl_mac *self, enum ldl_mac_sme event, uint32_t now);
+static void processEntropy(struct ldl_mac *self, enum ldl_mac_sme event, uint32_t now);
 
-static void processStartRadioForTX(struct ldl_mac *self, enum ldl_mac_sme event);
-static void processTX(struct ldl_mac *self, enum ldl_mac_sme event, uint32_t lag);
+static void processStartRadioForTX(struct ldl_mac *self, enum ldl_mac_sme event, uint32_t now);
+static void processTX(struct ldl_mac *self, enum ldl_mac_sme event, uint32_t now, uint32_t lag);
 
-static void processStartRadioForRX1(struct ldl_mac *self, enum ldl_mac_sme event, uint32_t lag);
-static void processStartRadioForRX2(struct ldl_mac *self, enum ldl_mac_sme event, uint32_t lag);
-static void processRX(struct ldl_mac *self, enum ldl_mac_sme event);
+static void processStartRadioForRX1(struct ldl_mac *self, enum ldl_mac_sme event, uint32_t now, uint32_t lag);
+static void processStartRadioForRX2(struct ldl_mac *self, enum ldl_mac_sme event, uint32_t now, uint32_t lag);
+static void processRX(struct ldl_mac *self, enum ldl_mac_sme event, uint32_t now);
 
-static void processRX2Lockout(struct ldl_mac *self, enum ldl_mac_sme event);
+static void processRX2Lockout(struct ldl_mac *self, enum ldl_mac_sme event, uint32_t now);
+static void processDownlink(struct ldl_mac *self, const struct ldl_frame_down *frame, uint32_t now);
+#ifdef LDL_ENABLE_ASYNC_SM
+static void processWaitSM(struct ldl_mac *self, enum ldl_mac_sme event, uint32_t now);
+static bool smAvailable(const struct ldl_mac *self);
+static bool beginUplinkMIC(struct ldl_mac *self, uint8_t step, uint32_t delay);
+static bool smCheck(struct ldl_mac *self);
+static bool smPending(const struct ldl_mac *self);
+#endif
 
 static void debugSession(struct ldl_mac *self);
+static void planRXWindows(struct ldl_mac *self);
 static uint32_t extraSymbols(uint32_t xtal_error, uint32_t symbol_period);
 static enum ldl_mac_status externalDataCommand(struct ldl_mac *self, bool confirmed, uint8_t port, const void *data, uint8_t len, const struct ldl_mac_data_opts *opts);
-static void processCommands(struct ldl_mac *self, const uint8_t *in, uint8_t len);
-static bool selectChannel(const struct ldl_mac *self, uint8_t desired_rate, uint32_t limit, struct ldl_mac_tx *tx);
+static void processCommands(struct ldl_mac *self, const uint8_t *in, uint8_t len, uint32_t now);
 static uint8_t requiredRate(uint8_t desired, uint8_t min, uint8_t max);
 static void selectJoinChannelAndRate(struct ldl_mac *self, struct ldl_mac_tx *tx);
 static void registerTime(struct ldl_mac *self, const struct ldl_mac_tx *tx);
 static bool getChannel(const struct ldl_mac *self, uint8_t chIndex, uint32_t *freq, uint8_t *minRate, uint8_t *maxRate);
-static bool isAvailable(const struct ldl_mac *self, uint8_t chIndex, uint32_t limit);
+static void updateChannelBand(struct ldl_mac *self, uint8_t chIndex);
+static void initChannelBands(struct ldl_mac *self);
+static uint8_t countChannels(const uint8_t *mask, size_t max);
+static uint8_t nthChannel(const uint8_t *mask, size_t max, uint8_t n);
 static void initSession(struct ldl_mac *self, enum ldl_region region);
 static void forgetNetwork(struct ldl_mac *self);
 static bool setChannel(struct ldl_mac *self, uint8_t chIndex, uint32_t freq, uint8_t minRate, uint8_t maxRate);
@@ -110,24 +198,34 @@ static bool unmaskChannel(uint8_t *mask, size_t max, enum ldl_region region, uin
 static void unmaskAllChannels(uint8_t *mask, size_t max);
 static bool channelIsMasked(const uint8_t *mask, size_t max, enum ldl_region region, uint8_t chIndex);
 static uint32_t symbolPeriod(uint32_t tps, enum ldl_spreading_factor sf, enum ldl_signal_bandwidth bw);
-static uint32_t timeUntilAvailable(const struct ldl_mac *self, uint8_t chIndex);
 static bool rateSettingIsValid(enum ldl_region region, uint8_t rate);
 static bool adaptRate(struct ldl_mac *self);
-static bool processBands(struct ldl_mac *self);
-static void setNextBandEvent(struct ldl_mac *self);
-static void downlinkMissingHandler(struct ldl_mac *self);
+static bool updateDownCounter(uint32_t *counter, uint32_t time);
+static bool processBands(struct ldl_mac *self, uint32_t now);
+static void setNextBandEvent(struct ldl_mac *self, uint32_t now);
+static void downlinkMissingHandler(struct ldl_mac *self, uint32_t now);
 static uint32_t timeUntilNextChannel(const struct ldl_mac *self);
 static uint32_t timerDelta(uint32_t timeout, uint32_t time);
+static void updateNextTimer(struct ldl_mac *self);
+static void readNextTimer(const struct ldl_mac *self, struct ldl_timer *next);
 static void pushSessionUpdate(struct ldl_mac *self);
+static void sessionChanged(struct ldl_mac *self, enum ldl_mac_session_field field);
+static void upCounterChanged(struct ldl_mac *self);
+#ifndef LDL_ENABLE_CONST_CONFIG
 static void dummyResponseHandler(void *app, enum ldl_mac_response_type type, const union ldl_mac_response_arg *arg);
+#endif
 static bool allChannelsAreMasked(const uint8_t *mask, size_t max);
 static bool commandIsPending(const struct ldl_mac *self, enum ldl_mac_cmd_type type);
 static void clearPendingCommand(struct ldl_mac *self, enum ldl_mac_cmd_type type);
 static void setPendingCommand(struct ldl_mac *self, enum ldl_mac_cmd_type type);
+static bool getAnswer(const struct ldl_mac *self, enum ldl_mac_answer bit);
+static void setAnswer(struct ldl_mac *self, enum ldl_mac_answer bit, bool value);
+#ifndef LDL_ENABLE_CONST_CONFIG
 static uint32_t defaultRand(void *app);
 static uint8_t defaultBatteryLevel(void *app);
+#endif
 static uint32_t getOTAAOffTime(const struct ldl_mac *self);
-static void handleRadioError(struct ldl_mac *self);
+static void handleRadioError(struct ldl_mac *self, uint32_t now);
 #ifndef LDL_DISABLE_TX_PARAM_SETUP
 static bool uplinkDwell(uint8_t tx_param_setup);
 #endif
@@ -138,12 +236,34 @@ static uint32_t msToTicks(const struct ldl_mac *self, uint32_t ms);
 
 static void inputArm(struct ldl_mac *self);
 static void inputDisarm(struct ldl_mac *self);
-static bool inputCheck(struct ldl_mac *self, uint32_t *lag);
+static bool inputCheck(struct ldl_mac *self, uint32_t now, uint32_t *lag);
 static void inputSignal(struct ldl_mac *self, uint32_t ticks);
 static bool inputPending(const struct ldl_mac *self);
 
 static const uint32_t timeTPS = U32(0x100);
-static const uint8_t sessionMagicNumber = 0xdbU;
+static const struct ldl_div msDiv = LDL_DIV_INIT(1000U);
+static const struct ldl_div bw125Div = LDL_DIV_INIT(125000U);
+static const uint8_t sessionMagicNumber = 0xdcU;
+
+/* start of each ldl_mac_session_field (the last entry is the end of the session) */
+static const size_t sessionFieldStart[LDL_SESSION_FIELD_MAX + 1] = {
+    0U,
+    offsetof(struct ldl_mac_session, up),
+    offsetof(struct ldl_mac_session, appDown),
+    offsetof(struct ldl_mac_session, devAddr),
+    offsetof(struct ldl_mac_session, rx2Freq),
+    offsetof(struct ldl_mac_session, joinNonce),
+    offsetof(struct ldl_mac_session, chConfig),
+    offsetof(struct ldl_mac_session, adr_ack_limit),
+    offsetof(struct ldl_mac_session, devNonce),
+    offsetof(struct ldl_mac_session, pending_cmds),
+    offsetof(struct ldl_mac_session, chMask),
+    offsetof(struct ldl_mac_session, rate),
+    offsetof(struct ldl_mac_session, rx1DROffset),
+    offsetof(struct ldl_mac_session, dev_status_ans),
+    offsetof(struct ldl_mac_session, upReserved),
+    sizeof(struct ldl_mac_session)
+};
 
 /* functions **********************************************************/
 
@@ -151,58 +271,82 @@ void LDL_MAC_init(struct ldl_mac *self, enum ldl_region region, const struct ldl
 {
     LDL_PEDANTIC(self != NULL)
     LDL_PEDANTIC(arg != NULL)
-    LDL_PEDANTIC(arg->ticks != NULL)
-    LDL_PEDANTIC(arg->radio_interface != NULL);
-    LDL_PEDANTIC(arg->sm_interface != NULL);
 
     (void)memset(self, 0, sizeof(*self));
 
-    self->tx.chIndex = UINT8_MAX;
+#ifdef LDL_ENABLE_CONST_CONFIG
+    LDL_PEDANTIC(arg->config != NULL)
+    LDL_PEDANTIC(arg->config->rand != NULL)
+    LDL_PEDANTIC(arg->config->get_battery_level != NULL)
+    LDL_PEDANTIC(arg->config->handler != NULL)
 
+    self->config = arg->config;
+#else
 #ifndef LDL_PARAM_TPS
-    self->tps = arg->tps;
+    self->config.tps = arg->tps;
 #endif
 #ifndef LDL_PARAM_A
-    self->a = arg->a;
+    self->config.a = arg->a;
 #endif
 #ifndef LDL_PARAM_B
-    self->b = arg->b;
+    self->config.b = arg->b;
 #endif
 #ifndef LDL_PARAM_ADVANCE
-    self->advance = arg->advance;
+    self->config.advance = arg->advance;
 #endif
 #ifdef LDL_ENABLE_OTAA_DITHER
-    self->otaaDither = arg->otaaDither;
+    self->config.otaaDither = arg->otaaDither;
 #endif
 
-    /* 1M >= tps >= 1K */
-    LDL_PEDANTIC((GET_TPS() >= U32(1000)) && (GET_TPS() <= U32(1000000)))
-
-    self->ticks = arg->ticks;
-    self->rand = (arg->rand != NULL) ? arg->rand : defaultRand;
-    self->get_battery_level = (arg->get_battery_level != NULL) ? arg->get_battery_level : defaultBatteryLevel;
+    self->config.ticks = arg->ticks;
+    self->config.rand = (arg->rand != NULL) ? arg->rand : defaultRand;
+    self->config.get_battery_level = (arg->get_battery_level != NULL) ? arg->get_battery_level : defaultBatteryLevel;
 
-    self->app = arg->app;
-    self->handler = (arg->handler != NULL) ? arg->handler : dummyResponseHandler;
+    self->config.app = arg->app;
+    self->config.handler = (arg->handler != NULL) ? arg->handler : dummyResponseHandler;
 
-    self->radio = arg->radio;
-    self->radio_interface = arg->radio_interface;
-
-    self->sm = arg->sm;
-    self->sm_interface = arg->sm_interface;
+    self->config.radio = arg->radio;
+#ifndef LDL_FIXED_RADIO
+    self->config.radio_interface = arg->radio_interface;
+#endif
 
-    self->devNonce = arg->devNonce;
-    self->joinNonce = arg->joinNonce;
+    self->config.sm = arg->sm;
+    self->config.sm_interface = arg->sm_interface;
 
     if(arg->devEUI != NULL){
 
-        (void)memcpy(self->devEUI, arg->devEUI, sizeof(self->devEUI));
+        (void)memcpy(self->config.devEUI, arg->devEUI, sizeof(self->config.devEUI));
     }
 
     if(arg->joinEUI != NULL){
 
-        (void)memcpy(self->joinEUI, arg->joinEUI, sizeof(self->joinEUI));
+        (void)memcpy(self->config.joinEUI, arg->joinEUI, sizeof(self->config.joinEUI));
     }
+#endif
+
+    LDL_PEDANTIC(LDL_MAC_CONFIG(self)->ticks != NULL)
+#ifdef LDL_FIXED_RADIO
+    LDL_PEDANTIC(LDL_MAC_CONFIG(self)->radio != NULL)
+    LDL_PEDANTIC(LDL_MAC_CONFIG(self)->radio->type == LDL_FIXED_RADIO)
+#else
+    LDL_PEDANTIC(LDL_MAC_CONFIG(self)->radio_interface != NULL);
+#endif
+#ifdef LDL_FIXED_REGION
+    LDL_PEDANTIC(region == LDL_FIXED_REGION)
+#endif
+    LDL_PEDANTIC(LDL_MAC_CONFIG(self)->sm_interface != NULL);
+
+    /* 1M >= tps >= 1K */
+    LDL_PEDANTIC((GET_TPS() >= U32(1000)) && (GET_TPS() <= U32(1000000)))
+
+#ifndef LDL_PARAM_TPS
+    LDL_DIV_init(&self->tpsDiv, GET_TPS());
+#endif
+
+    self->tx.chIndex = UINT8_MAX;
+
+    self->devNonce = arg->devNonce;
+    self->joinNonce = arg->joinNonce;
 
     initSession(self, region);
 
@@ -214,10 +358,31 @@ void LDL_MAC_init(struct ldl_mac *self, enum ldl_region region, const struct ldl
 
                 (void)memcpy(&self->ctx, arg->session, sizeof(self->ctx));
 
+                /* the application already has this */
+                self->changed = 0U;
+
+                /* also honoured without LDL_ENABLE_COUNTER_GAP since the
+                 * session may have been saved by a build with it */
+                if(self->ctx.upReserved){
+
+                    /* the rest of the reserved block may have been used */
+                    self->ctx.up += U32(LDL_COUNTER_GAP);
+                    sessionChanged(self, LDL_SESSION_UP);
+
+#ifndef LDL_ENABLE_COUNTER_GAP
+                    /* this build saves every counter */
+                    self->ctx.upReserved = false;
+                    sessionChanged(self, LDL_SESSION_UP_RESERVED);
+#endif
+                    LDL_DEBUG("skipped reserved counters: up=%" PRIu32, self->ctx.up)
+                }
+
+                initChannelBands(self);
+
                 /* re-derive keys from:
                  *
                  * - root keys
-                 * - self->joinEUI
+                 * - joinEUI
                  * - self->session
                  *
                  *  */
@@ -237,10 +402,11 @@ void LDL_MAC_init(struct ldl_mac *self, enum ldl_region region, const struct ldl
     }
 
     self->band[LDL_BAND_GLOBAL] = msToTime(U32(LDL_STARTUP_DELAY));
+    self->time.changed = true;
 
-    self->time.ticks = self->ticks(self->app);
+    self->time.ticks = GET_TICKS(self);
 
-    LDL_MAC_timerSet(self, LDL_TIMER_WAITA, 0);
+    LDL_MAC_timerSet(self, LDL_TIMER_WAITA, self->time.ticks, 0);
 
     debugSession(self);
 }
@@ -258,7 +424,7 @@ enum ldl_mac_status LDL_MAC_entropy(struct ldl_mac *self)
         if(self->state == LDL_STATE_IDLE){
 
             self->state = LDL_STATE_RADIO_BOOT;
-            LDL_MAC_timerSet(self, LDL_TIMER_WAITA, 0);
+            LDL_MAC_timerSet(self, LDL_TIMER_WAITA, GET_TICKS(self), 0);
         }
 
         retval = LDL_STATUS_OK;
@@ -313,7 +479,13 @@ enum ldl_mac_status LDL_MAC_otaa(struct ldl_mac *self)
 
             self->trials = 0;
 
-            self->day = U32(60) * U32(60) * U32(24) * timeTPS;
+            /* keep the day if joining is already under way (or
+             * was imported from before a reset) */
+            if(self->day == 0U){
+
+                self->day = U32(60) * U32(60) * U32(24) * timeTPS;
+                self->time.changed = true;
+            }
 
 #if defined(LDL_ENABLE_L2_1_1)
             LDL_OPS_deriveJoinKeys(self);
@@ -324,7 +496,7 @@ enum ldl_mac_status LDL_MAC_otaa(struct ldl_mac *self)
 
             arg.dev_nonce_updated.nextDevNonce = self->devNonce;
 
-            self->handler(self->app, LDL_MAC_DEV_NONCE_UPDATED, &arg);
+            NOTIFY(self, LDL_MAC_DEV_NONCE_UPDATED, &arg);
 
             self->tx.power = 0;
 
@@ -333,7 +505,7 @@ enum ldl_mac_status LDL_MAC_otaa(struct ldl_mac *self)
             if(self->state == LDL_STATE_IDLE){
 
                 self->state = LDL_STATE_WAIT_OTAA;
-                LDL_MAC_timerSet(self, LDL_TIMER_WAITA, 0);
+                LDL_MAC_timerSet(self, LDL_TIMER_WAITA, GET_TICKS(self), 0);
             }
 
             retval = LDL_STATUS_OK;
@@ -370,8 +542,12 @@ enum ldl_mac_status LDL_MAC_abp(struct ldl_mac *self, uint32_t devAddr)
         self->ctx.joined = true;
         self->ctx.devAddr = devAddr;
 
+        sessionChanged(self, LDL_SESSION_STATE);
+        sessionChanged(self, LDL_SESSION_NETWORK);
+
         self->band[LDL_BAND_GLOBAL] = 0;
         self->day = 0;
+        self->time.changed = true;
 
         retval = LDL_STATUS_OK;
     }
@@ -398,6 +574,7 @@ void LDL_MAC_forget(struct ldl_mac *self)
     if(self->ctx.joined){
 
         self->band[LDL_BAND_GLOBAL] = 0;
+        self->time.changed = true;
 
         forgetNetwork(self);
 
@@ -422,7 +599,7 @@ void LDL_MAC_cancel(struct ldl_mac *self)
 
         /* ensure the radio will return to a useful state */
         self->state = LDL_STATE_RADIO_RESET;
-        self->radio_interface->set_mode(self->radio, LDL_RADIO_MODE_RESET);
+        RADIO_SET_MODE(self, LDL_RADIO_MODE_RESET);
         break;
 
     /* no need to touch radio in these states */
@@ -453,7 +630,7 @@ void LDL_MAC_cancel(struct ldl_mac *self)
     case LDL_OP_DATA_UNCONFIRMED:
     case LDL_OP_DATA_CONFIRMED:
 
-        self->handler(self->app, LDL_MAC_OP_CANCELLED, NULL);
+        NOTIFY(self, LDL_MAC_OP_CANCELLED, NULL);
         break;
     }
 }
@@ -464,19 +641,29 @@ void LDL_MAC_process(struct ldl_mac *self)
 
     enum ldl_mac_sme event;
     uint32_t lag = 0;
+    uint32_t now;
     bool channel_ready;
 
-    channel_ready = processBands(self);
+    /* one time snapshot for this invocation */
+    now = GET_TICKS(self);
 
-    if(inputCheck(self, &lag)){
+    channel_ready = processBands(self, now);
+
+    if(inputCheck(self, now, &lag)){
 
         event = LDL_SME_INTERRUPT;
     }
-    else if(LDL_MAC_timerCheck(self, LDL_TIMER_WAITA, &lag)){
+#ifdef LDL_ENABLE_ASYNC_SM
+    else if(smCheck(self)){
+
+        event = LDL_SME_SM;
+    }
+#endif
+    else if(LDL_MAC_timerCheck(self, LDL_TIMER_WAITA, now, &lag)){
 
         event = LDL_SME_TIMER_A;
     }
-    else if(LDL_MAC_timerCheck(self, LDL_TIMER_WAITB, &lag)){
+    else if(LDL_MAC_timerCheck(self, LDL_TIMER_WAITB, now, &lag)){
 
         event = LDL_SME_TIMER_B;
     }
@@ -499,17 +686,17 @@ void LDL_MAC_process(struct ldl_mac *self)
 
         case LDL_STATE_INIT:
 
-            processInit(self);
+            processInit(self, now);
             break;
 
         case LDL_STATE_RADIO_RESET:
 
-            processRadioReset(self, event);
+            processRadioReset(self, event, now);
             break;
 
         case LDL_STATE_RADIO_BOOT:
 
-            processRadioBoot(self, event);
+            processRadioBoot(self, event, now);
             break;
 
         case LDL_STATE_WAIT_ENTROPY:
@@ -522,53 +709,63 @@ void LDL_MAC_process(struct ldl_mac *self)
 
         case LDL_STATE_START_RADIO_FOR_ENTROPY:
 
-            processStartRadioForEntropy(self, event);
+            processStartRadioForEntropy(self, event, now);
             break;
 
         case LDL_STATE_ENTROPY:
 
-            processEntropy(self, event);
+            processEntropy(self, event, now);
             break;
 
         case LDL_STATE_WAIT_OTAA:
 
-            processWaitOTAA(self, event);
+            processWaitOTAA(self, event, now);
             break;
 
         case LDL_STATE_START_RADIO_FOR_TX:
 
-            processStartRadioForTX(self, event);
+            processStartRadioForTX(self, event, now);
             break;
 
         case LDL_STATE_TX:
 
-            processTX(self, event, lag);
+            processTX(self, event, now, lag);
             break;
 
         case LDL_STATE_START_RADIO_FOR_RX1:
 
-            processStartRadioForRX1(self, event, lag);
+            processStartRadioForRX1(self, event, now, lag);
             break;
 
         case LDL_STATE_START_RADIO_FOR_RX2:
 
-            processStartRadioForRX2(self, event, lag);
+            processStartRadioForRX2(self, event, now, lag);
             break;
 
         case LDL_STATE_RX1:
         case LDL_STATE_RX2:
 
-            processRX(self, event);
+            processRX(self, event, now);
             break;
 
         case LDL_STATE_RX2_LOCKOUT:
 
-            processRX2Lockout(self, event);
+            processRX2Lockout(self, event, now);
             break;
+#ifdef LDL_ENABLE_ASYNC_SM
+        case LDL_STATE_WAIT_SM:
+
+            processWaitSM(self, event, now);
+            break;
+#endif
         }
     }
 
-    setNextBandEvent(self);
+    /* counting down doesn't move the next band event */
+    if(self->time.changed){
+
+        setNextBandEvent(self, now);
+    }
 }
 
 uint32_t LDL_MAC_ticksUntilNextEvent(const struct ldl_mac *self)
@@ -577,8 +774,12 @@ uint32_t LDL_MAC_ticksUntilNextEvent(const struct ldl_mac *self)
 
     uint32_t retval = 0U;
 
-    if(!inputPending(self)){
-
+#ifdef LDL_ENABLE_ASYNC_SM
+    if(!inputPending(self) && !smPending(self))
+#else
+    if(!inputPending(self))
+#endif
+    {
         retval = LDL_MAC_timerTicksUntilNext(self);
     }
 
@@ -591,10 +792,11 @@ enum ldl_mac_status LDL_MAC_setRate(struct ldl_mac *self, uint8_t rate)
 
     enum ldl_mac_status retval;
 
-    if(rateSettingIsValid(self->ctx.region, rate)){
+    if(rateSettingIsValid(GET_REGION(), rate)){
 
         self->ctx.rate = rate;
 
+        sessionChanged(self, LDL_SESSION_TX);
         pushSessionUpdate(self);
 
         retval = LDL_STATUS_OK;
@@ -620,10 +822,11 @@ enum ldl_mac_status LDL_MAC_setPower(struct ldl_mac *self, uint8_t power)
 
     enum ldl_mac_status retval;
 
-    if(LDL_Region_validateTXPower(self->ctx.region, power)){
+    if(LDL_Region_validateTXPower(GET_REGION(), power)){
 
         self->ctx.power = power;
 
+        sessionChanged(self, LDL_SESSION_TX);
         pushSessionUpdate(self);
 
         retval = LDL_STATUS_OK;
@@ -649,6 +852,7 @@ void LDL_MAC_setADR(struct ldl_mac *self, bool value)
 
     self->ctx.adr = value;
 
+    sessionChanged(self, LDL_SESSION_STATE);
     pushSessionUpdate(self);
 }
 
@@ -675,7 +879,7 @@ bool LDL_MAC_ready(const struct ldl_mac *self)
 
 void LDL_MAC_radioEvent(struct ldl_mac *self)
 {
-    LDL_MAC_radioEventWithTicks(self, self->ticks(self->app));
+    LDL_MAC_radioEventWithTicks(self, GET_TICKS(self));
 }
 
 void LDL_MAC_radioEventWithTicks(struct ldl_mac *self, uint32_t ticks)
@@ -685,6 +889,20 @@ void LDL_MAC_radioEventWithTicks(struct ldl_mac *self, uint32_t ticks)
     inputSignal(self, ticks);
 }
 
+#ifdef LDL_ENABLE_ASYNC_SM
+void LDL_MAC_smEvent(struct ldl_mac *self, uint32_t mic)
+{
+    LDL_PEDANTIC(self != NULL)
+
+    /* published like an input event so no critical section is required */
+    self->async.mic = mic;
+
+    LDL_SYSTEM_BARRIER()
+
+    self->async.state = true;
+}
+#endif
+
 uint8_t LDL_MAC_mtu(const struct ldl_mac *self)
 {
     LDL_PEDANTIC(self != NULL)
@@ -699,9 +917,9 @@ uint8_t LDL_MAC_mtu(const struct ldl_mac *self)
     uint8_t rate = self->ctx.rate;
     uint32_t freq;
 
-    for(i=0; i<LDL_Region_numChannels(self->ctx.region); i++){
+    for(i=0; i<LDL_Region_numChannels(GET_REGION()); i++){
 
-        if(!channelIsMasked(self->ctx.chMask, sizeof(self->ctx.chMask), self->ctx.region, U8(i))){
+        if(!channelIsMasked(self->ctx.chMask, sizeof(self->ctx.chMask), GET_REGION(), U8(i))){
 
             if(getChannel(self, U8(i), &freq, &min_rate, &max_rate)){
 
@@ -713,7 +931,7 @@ uint8_t LDL_MAC_mtu(const struct ldl_mac *self)
         }
     }
 
-    LDL_Region_convertRate(self->ctx.region, rate, &sf, &bw, &max);
+    LDL_Region_convertRate(GET_REGION(), rate, &sf, &bw, &max);
 
     LDL_PEDANTIC(LDL_Frame_dataOverhead() < max)
 
@@ -748,6 +966,7 @@ void LDL_MAC_setMaxDCycle(struct ldl_mac *self, uint8_t maxDCycle)
     self->maxDutyCycle = maxDCycle & 0xfU;
     self->ctx.maxDutyCycle = self->maxDutyCycle;
 
+    sessionChanged(self, LDL_SESSION_TX);
     pushSessionUpdate(self);
 }
 
@@ -771,101 +990,185 @@ bool LDL_MAC_maskChannel(struct ldl_mac *self, uint8_t chIndex)
 {
     LDL_PEDANTIC(self != NULL)
 
+    bool retval;
+    bool masked;
+
     LDL_DEBUG("mask chIndex=%u", chIndex)
 
-    return maskChannel(self->ctx.chMask, sizeof(self->ctx.chMask), self->ctx.region, chIndex);
+    masked = channelIsMasked(self->ctx.chMask, sizeof(self->ctx.chMask), GET_REGION(), chIndex);
+
+    retval = maskChannel(self->ctx.chMask, sizeof(self->ctx.chMask), GET_REGION(), chIndex);
+
+    /* only flag a real change */
+    if(retval && !masked){
+
+        sessionChanged(self, LDL_SESSION_CH_MASK);
+    }
+
+    return retval;
 }
 
 bool LDL_MAC_unmaskChannel(struct ldl_mac *self, uint8_t chIndex)
 {
     LDL_PEDANTIC(self != NULL)
 
+    bool retval;
+    bool masked;
+
     LDL_DEBUG("unmask chIndex=%u", chIndex)
 
-    return unmaskChannel(self->ctx.chMask, sizeof(self->ctx.chMask), self->ctx.region, chIndex);
+    masked = channelIsMasked(self->ctx.chMask, sizeof(self->ctx.chMask), GET_REGION(), chIndex);
+
+    retval = unmaskChannel(self->ctx.chMask, sizeof(self->ctx.chMask), GET_REGION(), chIndex);
+
+    /* only flag a real change */
+    if(retval && masked){
+
+        sessionChanged(self, LDL_SESSION_CH_MASK);
+    }
+
+    return retval;
+}
+
+bool LDL_MAC_selectChannel(const struct ldl_mac *self, uint8_t desired_rate, uint32_t limit, struct ldl_mac_tx *tx)
+{
+    LDL_PEDANTIC(self != NULL)
+    LDL_PEDANTIC(tx != NULL)
+
+    bool retval = false;
+    uint8_t mask[sizeof(self->ctx.chMask)];
+    uint8_t available;
+    uint8_t chIndex;
+    uint8_t minRate;
+    uint8_t maxRate;
+    size_t i;
+    size_t j;
+
+    (void)memset(mask, 0, sizeof(mask));
+
+    /* channels in bands that are ready by limit... */
+    for(i=0U; i < U8(LDL_BAND_GLOBAL); i++){
+
+        if(self->band[i] <= limit){
+
+            for(j=0U; j < sizeof(mask); j++){
+
+                mask[j] |= self->chBand[i][j];
+            }
+        }
+    }
+
+    /* ...that have not been masked */
+    for(j=0U; j < sizeof(mask); j++){
+
+        mask[j] &= U8(~self->ctx.chMask[j]);
+    }
+
+    available = countChannels(mask, sizeof(mask));
+
+    /* avoid the last channel if there is a choice */
+    if(available > 1U){
+
+        if(channelIsMasked(mask, sizeof(mask), GET_REGION(), self->tx.chIndex)){
+
+            (void)unmaskChannel(mask, sizeof(mask), GET_REGION(), self->tx.chIndex);
+            available--;
+        }
+    }
+
+    if(available > 0U){
+
+        chIndex = nthChannel(mask, sizeof(mask), U8(GET_RAND(self) % available));
+
+        if(getChannel(self, chIndex, &tx->freq, &minRate, &maxRate)){
+
+            tx->chIndex = chIndex;
+            tx->rate = requiredRate(desired_rate, minRate, maxRate);
+
+            retval = true;
+        }
+    }
+
+    return retval;
 }
 
-void LDL_MAC_timerSet(struct ldl_mac *self, enum ldl_timer_inst timer, uint32_t timeout)
+void LDL_MAC_timerSet(struct ldl_mac *self, enum ldl_timer_inst timer, uint32_t now, uint32_t timeout)
 {
-    LDL_SYSTEM_ENTER_CRITICAL(self->app)
+    TIMER_ENTER_CRITICAL(GET_APP(self))
 
-    self->timers[timer].time = self->ticks(self->app) + (timeout & U32(INT32_MAX));
+    self->timers[timer].time = now + (timeout & U32(INT32_MAX));
     self->timers[timer].armed = true;
 
-    LDL_SYSTEM_LEAVE_CRITICAL(self->app)
+    updateNextTimer(self);
+
+    TIMER_LEAVE_CRITICAL(GET_APP(self))
 }
 
 void LDL_MAC_timerAppend(struct ldl_mac *self, enum ldl_timer_inst timer, uint32_t timeout)
 {
-    LDL_SYSTEM_ENTER_CRITICAL(self->app)
+    TIMER_ENTER_CRITICAL(GET_APP(self))
 
     self->timers[timer].time += (timeout & U32(INT32_MAX));
     self->timers[timer].armed = true;
 
-    LDL_SYSTEM_LEAVE_CRITICAL(self->app)
+    updateNextTimer(self);
+
+    TIMER_LEAVE_CRITICAL(GET_APP(self))
 }
 
-bool LDL_MAC_timerCheck(struct ldl_mac *self, enum ldl_timer_inst timer, uint32_t *lag)
+bool LDL_MAC_timerCheck(struct ldl_mac *self, enum ldl_timer_inst timer, uint32_t now, uint32_t *lag)
 {
     bool retval = false;
-    uint32_t time;
 
-    LDL_SYSTEM_ENTER_CRITICAL(self->app)
+    TIMER_ENTER_CRITICAL(GET_APP(self))
 
     if(self->timers[timer].armed){
 
-        time = self->ticks(self->app);
-
-        if(timerDelta(self->timers[timer].time, time) < U32(INT32_MAX)){
+        if(timerDelta(self->timers[timer].time, now) < U32(INT32_MAX)){
 
             self->timers[timer].armed = false;
-            *lag = timerDelta(self->timers[timer].time, time);
+            *lag = timerDelta(self->timers[timer].time, now);
             retval = true;
+
+            updateNextTimer(self);
         }
     }
 
-    LDL_SYSTEM_LEAVE_CRITICAL(self->app)
+    TIMER_LEAVE_CRITICAL(GET_APP(self))
 
     return retval;
 }
 
 void LDL_MAC_timerClear(struct ldl_mac *self, enum ldl_timer_inst timer)
 {
+    TIMER_ENTER_CRITICAL(GET_APP(self))
+
     self->timers[timer].armed = false;
+
+    updateNextTimer(self);
+
+    TIMER_LEAVE_CRITICAL(GET_APP(self))
 }
 
 uint32_t LDL_MAC_timerTicksUntilNext(const struct ldl_mac *self)
 {
-    size_t i;
     uint32_t retval = UINT32_MAX;
     uint32_t time;
+    struct ldl_timer next;
 
-    time = self->ticks(self->app);
-
-    for(i=0U; i < sizeof(self->timers)/sizeof(*self->timers); i++){
-
-        LDL_SYSTEM_ENTER_CRITICAL(self->app)
+    readNextTimer(self, &next);
 
-        if(self->timers[i].armed){
-
-            if(timerDelta(self->timers[i].time, time) <= U32(INT32_MAX)){
+    if(next.armed){
 
-                retval = 0U;
-            }
-            else{
+        time = GET_TICKS(self);
 
-                if(timerDelta(time, self->timers[i].time) < retval){
+        if(timerDelta(next.time, time) <= U32(INT32_MAX)){
 
-                    retval = timerDelta(time, self->timers[i].time);
-                }
-            }
+            retval = 0U;
         }
+        else{
 
-        LDL_SYSTEM_LEAVE_CRITICAL(self->app)
-
-        if(retval == 0U){
-
-            break;
+            retval = timerDelta(time, next.time);
         }
     }
 
@@ -877,11 +1180,11 @@ uint32_t LDL_MAC_timerTicksUntil(const struct ldl_mac *self, enum ldl_timer_inst
     uint32_t retval = UINT32_MAX;
     uint32_t time;
 
-    LDL_SYSTEM_ENTER_CRITICAL(self->app)
+    TIMER_ENTER_CRITICAL(GET_APP(self))
 
     if(self->timers[timer].armed){
 
-        time = self->ticks(self->app);
+        time = GET_TICKS(self);
 
         *lag = timerDelta(self->timers[timer].time, time);
 
@@ -895,7 +1198,7 @@ uint32_t LDL_MAC_timerTicksUntil(const struct ldl_mac *self, enum ldl_timer_inst
         }
     }
 
-    LDL_SYSTEM_LEAVE_CRITICAL(self->app)
+    TIMER_LEAVE_CRITICAL(GET_APP(self))
 
     return retval;
 }
@@ -905,21 +1208,37 @@ bool LDL_MAC_priority(const struct ldl_mac *self, uint8_t interval)
     LDL_PEDANTIC(self != NULL)
 
     bool retval;
+    uint32_t limit;
+    uint32_t lag;
 
-    /* todo */
-    (void)interval;
+    /* saturates at the timer horizon */
+    limit = (U32(interval) > LDL_DIV_divide(GET_TPS_DIV(), U32(INT32_MAX))) ? U32(INT32_MAX) : (U32(interval) * GET_TPS());
 
     switch(self->state){
     default:
+        /* everything else can be handled late since the RX windows
+         * are timed from when TX actually completes */
         retval = false;
         break;
+    case LDL_STATE_START_RADIO_FOR_TX:
     case LDL_STATE_TX:
-    case LDL_STATE_WAIT_RX1:
+    case LDL_STATE_START_RADIO_FOR_RX1:
     case LDL_STATE_RX1:
-    case LDL_STATE_WAIT_RX2:
+    case LDL_STATE_START_RADIO_FOR_RX2:
     case LDL_STATE_RX2:
+        /* waiting on the radio */
         retval = true;
         break;
+    case LDL_STATE_WAIT_OTAA:
+    case LDL_STATE_WAIT_TX:
+        /* waitA is when the band and day counters release the uplink */
+        retval = (LDL_MAC_timerTicksUntil(self, LDL_TIMER_WAITA, &lag) <= limit);
+        break;
+    case LDL_STATE_WAIT_RX1:
+    case LDL_STATE_WAIT_RX2:
+        /* waitA opens RX1 and waitB opens RX2 */
+        retval = (LDL_MAC_timerTicksUntil(self, LDL_TIMER_WAITA, &lag) <= limit) || (LDL_MAC_timerTicksUntil(self, LDL_TIMER_WAITB, &lag) <= limit);
+        break;
     }
 
     return retval;
@@ -929,7 +1248,7 @@ uint32_t LDL_MAC_getTicks(struct ldl_mac *self)
 {
     LDL_PEDANTIC(self != NULL)
 
-    return self->ticks(self->app);
+    return GET_TICKS(self);
 }
 
 #ifdef LDL_ENABLE_TEST_MODE
@@ -955,111 +1274,184 @@ bool LDL_MAC_getAckPending(const struct ldl_mac *self)
     return self->pendingACK;
 }
 
+void LDL_MAC_saveCounters(struct ldl_mac *self)
+{
+    LDL_PEDANTIC(self != NULL)
+
+#ifdef LDL_ENABLE_COUNTER_GAP
+    if(self->ctx.upReserved){
+
+        self->ctx.upReserved = false;
+
+        sessionChanged(self, LDL_SESSION_UP);
+        sessionChanged(self, LDL_SESSION_UP_RESERVED);
+    }
+#endif
+
+    pushSessionUpdate(self);
+}
+
+void LDL_MAC_exportBands(const struct ldl_mac *self, struct ldl_mac_band_state *state)
+{
+    LDL_PEDANTIC(self != NULL)
+    LDL_PEDANTIC(state != NULL)
+
+    (void)memcpy(state->band, self->band, sizeof(state->band));
+    state->day = self->day;
+}
+
+void LDL_MAC_importBands(struct ldl_mac *self, const struct ldl_mac_band_state *state, uint32_t elapsed)
+{
+    LDL_PEDANTIC(self != NULL)
+    LDL_PEDANTIC(state != NULL)
+
+    uint32_t time;
+    size_t i;
+
+    /* saturate rather than wrap */
+    time = (elapsed < (UINT32_MAX / timeTPS)) ? (elapsed * timeTPS) : UINT32_MAX;
+
+    for(i=0U; i < sizeof(self->band)/sizeof(*self->band); i++){
+
+        self->band[i] = state->band[i];
+        (void)updateDownCounter(&self->band[i], time);
+    }
+
+    self->day = state->day;
+    (void)updateDownCounter(&self->day, time);
+
+    self->time.changed = true;
+
+    LDL_DEBUG("bands imported: elapsed=%" PRIu32 " global=%" PRIu32 " day=%" PRIu32, elapsed, self->band[LDL_BAND_GLOBAL], self->day)
+}
+
+bool LDL_MAC_getSessionField(enum ldl_mac_session_field field, size_t *offset, size_t *size)
+{
+    LDL_PEDANTIC(offset != NULL)
+    LDL_PEDANTIC(size != NULL)
+
+    bool retval;
+
+    if(field < LDL_SESSION_FIELD_MAX){
+
+        *offset = sessionFieldStart[field];
+        *size = sessionFieldStart[field + 1] - sessionFieldStart[field];
+
+        retval = true;
+    }
+    else{
+
+        retval = false;
+    }
+
+    return retval;
+}
+
 /* static functions ***************************************************/
 
-static void processInit(struct ldl_mac *self)
+static void processInit(struct ldl_mac *self, uint32_t now)
 {
     self->state = LDL_STATE_RADIO_RESET;
 
-    self->radio_interface->set_mode(self->radio, LDL_RADIO_MODE_RESET);
+    RADIO_SET_MODE(self, LDL_RADIO_MODE_RESET);
 
     /* >100us */
-    LDL_MAC_timerSet(self, LDL_TIMER_WAITA, GET_TPS()/U32(1024));
+    LDL_MAC_timerSet(self, LDL_TIMER_WAITA, now, GET_TPS()/U32(1024));
 
     LDL_DEBUG("set radio reset: ticks=%" PRIu32 "",
-        self->ticks(self->app)
+        now
     )
 }
 
-static void processRadioReset(struct ldl_mac *self, enum ldl_mac_sme event)
+static void processRadioReset(struct ldl_mac *self, enum ldl_mac_sme event, uint32_t now)
 {
     if(event == LDL_SME_TIMER_A){
 
         self->state = LDL_STATE_RADIO_BOOT;
-        self->radio_interface->set_mode(self->radio, LDL_RADIO_MODE_BOOT);
+        RADIO_SET_MODE(self, LDL_RADIO_MODE_BOOT);
 
         /* >5ms to startup */
-        LDL_MAC_timerSet(self, LDL_TIMER_WAITA, GET_TPS()/U32(128));
+        LDL_MAC_timerSet(self, LDL_TIMER_WAITA, now, GET_TPS()/U32(128));
 
         LDL_DEBUG("clear radio reset: ticks=%" PRIu32 "",
-            self->ticks(self->app)
+            now
         )
     }
 }
 
-static void processRadioBoot(struct ldl_mac *self, enum ldl_mac_sme event)
+static void processRadioBoot(struct ldl_mac *self, enum ldl_mac_sme event, uint32_t now)
 {
     if(event == LDL_SME_TIMER_A){
 
         switch(self->op){
         case LDL_OP_ENTROPY:
 
-            self->radio_interface->set_mode(self->radio, LDL_RADIO_MODE_SLEEP);
+            RADIO_SET_MODE(self, LDL_RADIO_MODE_SLEEP);
             self->state = LDL_STATE_WAIT_ENTROPY;
-            LDL_MAC_timerSet(self, LDL_TIMER_WAITA, 0);
+            LDL_MAC_timerSet(self, LDL_TIMER_WAITA, now, 0);
             break;
 
         case LDL_OP_JOINING:
 
-            self->radio_interface->set_mode(self->radio, LDL_RADIO_MODE_SLEEP);
+            RADIO_SET_MODE(self, LDL_RADIO_MODE_SLEEP);
             self->state = LDL_STATE_WAIT_OTAA;
-            LDL_MAC_timerSet(self, LDL_TIMER_WAITA, 0);
+            LDL_MAC_timerSet(self, LDL_TIMER_WAITA, now, 0);
             break;
 
         case LDL_OP_DATA_CONFIRMED:
         case LDL_OP_DATA_UNCONFIRMED:
 
-            self->radio_interface->set_mode(self->radio, LDL_RADIO_MODE_SLEEP);
+            RADIO_SET_MODE(self, LDL_RADIO_MODE_SLEEP);
             self->state = LDL_STATE_WAIT_TX;
-            LDL_MAC_timerSet(self, LDL_TIMER_WAITA, 0);
+            LDL_MAC_timerSet(self, LDL_TIMER_WAITA, now, 0);
             break;
 
         default:
-            self->radio_interface->set_mode(self->radio, LDL_RADIO_MODE_SLEEP);
+            RADIO_SET_MODE(self, LDL_RADIO_MODE_SLEEP);
             self->state = LDL_STATE_IDLE;
             break;
         }
     }
 }
 
-static void processStartRadioForEntropy(struct ldl_mac *self, enum ldl_mac_sme event)
+static void processStartRadioForEntropy(struct ldl_mac *self, enum ldl_mac_sme event, uint32_t now)
 {
     if(event == LDL_SME_TIMER_A){
 
-        self->radio_interface->receive_entropy(self->radio);
+        RADIO_RECEIVE_ENTROPY(self);
 
         self->state = LDL_STATE_ENTROPY;
 
         /* ~1ms */
-        LDL_MAC_timerSet(self, LDL_TIMER_WAITA, GET_TPS()/U32(1024));
+        LDL_MAC_timerSet(self, LDL_TIMER_WAITA, now, GET_TPS()/U32(1024));
 
-        LDL_DEBUG("listen for entropy: ticks=%" PRIu32 "", self->ticks(self->app))
+        LDL_DEBUG("listen for entropy: ticks=%" PRIu32 "", now)
     }
 }
 
-static void processEntropy(struct ldl_mac *self, enum ldl_mac_sme event)
+static void processEntropy(struct ldl_mac *self, enum ldl_mac_sme event, uint32_t now)
 {
     union ldl_mac_response_arg arg;
 
     if(event == LDL_SME_TIMER_A){
 
-        arg.entropy.value = self->radio_interface->read_entropy(self->radio);
+        arg.entropy.value = RADIO_READ_ENTROPY(self);
 
-        self->radio_interface->set_mode(self->radio, LDL_RADIO_MODE_SLEEP);
+        RADIO_SET_MODE(self, LDL_RADIO_MODE_SLEEP);
 
         self->state = LDL_STATE_IDLE;
         self->op = LDL_OP_NONE;
 
         LDL_DEBUG("read entropy: ticks=%" PRIu32 " entropy=%" PRIu32 "",
-            self->ticks(self->app),
+            now,
             arg.entropy.value
         )
 
-        self->handler(self->app, LDL_MAC_ENTROPY, &arg);
+        NOTIFY(self, LDL_MAC_ENTROPY, &arg);
     }
 }
 
-static void processWaitOTAA(struct ldl_mac *self, enum ldl_mac_sme event)
+static void processWaitOTAA(struct ldl_mac *self, enum ldl_mac_sme event, uint32_t now)
 {
     uint32_t delay;
 
@@ -1068,23 +1460,23 @@ static void processWaitOTAA(struct ldl_mac *self, enum ldl_mac_sme event)
     if(self->band[LDL_BAND_GLOBAL] == 0U){
 
 #ifdef LDL_ENABLE_OTAA_DITHER
-        if(self->otaaDither > 0U){
+        if(LDL_MAC_CONFIG(self)->otaaDither > 0U){
 
-            delay = self->rand(self->app) % (GET_TPS()*U32(self->otaaDither));
+            delay = GET_RAND(self) % (GET_TPS()*U32(LDL_MAC_CONFIG(self)->otaaDither));
         }
         else{
 
             delay = 0;
         }
 #else
-        delay = self->rand(self->app) % (GET_TPS()*U32(30));
+        delay = GET_RAND(self) % (GET_TPS()*U32(30));
 #endif
         LDL_DEBUG("add dither to otaa: ticks=%" PRIu32 " delay=%" PRIu32 "",
-            self->ticks(self->app),
+            now,
             delay
         )
 
-        LDL_MAC_timerSet(self, LDL_TIMER_WAITA, delay);
+        LDL_MAC_timerSet(self, LDL_TIMER_WAITA, now, delay);
         self->state = LDL_STATE_WAIT_TX;
     }
 }
@@ -1104,22 +1496,22 @@ static void processWait(struct ldl_mac *self, enum ldl_mac_sme event, uint32_t l
         default:
         case LDL_STATE_WAIT_TX:
             self->state = LDL_STATE_START_RADIO_FOR_TX;
-            self->radio_interface->set_mode(self->radio, LDL_RADIO_MODE_TX);
+            RADIO_SET_MODE(self, LDL_RADIO_MODE_TX);
             timer = LDL_TIMER_WAITA;
             break;
         case LDL_STATE_WAIT_RX1:
             self->state = LDL_STATE_START_RADIO_FOR_RX1;
-            self->radio_interface->set_mode(self->radio, LDL_RADIO_MODE_RX);
+            RADIO_SET_MODE(self, LDL_RADIO_MODE_RX);
             timer = LDL_TIMER_WAITA;
             break;
         case LDL_STATE_WAIT_RX2:
             self->state = LDL_STATE_START_RADIO_FOR_RX2;
-            self->radio_interface->set_mode(self->radio, LDL_RADIO_MODE_RX);
+            RADIO_SET_MODE(self, LDL_RADIO_MODE_RX);
             timer = LDL_TIMER_WAITB;
             break;
         case LDL_STATE_WAIT_ENTROPY:
             self->state = LDL_STATE_START_RADIO_FOR_ENTROPY;
-            self->radio_interface->set_mode(self->radio, LDL_RADIO_MODE_RX);
+            RADIO_SET_MODE(self, LDL_RADIO_MODE_RX);
             timer = LDL_TIMER_WAITA;
             break;
         }
@@ -1129,7 +1521,7 @@ static void processWait(struct ldl_mac *self, enum ldl_mac_sme event, uint32_t l
         LDL_MAC_timerAppend(self, timer, delay);
 #if 0
         LDL_DEBUG("start xtal: ticks=%" PRIu32 " delay=%" PRIu32 "",
-            self->ticks(self->app),
+            GET_TICKS(self),
             delay
         )
 #endif
@@ -1141,20 +1533,19 @@ static void processWait(struct ldl_mac *self, enum ldl_mac_sme event, uint32_t l
     }
 }
 
-static void processStartRadioForTX(struct ldl_mac *self, enum ldl_mac_sme event)
+static void processStartRadioForTX(struct ldl_mac *self, enum ldl_mac_sme event, uint32_t now)
 {
     struct ldl_radio_tx_setting setting;
     uint8_t mtu;
-    uint32_t ms;
 
     if(event == LDL_SME_TIMER_A){
 
-        LDL_Region_convertRate(self->ctx.region, self->tx.rate, &setting.sf, &setting.bw, &mtu);
+        LDL_Region_convertRate(GET_REGION(), self->tx.rate, &setting.sf, &setting.bw, &mtu);
 
-        setting.eirp = LDL_Region_getTXPower(self->ctx.region, self->tx.power);
+        setting.eirp = LDL_Region_getTXPower(GET_REGION(), self->tx.power);
 
 #ifndef LDL_DISABLE_TX_PARAM_SETUP
-        if(LDL_Region_txParamSetupImplemented(self->ctx.region)){
+        if(LDL_Region_txParamSetupImplemented(GET_REGION())){
 
             static const int8_t maxEIRP[] = {
                 8,
@@ -1187,22 +1578,23 @@ static void processStartRadioForTX(struct ldl_mac *self, enum ldl_mac_sme event)
 #endif
         setting.freq = self->tx.freq;
 
-        ms = LDL_Radio_getAirTime(setting.bw, setting.sf, self->bufferLen, true);
+        self->tx.airTime = LDL_Radio_getAirTimeTicks(setting.bw, setting.sf, self->bufferLen, true, timeTPS);
 
-        self->tx.airTime = msToTime(ms);
+        /* keep the remaining divisions out of TX complete */
+        planRXWindows(self);
 
         inputArm(self);
 
-        self->radio_interface->transmit(self->radio, &setting, self->buffer, self->bufferLen);
+        RADIO_TRANSMIT(self, &setting, self->buffer, self->bufferLen);
 
         self->state = LDL_STATE_TX;
 
         /* reset the radio if the tx complete interrupt doesn't appear after double the expected time */
-        LDL_MAC_timerSet(self, LDL_TIMER_WAITA, msToTicks(self, ms) << 1);
+        LDL_MAC_timerSet(self, LDL_TIMER_WAITA, now, LDL_Radio_getAirTimeTicks(setting.bw, setting.sf, self->bufferLen, true, GET_TPS()) << 1);
 
         LDL_INFO("tx begin")
         LDL_DEBUG("ticks=%" PRIu32 " freq=%" PRIu32 " power=%u  bw=%" PRIu32 " sf=%u size=%u",
-            self->ticks(self->app),
+            now,
             self->tx.freq,
             self->tx.power,
             LDL_Radio_bwToNumber(setting.bw),
@@ -1212,27 +1604,20 @@ static void processStartRadioForTX(struct ldl_mac *self, enum ldl_mac_sme event)
     }
 }
 
-static void processTX(struct ldl_mac *self, enum ldl_mac_sme event, uint32_t lag)
+static void processTX(struct ldl_mac *self, enum ldl_mac_sme event, uint32_t now, uint32_t lag)
 {
     uint32_t waitSeconds;
     uint32_t waitTicks;
     uint32_t advance;
     uint32_t advanceA;
     uint32_t advanceB;
-    enum ldl_spreading_factor sf;
-    enum ldl_signal_bandwidth bw;
-    uint8_t rate;
-    uint32_t extra_symbols;
-    uint32_t xtal_error;
-    uint8_t mtu;
-    uint32_t margin;
     struct ldl_radio_status status;
 
     (void)memset(&status, 0, sizeof(status));
 
     if(event == LDL_SME_INTERRUPT){
 
-        self->radio_interface->get_status(self->radio, &status);
+        RADIO_GET_STATUS(self, &status);
     }
 
     if((event == LDL_SME_INTERRUPT) || (event == LDL_SME_TIMER_A)){
@@ -1248,74 +1633,41 @@ static void processTX(struct ldl_mac *self, enum ldl_mac_sme event, uint32_t lag
     if(event == LDL_SME_TIMER_A){
 
         LDL_ERROR("interrupt fault")
-        LDL_DEBUG("ticks=%" PRIu32 "", self->ticks(self->app))
-        handleRadioError(self);
+        LDL_DEBUG("ticks=%" PRIu32 "", now)
+        handleRadioError(self, now);
     }
     else if((event == LDL_SME_INTERRUPT) && !status.tx){
 
         LDL_ERROR("unexpected status")
-        LDL_DEBUG("ticks=%" PRIu32 "", self->ticks(self->app))
-        handleRadioError(self);
+        LDL_DEBUG("ticks=%" PRIu32 "", now)
+        handleRadioError(self, now);
     }
     else if((event == LDL_SME_INTERRUPT) && status.tx){
 
         self->pendingACK = false;
 
         /* the wait interval is always measured in whole seconds */
-        waitSeconds = (self->op == LDL_OP_JOINING) ? U32(LDL_Region_getJA1Delay(self->ctx.region)) : U32(self->ctx.rx1Delay);
+        waitSeconds = (self->op == LDL_OP_JOINING) ? U32(LDL_Region_getJA1Delay(GET_REGION())) : U32(self->ctx.rx1Delay);
 
         /* the ideal interval measured in ticks */
         waitTicks = waitSeconds * GET_TPS();
 
 #ifndef LDL_DISABLE_DEVICE_TIME
-        self->ticks_at_tx = self->ticks(self->app) - lag;
+        self->ticks_at_tx = now - lag;
 #endif
         advance = GET_ADVANCE() + lag + msToTicks(self, LDL_PARAM_XTAL_DELAY);
 
-        /* RX1 */
-        {
-            LDL_Region_getRX1DataRate(self->ctx.region, self->tx.rate, self->ctx.rx1DROffset, &rate);
-            LDL_Region_convertRate(self->ctx.region, rate, &sf, &bw, &mtu);
-
-            xtal_error = (waitSeconds * GET_A() * U32(2)) + GET_B();
-
-            extra_symbols = extraSymbols(xtal_error, symbolPeriod(GET_TPS(), sf, bw));
-
-            /* we need a minimum of 3 extra symbols */
-            extra_symbols = (extra_symbols < U32(3)) ? U32(3) : extra_symbols;
-
-            margin = extra_symbols * symbolPeriod(GET_TPS(), sf, bw);
-            self->rx1_symbols = U16(5) + U16(extra_symbols);
-
-            /* advance timer by time required for extra symbols */
-            advanceA = advance + (margin/U32(2));
-        }
-
-        /* RX2 */
-        {
-            LDL_Region_convertRate(self->ctx.region, self->ctx.rx2DataRate, &sf, &bw, &mtu);
-
-            xtal_error += (GET_A() * U32(2));
-
-            extra_symbols = extraSymbols(xtal_error, symbolPeriod(GET_TPS(), sf, bw));
-
-            /* we need a minimum of 3 extra symbols */
-            extra_symbols = (extra_symbols < U32(3)) ? U32(3) : extra_symbols;
-
-            margin = extra_symbols * symbolPeriod(GET_TPS(), sf, bw);
-            self->rx2_symbols = U16(5) + U16(extra_symbols);
-
-            /* advance timer by time required for extra symbols */
-            advanceB = advance + (margin/U32(2));
-        }
+        /* advance timers by time required for extra symbols (see planRXWindows()) */
+        advanceA = advance + self->rx1_margin;
+        advanceB = advance + self->rx2_margin;
 
         if(advanceB <= (waitTicks + GET_TPS())){
 
-            LDL_MAC_timerSet(self, LDL_TIMER_WAITB, waitTicks + GET_TPS() - advanceB);
+            LDL_MAC_timerSet(self, LDL_TIMER_WAITB, now, waitTicks + GET_TPS() - advanceB);
 
             if(advanceA <= waitTicks){
 
-                LDL_MAC_timerSet(self, LDL_TIMER_WAITA, waitTicks - advanceA);
+                LDL_MAC_timerSet(self, LDL_TIMER_WAITA, now, waitTicks - advanceA);
                 self->state = LDL_STATE_WAIT_RX1;
             }
             else{
@@ -1328,14 +1680,14 @@ static void processTX(struct ldl_mac *self, enum ldl_mac_sme event, uint32_t lag
 
             self->state = LDL_STATE_WAIT_RX2;
             LDL_MAC_timerClear(self, LDL_TIMER_WAITA);
-            LDL_MAC_timerSet(self, LDL_TIMER_WAITB, 0U);
+            LDL_MAC_timerSet(self, LDL_TIMER_WAITB, now, 0U);
             self->state = LDL_STATE_WAIT_RX2;
         }
 
-        self->radio_interface->set_mode(self->radio, LDL_RADIO_MODE_HOLD);
+        RADIO_SET_MODE(self, LDL_RADIO_MODE_HOLD);
 
         LDL_INFO("tx complete")
-        LDL_DEBUG("ticks=%" PRIu32 "", self->ticks(self->app))
+        LDL_DEBUG("ticks=%" PRIu32 "", now)
     }
     else{
 
@@ -1343,7 +1695,7 @@ static void processTX(struct ldl_mac *self, enum ldl_mac_sme event, uint32_t lag
     }
 }
 
-static void processStartRadioForRX1(struct ldl_mac *self, enum ldl_mac_sme event, uint32_t lag)
+static void processStartRadioForRX1(struct ldl_mac *self, enum ldl_mac_sme event, uint32_t now, uint32_t lag)
 {
     struct ldl_radio_rx_setting setting;
     uint32_t freq;
@@ -1353,10 +1705,10 @@ static void processStartRadioForRX1(struct ldl_mac *self, enum ldl_mac_sme event
 
     if(event == LDL_SME_TIMER_A){
 
-        LDL_Region_getRX1DataRate(self->ctx.region, self->tx.rate, self->ctx.rx1DROffset, &rate);
-        LDL_Region_getRX1Freq(self->ctx.region, self->tx.freq, self->tx.chIndex, &freq);
+        LDL_Region_getRX1DataRate(GET_REGION(), self->tx.rate, self->ctx.rx1DROffset, &rate);
+        LDL_Region_getRX1Freq(GET_REGION(), self->tx.freq, self->tx.chIndex, &freq);
 
-        LDL_Region_convertRate(self->ctx.region, rate, &setting.sf, &setting.bw, &setting.max);
+        LDL_Region_convertRate(GET_REGION(), rate, &setting.sf, &setting.bw, &setting.max);
 
         setting.max += LDL_Frame_phyOverhead();
 
@@ -1367,14 +1719,14 @@ static void processStartRadioForRX1(struct ldl_mac *self, enum ldl_mac_sme event
 
         inputArm(self);
 
-        self->radio_interface->receive(self->radio, &setting);
+        RADIO_RECEIVE(self, &setting);
 
         /* use waitA as a guard (timeout after ~4 seconds) */
-        LDL_MAC_timerSet(self, LDL_TIMER_WAITA, (GET_TPS() + GET_A()) << 2U);
+        LDL_MAC_timerSet(self, LDL_TIMER_WAITA, now, (GET_TPS() + GET_A()) << 2U);
 
         LDL_INFO("rx1 slot")
         LDL_DEBUG("ticks=%" PRIu32 " timeout=%" PRIu16 " lag=%" PRIu32 " freq=%" PRIu32 " bw=%" PRIu32 " sf=%u",
-            self->ticks(self->app),
+            now,
             self->rx1_symbols,
             lag,
             freq,
@@ -1384,13 +1736,13 @@ static void processStartRadioForRX1(struct ldl_mac *self, enum ldl_mac_sme event
     }
 }
 
-static void processStartRadioForRX2(struct ldl_mac *self, enum ldl_mac_sme event, uint32_t lag)
+static void processStartRadioForRX2(struct ldl_mac *self, enum ldl_mac_sme event, uint32_t now, uint32_t lag)
 {
     struct ldl_radio_rx_setting setting;
 
     if(event == LDL_SME_TIMER_B){
 
-        LDL_Region_convertRate(self->ctx.region, self->ctx.rx2DataRate, &setting.sf, &setting.bw, &setting.max);
+        LDL_Region_convertRate(GET_REGION(), self->ctx.rx2DataRate, &setting.sf, &setting.bw, &setting.max);
 
         setting.max += LDL_Frame_phyOverhead();
 
@@ -1401,14 +1753,14 @@ static void processStartRadioForRX2(struct ldl_mac *self, enum ldl_mac_sme event
 
         inputArm(self);
 
-        self->radio_interface->receive(self->radio, &setting);
+        RADIO_RECEIVE(self, &setting);
 
         /* use waitA as a guard */
-        LDL_MAC_timerSet(self, LDL_TIMER_WAITA, (GET_TPS() + GET_A()) * 4U);
+        LDL_MAC_timerSet(self, LDL_TIMER_WAITA, now, (GET_TPS() + GET_A()) * 4U);
 
         LDL_INFO("rx2 slot")
         LDL_DEBUG("ticks=%" PRIu32 " timeout=%" PRIu16 " lag=%" PRIu32 " freq=%" PRIu32 " bw=%" PRIu32 " sf=%u",
-            self->ticks(self->app),
+            now,
             self->rx2_symbols,
             lag,
             self->ctx.rx2Freq,
@@ -1418,10 +1770,12 @@ static void processStartRadioForRX2(struct ldl_mac *self, enum ldl_mac_sme event
     }
 }
 
-static void processRX(struct ldl_mac *self, enum ldl_mac_sme event)
+static void processRX(struct ldl_mac *self, enum ldl_mac_sme event, uint32_t now)
 {
     struct ldl_frame_down frame;
-#ifdef LDL_ENABLE_STATIC_RX_BUFFER
+#if defined(LDL_ENABLE_SINGLE_BUFFER)
+    uint8_t *buffer = self->buffer;
+#elif defined(LDL_ENABLE_STATIC_RX_BUFFER)
     uint8_t *buffer = self->rx_buffer;
 #else
     uint8_t buffer[LDL_MAX_PACKET];
@@ -1431,8 +1785,6 @@ static void processRX(struct ldl_mac *self, enum ldl_mac_sme event)
     uint8_t mtu;
     enum ldl_spreading_factor sf;
     enum ldl_signal_bandwidth bw;
-    union ldl_mac_response_arg arg;
-    uint32_t ms;
 
     struct ldl_radio_status status;
 
@@ -1440,227 +1792,246 @@ static void processRX(struct ldl_mac *self, enum ldl_mac_sme event)
 
     if(event == LDL_SME_INTERRUPT){
 
-        self->radio_interface->get_status(self->radio, &status);
+        RADIO_GET_STATUS(self, &status);
     }
 
     if(event == LDL_SME_TIMER_A){
 
         LDL_ERROR("interrupt fault")
-        LDL_DEBUG("ticks=%" PRIu32 "", self->ticks(self->app))
+        LDL_DEBUG("ticks=%" PRIu32 "", now)
 
-        self->radio_interface->get_status(self->radio, &status);
+        RADIO_GET_STATUS(self, &status);
 
-        handleRadioError(self);
+        handleRadioError(self, now);
     }
     else if((event == LDL_SME_INTERRUPT) && !status.rx && !status.timeout){
 
         LDL_ERROR("unexpected status")
-        LDL_DEBUG("ticks=%" PRIu32 "", self->ticks(self->app))
+        LDL_DEBUG("ticks=%" PRIu32 "", now)
 
-        handleRadioError(self);
+        handleRadioError(self, now);
     }
     else if((event == LDL_SME_INTERRUPT) && status.rx){
 
         LDL_MAC_timerClear(self, LDL_TIMER_WAITA);
         LDL_MAC_timerClear(self, LDL_TIMER_WAITB);
 
-        len = self->radio_interface->read_buffer(self->radio, &meta, buffer, LDL_MAX_PACKET);
+        len = RADIO_READ_BUFFER(self, &meta, buffer, LDL_MAX_PACKET);
 
-        self->radio_interface->set_mode(self->radio, LDL_RADIO_MODE_SLEEP);
+        RADIO_SET_MODE(self, LDL_RADIO_MODE_SLEEP);
 
         self->rx_snr = meta.snr;
 
         LDL_DEBUG("downlink: ticks=%" PRIu32 " rssi=%d snr=%d size=%u",
-            self->ticks(self->app),
+            now,
             meta.rssi,
             meta.snr,
             len
         )
 
+#ifdef LDL_ENABLE_ASYNC_SM
+        if(smAvailable(self) && LDL_OPS_beginReceiveFrame(self, buffer, len)){
+
+            self->async.op = LDL_SM_OP_RX;
+            self->async.len = len;
+            self->async.busy = true;
+            self->state = LDL_STATE_WAIT_SM;
+        }
+        else
+#endif
         if(LDL_OPS_receiveFrame(self, &frame, buffer, len)){
 
-            switch(frame.type){
-            default:
-            case FRAME_TYPE_JOIN_ACCEPT:
+            processDownlink(self, &frame, now);
+        }
+        else{
 
-                self->ctx.joined = true;
+            downlinkMissingHandler(self, now);
+        }
+    }
+    else if((event == LDL_SME_INTERRUPT) && status.timeout){
 
-                /* keep the joining rate */
-                self->ctx.rate = self->ctx.adr ? LDL_Region_getJoinRate(self->ctx.region, self->trials) : self->ctx.rate;
+        if(self->state == LDL_STATE_RX2){
 
-                self->ctx.rx1DROffset = frame.rx1DataRateOffset;
-                self->ctx.rx2DataRate = frame.rx2DataRate;
-                self->ctx.rx1Delay = frame.rxDelay;
+            RADIO_SET_MODE(self, LDL_RADIO_MODE_SLEEP);
 
-                if(frame.cfList != NULL){
+            LDL_MAC_timerClear(self, LDL_TIMER_WAITB);
 
-                    LDL_Region_processCFList(self->ctx.region, self, frame.cfList, frame.cfListLen);
-                }
+            LDL_Region_convertRate(GET_REGION(), self->tx.rate, &sf, &bw, &mtu);
 
-                self->ctx.devAddr = frame.devAddr;
+            LDL_MAC_timerSet(self, LDL_TIMER_WAITA, now, LDL_Radio_getAirTimeTicks(bw, sf, mtu, false, GET_TPS()));
 
-#if defined(LDL_ENABLE_L2_1_1)
-                self->ctx.version = (frame.optNeg) ? 1U : 0U;
+            self->state = LDL_STATE_RX2_LOCKOUT;
+        }
+        else{
 
-                if(SESS_VERSION(self->ctx) > 0U){
+            RADIO_SET_MODE(self, LDL_RADIO_MODE_HOLD);
 
-                    setPendingCommand(self, LDL_CMD_REKEY);
-                }
-#endif
-                /* cache this so that the session keys can be re-derived */
-                self->ctx.netID = frame.netID;
-                self->ctx.joinNonce = frame.joinNonce;
-                /* self->ctx.devNonce is already set */
+            LDL_MAC_timerClear(self, LDL_TIMER_WAITA);
 
-                self->joinNonce = frame.joinNonce;
+            self->state = LDL_STATE_WAIT_RX2;
+        }
+    }
+    else{
 
-                LDL_OPS_deriveKeys(self);
+        /* nothing */
+    }
+}
 
-                self->joinNonce++;
+static void processRX2Lockout(struct ldl_mac *self, enum ldl_mac_sme event, uint32_t now)
+{
+    if(event == LDL_SME_TIMER_A){
 
-                LDL_INFO("join accept: joinNonce=%" PRIu32 " devNonce=%" PRIu16 " netID=%" PRIu32 " devAddr=%" PRIu32 " rx1Delay=%u",
-                    self->ctx.joinNonce,
-                    self->ctx.devNonce,
-                    self->ctx.netID,
-                    self->ctx.devAddr,
-                    self->ctx.rx1Delay
-                )
+        downlinkMissingHandler(self, now);
+    }
+}
 
-                self->band[LDL_BAND_GLOBAL] = 0;
-                self->day = 0;
-                self->state = LDL_STATE_IDLE;
-                self->op = LDL_OP_NONE;
+static void processDownlink(struct ldl_mac *self, const struct ldl_frame_down *frame, uint32_t now)
+{
+    union ldl_mac_response_arg arg;
 
-                arg.join_complete.joinNonce = self->joinNonce;
-                arg.join_complete.netID = self->ctx.netID;
-                arg.join_complete.devAddr = self->ctx.devAddr;
+    switch(frame->type){
+    default:
+    case FRAME_TYPE_JOIN_ACCEPT:
 
-                self->handler(self->app, LDL_MAC_JOIN_COMPLETE, &arg);
-                break;
+        /* most of the session is replaced */
+        self->changed = U16(LDL_SESSION_ALL);
 
-            case FRAME_TYPE_DATA_CONFIRMED_DOWN:
-            case FRAME_TYPE_DATA_UNCONFIRMED_DOWN:
+        self->ctx.joined = true;
 
-                /* if set it means network has more data to send */
-                self->fPending = frame.pending;
+        /* keep the joining rate */
+        self->ctx.rate = self->ctx.adr ? LDL_Region_getJoinRate(GET_REGION(), self->trials) : self->ctx.rate;
 
-                self->pendingACK = (frame.type == FRAME_TYPE_DATA_CONFIRMED_DOWN);
+        self->ctx.rx1DROffset = frame->rx1DataRateOffset;
+        self->ctx.rx2DataRate = frame->rx2DataRate;
+        self->ctx.rx1Delay = frame->rxDelay;
 
-                LDL_OPS_syncDownCounter(self, frame.port, frame.counter);
+        if(frame->cfList != NULL){
 
-                clearPendingCommand(self, LDL_CMD_RX_PARAM_SETUP);
-                clearPendingCommand(self, LDL_CMD_DL_CHANNEL);
-                clearPendingCommand(self, LDL_CMD_RX_TIMING_SETUP);
+            LDL_Region_processCFList(GET_REGION(), self, frame->cfList, frame->cfListLen);
+        }
 
-                self->adrAckCounter = 0;
-                self->adrAckReq = false;
+        self->ctx.devAddr = frame->devAddr;
 
-                if(frame.opts != NULL){
+#if defined(LDL_ENABLE_L2_1_1)
+        self->ctx.version = (frame->optNeg) ? 1U : 0U;
 
-                    processCommands(self, frame.opts, frame.optsLen);
-                }
+        if(SESS_VERSION(self->ctx) > 0U){
 
-                if(frame.data != NULL){
+            setPendingCommand(self, LDL_CMD_REKEY);
+        }
+#endif
+        /* cache this so that the session keys can be re-derived */
+        self->ctx.netID = frame->netID;
+        self->ctx.joinNonce = frame->joinNonce;
+        /* self->ctx.devNonce is already set */
 
-                    if(frame.port == 0U){
+        self->joinNonce = frame->joinNonce;
 
-                        processCommands(self, frame.data, frame.dataLen);
-                    }
-                    else{
+        LDL_OPS_deriveKeys(self);
 
-                        arg.rx.port = frame.port;
-                        arg.rx.data = frame.data;
-                        arg.rx.size = frame.dataLen;
+        self->joinNonce++;
 
-                        self->handler(self->app, LDL_MAC_RX, &arg);
-                    }
-                }
+        LDL_INFO("join accept: joinNonce=%" PRIu32 " devNonce=%" PRIu16 " netID=%" PRIu32 " devAddr=%" PRIu32 " rx1Delay=%u",
+            self->ctx.joinNonce,
+            self->ctx.devNonce,
+            self->ctx.netID,
+            self->ctx.devAddr,
+            self->ctx.rx1Delay
+        )
 
-                switch(self->op){
-                default:
-                case LDL_OP_DATA_UNCONFIRMED:
+        self->band[LDL_BAND_GLOBAL] = 0;
+        self->day = 0;
+        self->time.changed = true;
+        self->state = LDL_STATE_IDLE;
+        self->op = LDL_OP_NONE;
 
-                    self->handler(self->app, LDL_MAC_DATA_COMPLETE, NULL);
-                    break;
+        arg.join_complete.joinNonce = self->joinNonce;
+        arg.join_complete.netID = self->ctx.netID;
+        arg.join_complete.devAddr = self->ctx.devAddr;
 
-                case LDL_OP_DATA_CONFIRMED:
+        NOTIFY(self, LDL_MAC_JOIN_COMPLETE, &arg);
+        break;
 
-                    if(frame.ack){
+    case FRAME_TYPE_DATA_CONFIRMED_DOWN:
+    case FRAME_TYPE_DATA_UNCONFIRMED_DOWN:
 
-                        self->handler(self->app, LDL_MAC_DATA_COMPLETE, NULL);
-                    }
-                    else{
+        /* if set it means network has more data to send */
+        self->fPending = frame->pending;
 
-                        LDL_DEBUG("NAK received in response to confirmed uplink")
-
-                        /* I don't see how this would ever happen
-                         * in practice since downlinks are sent
-                         * in response to having receied an uplink.
-                         *
-                         * For this reason simply handle it as a timeout
-                         * regardless of the number of attempts requested.
-                         *
-                         *  */
-                        self->handler(self->app, LDL_MAC_DATA_TIMEOUT, NULL);
-                    }
-                    break;
+        self->pendingACK = (frame->type == FRAME_TYPE_DATA_CONFIRMED_DOWN);
 
-                case LDL_OP_REJOINING:
-                    break;
-                }
+        LDL_OPS_syncDownCounter(self, frame->port, frame->counter);
 
-                self->state = LDL_STATE_IDLE;
-                self->op = LDL_OP_NONE;
-                break;
-            }
+        clearPendingCommand(self, LDL_CMD_RX_PARAM_SETUP);
+        clearPendingCommand(self, LDL_CMD_DL_CHANNEL);
+        clearPendingCommand(self, LDL_CMD_RX_TIMING_SETUP);
 
-            pushSessionUpdate(self);
-        }
-        else{
+        self->adrAckCounter = 0;
+        self->adrAckReq = false;
+
+        if(frame->opts != NULL){
 
-            downlinkMissingHandler(self);
+            processCommands(self, frame->opts, frame->optsLen, now);
         }
-    }
-    else if((event == LDL_SME_INTERRUPT) && status.timeout){
 
-        if(self->state == LDL_STATE_RX2){
+        if(frame->data != NULL){
 
-            self->radio_interface->set_mode(self->radio, LDL_RADIO_MODE_SLEEP);
+            if(frame->port == 0U){
 
-            LDL_MAC_timerClear(self, LDL_TIMER_WAITB);
+                processCommands(self, frame->data, frame->dataLen, now);
+            }
+            else{
 
-            LDL_Region_convertRate(self->ctx.region, self->tx.rate, &sf, &bw, &mtu);
+                arg.rx.port = frame->port;
+                arg.rx.data = frame->data;
+                arg.rx.size = frame->dataLen;
 
-            ms = LDL_Radio_getAirTime(bw, sf, mtu, false);
+                NOTIFY(self, LDL_MAC_RX, &arg);
+            }
+        }
 
-            LDL_MAC_timerSet(self, LDL_TIMER_WAITA, msToTicks(self, ms));
+        switch(self->op){
+        default:
+        case LDL_OP_DATA_UNCONFIRMED:
 
-            self->state = LDL_STATE_RX2_LOCKOUT;
-        }
-        else{
+            NOTIFY(self, LDL_MAC_DATA_COMPLETE, NULL);
+            break;
 
-            self->radio_interface->set_mode(self->radio, LDL_RADIO_MODE_HOLD);
+        case LDL_OP_DATA_CONFIRMED:
 
-            LDL_MAC_timerClear(self, LDL_TIMER_WAITA);
+            if(frame->ack){
 
-            self->state = LDL_STATE_WAIT_RX2;
-        }
-    }
-    else{
+                NOTIFY(self, LDL_MAC_DATA_COMPLETE, NULL);
+            }
+            else{
 
-        /* nothing */
-    }
-}
+                LDL_DEBUG("NAK received in response to confirmed uplink")
 
-static void processRX2Lockout(struct ldl_mac *self, enum ldl_mac_sme event)
-{
-    if(event == LDL_SME_TIMER_A){
+                /* I don't see how this would ever happen
+                 * in practice since downlinks are sent
+                 * in response to having receied an uplink.
+                 *
+                 * For this reason simply handle it as a timeout
+                 * regardless of the number of attempts requested.
+                 *
+                 *  */
+                NOTIFY(self, LDL_MAC_DATA_TIMEOUT, NULL);
+            }
+            break;
 
-        downlinkMissingHandler(self);
+        case LDL_OP_REJOINING:
+            break;
+        }
+
+        self->state = LDL_STATE_IDLE;
+        self->op = LDL_OP_NONE;
+        break;
     }
+
+    pushSessionUpdate(self);
 }
 
-static void handleRadioError(struct ldl_mac *self)
+static void handleRadioError(struct ldl_mac *self, uint32_t now)
 {
     inputDisarm(self);
     LDL_MAC_timerClear(self, LDL_TIMER_WAITA);
@@ -1673,7 +2044,7 @@ static void handleRadioError(struct ldl_mac *self)
     case LDL_OP_DATA_UNCONFIRMED:
     case LDL_OP_ENTROPY:
         self->op = LDL_OP_NONE;
-        self->handler(self->app, LDL_MAC_OP_ERROR, NULL);
+        NOTIFY(self, LDL_MAC_OP_ERROR, NULL);
         break;
 
     case LDL_OP_JOINING:
@@ -1682,17 +2053,17 @@ static void handleRadioError(struct ldl_mac *self)
          * to setup the next channel
          *
          * */
-        downlinkMissingHandler(self);
+        downlinkMissingHandler(self, now);
         break;
     }
 
 
     self->state = LDL_STATE_RADIO_RESET;
 
-    self->radio_interface->set_mode(self->radio, LDL_RADIO_MODE_RESET);
+    RADIO_SET_MODE(self, LDL_RADIO_MODE_RESET);
 
     /* >100us */
-    LDL_MAC_timerSet(self, LDL_TIMER_WAITA, (GET_TPS()/U32(1024)));
+    LDL_MAC_timerSet(self, LDL_TIMER_WAITA, now, (GET_TPS()/U32(1024)));
 
 
     LDL_DEBUG("radio fault detected, initiating radio reset")
@@ -1707,7 +2078,13 @@ static enum ldl_mac_status externalDataCommand(struct ldl_mac *self, bool confir
     enum ldl_spreading_factor sf;
     struct ldl_frame_data f;
     struct ldl_stream s;
+#ifdef LDL_ENABLE_SINGLE_BUFFER
+    uint8_t *macs = self->retryMacs;
+    const uint8_t macsMax = U8(sizeof(self->retryMacs));
+#else
     uint8_t macs[30]; // large enough for all possible MAC commands
+    const uint8_t macsMax = U8(sizeof(macs));
+#endif
     size_t desired_len = len + (size_t)LDL_Frame_dataOverhead();
 
     if(self->ctx.joined){
@@ -1723,11 +2100,11 @@ static enum ldl_mac_status externalDataCommand(struct ldl_mac *self, bool confir
 #ifdef LDL_DISABLE_TX_PARAM_SETUP
                     self->tx.rate = self->ctx.rate;
 #else
-                    self->tx.rate = LDL_Region_applyUplinkDwell(self->ctx.region, uplinkDwell(self->ctx.tx_param_setup), self->ctx.rate);
+                    self->tx.rate = LDL_Region_applyUplinkDwell(GET_REGION(), uplinkDwell(self->ctx.tx_param_setup), self->ctx.rate);
 #endif
-                    if(selectChannel(self, self->ctx.rate, 0U, &self->tx)){
+                    if(LDL_MAC_selectChannel(self, self->ctx.rate, 0U, &self->tx)){
 
-                        LDL_Region_convertRate(self->ctx.region, self->ctx.rate, &sf, &bw, &maxPayload);
+                        LDL_Region_convertRate(GET_REGION(), self->ctx.rate, &sf, &bw, &maxPayload);
 
                         if(desired_len <= (size_t)maxPayload){
 
@@ -1762,10 +2139,11 @@ static enum ldl_mac_status externalDataCommand(struct ldl_mac *self, bool confir
                             self->tx.counter = self->ctx.up;
 
                             self->ctx.up++;
+                            upCounterChanged(self);
 
                             /* serialise pending MAC commands */
 
-                            LDL_Stream_init(&s, macs, U8(sizeof(macs)));
+                            LDL_Stream_init(&s, macs, macsMax);
 
                             LDL_DEBUG("preparing data frame")
 
@@ -1784,22 +2162,33 @@ static enum ldl_mac_status externalDataCommand(struct ldl_mac *self, bool confir
 #endif
                             if(commandIsPending(self, LDL_CMD_RX_PARAM_SETUP)){
 
-                                LDL_MAC_putRXParamSetupAns(&s, &self->ctx.rx_param_setup_ans);
+                                struct ldl_rx_param_setup_ans ans = {
+                                    .rx1DROffsetOK = getAnswer(self, LDL_ANS_RX_PARAM_RX1_DR_OFFSET),
+                                    .rx2DataRateOK = getAnswer(self, LDL_ANS_RX_PARAM_RX2_RATE),
+                                    .channelOK = getAnswer(self, LDL_ANS_RX_PARAM_CHANNEL)
+                                };
+
+                                LDL_MAC_putRXParamSetupAns(&s, &ans);
 
                                 LDL_DEBUG("adding rx_param_setup_ans: rx1DROffsetOK=%s rx2DataRate=%s rx2Freq=%s",
-                                    self->ctx.rx_param_setup_ans.rx1DROffsetOK ? "true" : "false",
-                                    self->ctx.rx_param_setup_ans.rx2DataRateOK ? "true" : "false",
-                                    self->ctx.rx_param_setup_ans.channelOK ? "true" : "false"
+                                    getAnswer(self, LDL_ANS_RX_PARAM_RX1_DR_OFFSET) ? "true" : "false",
+                                    getAnswer(self, LDL_ANS_RX_PARAM_RX2_RATE) ? "true" : "false",
+                                    getAnswer(self, LDL_ANS_RX_PARAM_CHANNEL) ? "true" : "false"
                                 )
                             }
 
                             if(commandIsPending(self, LDL_CMD_DL_CHANNEL)){
 
-                                LDL_MAC_putDLChannelAns(&s, &self->ctx.dl_channel_ans);
+                                struct ldl_dl_channel_ans ans = {
+                                    .uplinkFreqOK = getAnswer(self, LDL_ANS_DL_CHANNEL_UPLINK_FREQ),
+                                    .channelFreqOK = getAnswer(self, LDL_ANS_DL_CHANNEL_FREQ)
+                                };
+
+                                LDL_MAC_putDLChannelAns(&s, &ans);
 
                                 LDL_DEBUG("adding dl_channel_ans: uplinkFreqOK=%s channelFreqOK=%s",
-                                    self->ctx.dl_channel_ans.uplinkFreqOK ? "true" : "false",
-                                    self->ctx.dl_channel_ans.channelFreqOK ? "true" : "false"
+                                    getAnswer(self, LDL_ANS_DL_CHANNEL_UPLINK_FREQ) ? "true" : "false",
+                                    getAnswer(self, LDL_ANS_DL_CHANNEL_FREQ) ? "true" : "false"
                                 )
                             }
 
@@ -1813,13 +2202,19 @@ static enum ldl_mac_status externalDataCommand(struct ldl_mac *self, bool confir
 
                             if(commandIsPending(self, LDL_CMD_LINK_ADR)){
 
-                                LDL_MAC_putLinkADRAns(&s, &self->ctx.link_adr_ans);
+                                struct ldl_link_adr_ans ans = {
+                                    .powerOK = getAnswer(self, LDL_ANS_LINK_ADR_POWER),
+                                    .dataRateOK = getAnswer(self, LDL_ANS_LINK_ADR_RATE),
+                                    .channelMaskOK = getAnswer(self, LDL_ANS_LINK_ADR_MASK)
+                                };
+
+                                LDL_MAC_putLinkADRAns(&s, &ans);
                                 clearPendingCommand(self, LDL_CMD_LINK_ADR);
 
                                 LDL_DEBUG("adding link_adr_ans: dataRateOK=%s powerOK=%s channelMaskOK=%s",
-                                    self->ctx.link_adr_ans.dataRateOK ? "true" : "false",
-                                    self->ctx.link_adr_ans.powerOK ? "true" : "false",
-                                    self->ctx.link_adr_ans.channelMaskOK ? "true" : "false"
+                                    getAnswer(self, LDL_ANS_LINK_ADR_RATE) ? "true" : "false",
+                                    getAnswer(self, LDL_ANS_LINK_ADR_POWER) ? "true" : "false",
+                                    getAnswer(self, LDL_ANS_LINK_ADR_MASK) ? "true" : "false"
                                 )
                             }
 
@@ -1836,22 +2231,31 @@ static enum ldl_mac_status externalDataCommand(struct ldl_mac *self, bool confir
 
                             if(commandIsPending(self, LDL_CMD_NEW_CHANNEL)){
 
-                                LDL_MAC_putNewChannelAns(&s, &self->ctx.new_channel_ans);
+                                struct ldl_new_channel_ans ans = {
+                                    .dataRateRangeOK = getAnswer(self, LDL_ANS_NEW_CHANNEL_RATE),
+                                    .channelFreqOK = getAnswer(self, LDL_ANS_NEW_CHANNEL_FREQ)
+                                };
+
+                                LDL_MAC_putNewChannelAns(&s, &ans);
                                 clearPendingCommand(self, LDL_CMD_NEW_CHANNEL);
 
                                 LDL_DEBUG("adding new_channel_ans: dataRateRangeOK=%s channelFreqOK=%s",
-                                    self->ctx.new_channel_ans.dataRateRangeOK ? "true" : "false",
-                                    self->ctx.new_channel_ans.channelFreqOK ? "true" : "false"
+                                    getAnswer(self, LDL_ANS_NEW_CHANNEL_RATE) ? "true" : "false",
+                                    getAnswer(self, LDL_ANS_NEW_CHANNEL_FREQ) ? "true" : "false"
                                 )
                             }
 #if defined(LDL_ENABLE_L2_1_1)
                             if(commandIsPending(self, LDL_CMD_REJOIN_PARAM_SETUP)){
 
-                                LDL_MAC_putRejoinParamSetupAns(&s, &self->ctx.rejoin_param_setup_ans);
+                                struct ldl_rejoin_param_setup_ans ans = {
+                                    .timeOK = getAnswer(self, LDL_ANS_REJOIN_PARAM_TIME)
+                                };
+
+                                LDL_MAC_putRejoinParamSetupAns(&s, &ans);
                                 clearPendingCommand(self, LDL_CMD_REJOIN_PARAM_SETUP);
 
                                 LDL_DEBUG("adding rejoin_param_setup_ans: timeOK=%s",
-                                    self->ctx.rejoin_param_setup_ans.timeOK ? "true" : "false"
+                                    getAnswer(self, LDL_ANS_REJOIN_PARAM_TIME) ? "true" : "false"
                                 )
                             }
 
@@ -1936,19 +2340,32 @@ static enum ldl_mac_status externalDataCommand(struct ldl_mac *self, bool confir
                             }
 
                             self->bufferLen = LDL_OPS_prepareData(self, &f, self->buffer, U8(sizeof(self->buffer)));
+#ifdef LDL_ENABLE_SINGLE_BUFFER
+                            (void)memcpy(&self->retry, &f, sizeof(self->retry));
+#endif
 
-                            LDL_OPS_micDataFrame(self, self->buffer, self->bufferLen);
+#ifdef LDL_ENABLE_ASYNC_SM
+                            /* only wait for the SM if the radio is not doing anything else */
+                            if((self->state == LDL_STATE_IDLE) && beginUplinkMIC(self, 0U, 0U)){
+
+                                LDL_DEBUG("waiting for SM")
+                            }
+                            else
+#endif
+                            {
+                                LDL_OPS_micDataFrame(self, self->buffer, self->bufferLen);
+                            }
 
                             pushSessionUpdate(self);
 
                             if(self->state == LDL_STATE_IDLE){
 
                                 self->state = LDL_STATE_WAIT_TX;
-                                LDL_MAC_timerSet(self, LDL_TIMER_WAITA, 0U);
+                                LDL_MAC_timerSet(self, LDL_TIMER_WAITA, GET_TICKS(self), 0U);
                             }
 
                             LDL_DEBUG("initiate data: ticks=%" PRIu32,
-                                self->ticks(self->app)
+                                GET_TICKS(self)
                             )
                         }
                         else{
@@ -2009,6 +2426,7 @@ static bool adaptRate(struct ldl_mac *self)
                             if(self->ctx.rate > U8(MIN_RATE)){
 
                                 self->ctx.rate--;
+                                sessionChanged(self, LDL_SESSION_TX);
                                 LDL_DEBUG("adr: rate reduced to %u", self->ctx.rate)
                             }
                             else{
@@ -2016,6 +2434,7 @@ static bool adaptRate(struct ldl_mac *self)
                                 LDL_DEBUG("adr: all channels unmasked")
 
                                 unmaskAllChannels(self->ctx.chMask, sizeof(self->ctx.chMask));
+                                sessionChanged(self, LDL_SESSION_CH_MASK);
 
                                 self->adrAckCounter = UINT8_MAX;
                             }
@@ -2024,6 +2443,7 @@ static bool adaptRate(struct ldl_mac *self)
 
                             LDL_DEBUG("adr: full power enabled")
                             self->ctx.power = 0U;
+                            sessionChanged(self, LDL_SESSION_TX);
                         }
 
                         session_changed = true;
@@ -2040,7 +2460,58 @@ static bool adaptRate(struct ldl_mac *self)
 
 static uint32_t symbolPeriod(uint32_t tps, enum ldl_spreading_factor sf, enum ldl_signal_bandwidth bw)
 {
-    return (((U32(1)) << sf) * tps) / LDL_Radio_bwToNumber(bw);
+    /* bandwidth is 125KHz << bw and floor(floor(x / y) / z) == floor(x / (y * z)) */
+    return LDL_DIV_divide(&bw125Div, ((U32(1)) << sf) * tps) >> U8(bw);
+}
+
+static void planRXWindows(struct ldl_mac *self)
+{
+    uint32_t waitSeconds;
+    enum ldl_spreading_factor sf;
+    enum ldl_signal_bandwidth bw;
+    uint8_t rate;
+    uint32_t extra_symbols;
+    uint32_t xtal_error;
+    uint8_t mtu;
+    uint32_t period;
+
+    /* the wait interval is always measured in whole seconds */
+    waitSeconds = (self->op == LDL_OP_JOINING) ? U32(LDL_Region_getJA1Delay(GET_REGION())) : U32(self->ctx.rx1Delay);
+
+    /* RX1 */
+    {
+        LDL_Region_getRX1DataRate(GET_REGION(), self->tx.rate, self->ctx.rx1DROffset, &rate);
+        LDL_Region_convertRate(GET_REGION(), rate, &sf, &bw, &mtu);
+
+        xtal_error = (waitSeconds * GET_A() * U32(2)) + GET_B();
+
+        period = symbolPeriod(GET_TPS(), sf, bw);
+
+        extra_symbols = extraSymbols(xtal_error, period);
+
+        /* we need a minimum of 3 extra symbols */
+        extra_symbols = (extra_symbols < U32(3)) ? U32(3) : extra_symbols;
+
+        self->rx1_symbols = U16(5) + U16(extra_symbols);
+        self->rx1_margin = (extra_symbols * period)/U32(2);
+    }
+
+    /* RX2 */
+    {
+        LDL_Region_convertRate(GET_REGION(), self->ctx.rx2DataRate, &sf, &bw, &mtu);
+
+        xtal_error += (GET_A() * U32(2));
+
+        period = symbolPeriod(GET_TPS(), sf, bw);
+
+        extra_symbols = extraSymbols(xtal_error, period);
+
+        /* we need a minimum of 3 extra symbols */
+        extra_symbols = (extra_symbols < U32(3)) ? U32(3) : extra_symbols;
+
+        self->rx2_symbols = U16(5) + U16(extra_symbols);
+        self->rx2_margin = (extra_symbols * period)/U32(2);
+    }
 }
 
 static uint32_t extraSymbols(uint32_t xtal_error, uint32_t symbol_period)
@@ -2048,7 +2519,7 @@ static uint32_t extraSymbols(uint32_t xtal_error, uint32_t symbol_period)
     return (xtal_error / symbol_period) + (((xtal_error % symbol_period) > 0U) ? U32(1) : U32(0));
 }
 
-static void processCommands(struct ldl_mac *self, const uint8_t *in, uint8_t len)
+static void processCommands(struct ldl_mac *self, const uint8_t *in, uint8_t len, uint32_t now)
 {
     struct ldl_stream s_in;
 
@@ -2080,7 +2551,7 @@ static void processCommands(struct ldl_mac *self, const uint8_t *in, uint8_t len
 
     LDL_Stream_initReadOnly(&s_in, in, len);
 
-    self->ctx.link_adr_ans.channelMaskOK = true;
+    setAnswer(self, LDL_ANS_LINK_ADR_MASK, true);
 
     while(LDL_MAC_getDownCommand(&s_in, &cmd)){
 
@@ -2103,7 +2574,7 @@ static void processCommands(struct ldl_mac *self, const uint8_t *in, uint8_t len
                 ans->gwCount
             )
 
-            self->handler(self->app, LDL_MAC_LINK_STATUS, &arg);
+            NOTIFY(self, LDL_MAC_LINK_STATUS, &arg);
         }
             break;
 #endif
@@ -2120,7 +2591,7 @@ static void processCommands(struct ldl_mac *self, const uint8_t *in, uint8_t len
              * blocks after the first one */
             if(!commandIsPending(self, LDL_CMD_LINK_ADR)){
 
-                if(LDL_Region_isDynamic(self->ctx.region)){
+                if(LDL_Region_isDynamic(GET_REGION())){
 
                     switch(req->channelMaskControl){
                     case 0U:
@@ -2130,11 +2601,11 @@ static void processCommands(struct ldl_mac *self, const uint8_t *in, uint8_t len
 
                             if((req->channelMask & (U16(1) << i)) > 0U){
 
-                                (void)unmaskChannel(self->ctx.chMask, sizeof(self->ctx.chMask), self->ctx.region, i);
+                                (void)unmaskChannel(self->ctx.chMask, sizeof(self->ctx.chMask), GET_REGION(), i);
                             }
                             else{
 
-                                (void)maskChannel(self->ctx.chMask, sizeof(self->ctx.chMask), self->ctx.region, i);
+                                (void)maskChannel(self->ctx.chMask, sizeof(self->ctx.chMask), GET_REGION(), i);
                             }
                         }
                         break;
@@ -2145,7 +2616,7 @@ static void processCommands(struct ldl_mac *self, const uint8_t *in, uint8_t len
                         break;
 
                     default:
-                        self->ctx.link_adr_ans.channelMaskOK = false;
+                        setAnswer(self, LDL_ANS_LINK_ADR_MASK, false);
                         break;
                     }
                 }
@@ -2162,11 +2633,11 @@ static void processCommands(struct ldl_mac *self, const uint8_t *in, uint8_t len
 
                             if(req->channelMaskControl == 6U){
 
-                                (void)unmaskChannel(self->ctx.chMask, sizeof(self->ctx.chMask), self->ctx.region, i);
+                                (void)unmaskChannel(self->ctx.chMask, sizeof(self->ctx.chMask), GET_REGION(), i);
                             }
                             else{
 
-                                (void)maskChannel(self->ctx.chMask, sizeof(self->ctx.chMask), self->ctx.region, i);
+                                (void)maskChannel(self->ctx.chMask, sizeof(self->ctx.chMask), GET_REGION(), i);
                             }
                         }
                         break;
@@ -2177,11 +2648,11 @@ static void processCommands(struct ldl_mac *self, const uint8_t *in, uint8_t len
 
                             if((req->channelMask & (U16(1) << i)) > 0U){
 
-                                (void)unmaskChannel(self->ctx.chMask, sizeof(self->ctx.chMask), self->ctx.region, (req->channelMaskControl * 16U) + i);
+                                (void)unmaskChannel(self->ctx.chMask, sizeof(self->ctx.chMask), GET_REGION(), (req->channelMaskControl * 16U) + i);
                             }
                             else{
 
-                                (void)maskChannel(self->ctx.chMask, sizeof(self->ctx.chMask), self->ctx.region, (req->channelMaskControl * 16U) + i);
+                                (void)maskChannel(self->ctx.chMask, sizeof(self->ctx.chMask), GET_REGION(), (req->channelMaskControl * 16U) + i);
                             }
                         }
                         break;
@@ -2190,8 +2661,8 @@ static void processCommands(struct ldl_mac *self, const uint8_t *in, uint8_t len
 
                 if(!LDL_MAC_peekNextCommand(&s_in, &next_cmd) || (next_cmd != LDL_CMD_LINK_ADR)){
 
-                    self->ctx.link_adr_ans.dataRateOK = true;
-                    self->ctx.link_adr_ans.powerOK = true;
+                    setAnswer(self, LDL_ANS_LINK_ADR_RATE, true);
+                    setAnswer(self, LDL_ANS_LINK_ADR_POWER, true);
 
                     /* nbTrans setting 0 means keep existing */
                     if(req->nbTrans > 0U){
@@ -2208,26 +2679,26 @@ static void processCommands(struct ldl_mac *self, const uint8_t *in, uint8_t len
                     if(req->dataRate < 0xfU){
 
                         // todo: need to pin out of range to maximum
-                        if(rateSettingIsValid(self->ctx.region, req->dataRate)){
+                        if(rateSettingIsValid(GET_REGION(), req->dataRate)){
 
                             self->ctx.rate = req->dataRate;
                         }
                         else{
 
-                            self->ctx.link_adr_ans.dataRateOK = false;
+                            setAnswer(self, LDL_ANS_LINK_ADR_RATE, false);
                         }
                     }
 
                     /* ignore power setting 15, because that means keep the current value */
                     if(req->txPower < 0xfU){
 
-                        if(LDL_Region_validateTXPower(self->ctx.region, req->txPower)){
+                        if(LDL_Region_validateTXPower(GET_REGION(), req->txPower)){
 
                             self->ctx.power = req->txPower;
                         }
                         else{
 
-                            self->ctx.link_adr_ans.powerOK = false;
+                            setAnswer(self, LDL_ANS_LINK_ADR_POWER, false);
                         }
                     }
 
@@ -2235,10 +2706,10 @@ static void processCommands(struct ldl_mac *self, const uint8_t *in, uint8_t len
                     if(allChannelsAreMasked(self->ctx.chMask, sizeof(self->ctx.chMask))){
 
                         LDL_INFO("server attempted to mask all channels")
-                        self->ctx.link_adr_ans.channelMaskOK = false;
+                        setAnswer(self, LDL_ANS_LINK_ADR_MASK, false);
                     }
 
-                    if(self->ctx.link_adr_ans.dataRateOK && self->ctx.link_adr_ans.powerOK && self->ctx.link_adr_ans.channelMaskOK){
+                    if(getAnswer(self, LDL_ANS_LINK_ADR_RATE) && getAnswer(self, LDL_ANS_LINK_ADR_POWER) && getAnswer(self, LDL_ANS_LINK_ADR_MASK)){
 
                         adr_state = _ADR_OK;
                     }
@@ -2265,6 +2736,7 @@ static void processCommands(struct ldl_mac *self, const uint8_t *in, uint8_t len
             )
 
             self->ctx.maxDutyCycle = cmd.fields.dutyCycle.maxDutyCycle;
+            sessionChanged(self, LDL_SESSION_TX);
 
             setPendingCommand(self, LDL_CMD_DUTY_CYCLE);
             break;
@@ -2285,9 +2757,12 @@ static void processCommands(struct ldl_mac *self, const uint8_t *in, uint8_t len
             self->ctx.rx2DataRate = req->rx2DataRate;
             self->ctx.rx2Freq = req->freq;
 
-            self->ctx.rx_param_setup_ans.rx1DROffsetOK = true;
-            self->ctx.rx_param_setup_ans.rx2DataRateOK = true;
-            self->ctx.rx_param_setup_ans.channelOK = true;
+            sessionChanged(self, LDL_SESSION_RX);
+            sessionChanged(self, LDL_SESSION_RX2_FREQ);
+
+            setAnswer(self, LDL_ANS_RX_PARAM_RX1_DR_OFFSET, true);
+            setAnswer(self, LDL_ANS_RX_PARAM_RX2_RATE, true);
+            setAnswer(self, LDL_ANS_RX_PARAM_CHANNEL, true);
 
             setPendingCommand(self, LDL_CMD_RX_PARAM_SETUP);
         }
@@ -2297,7 +2772,7 @@ static void processCommands(struct ldl_mac *self, const uint8_t *in, uint8_t len
         {
             LDL_DEBUG("dev_status_req")
 
-            self->ctx.dev_status_ans.battery = self->get_battery_level(self->app);
+            self->ctx.dev_status_ans.battery = GET_BATTERY_LEVEL(self);
 
             if(self->rx_snr > 31){
 
@@ -2312,6 +2787,8 @@ static void processCommands(struct ldl_mac *self, const uint8_t *in, uint8_t len
                 self->ctx.dev_status_ans.margin = (int8_t)self->rx_snr;
             }
 
+            sessionChanged(self, LDL_SESSION_STATUS);
+
             setPendingCommand(self, LDL_CMD_DEV_STATUS);
         }
             break;
@@ -2325,14 +2802,14 @@ static void processCommands(struct ldl_mac *self, const uint8_t *in, uint8_t len
                 cmd.fields.newChannel.minDR
             )
 
-            if(LDL_Region_isDynamic(self->ctx.region)){
+            if(LDL_Region_isDynamic(GET_REGION())){
 
-                self->ctx.new_channel_ans.dataRateRangeOK = LDL_Region_validateRate(self->ctx.region, cmd.fields.newChannel.chIndex, cmd.fields.newChannel.minDR, cmd.fields.newChannel.maxDR);
-                self->ctx.new_channel_ans.channelFreqOK = LDL_Region_validateFreq(self->ctx.region, cmd.fields.newChannel.freq);
+                setAnswer(self, LDL_ANS_NEW_CHANNEL_RATE, LDL_Region_validateRate(GET_REGION(), cmd.fields.newChannel.chIndex, cmd.fields.newChannel.minDR, cmd.fields.newChannel.maxDR));
+                setAnswer(self, LDL_ANS_NEW_CHANNEL_FREQ, LDL_Region_validateFreq(GET_REGION(), cmd.fields.newChannel.freq));
 
                 // todo: check if modifying default channel
 
-                if(self->ctx.new_channel_ans.dataRateRangeOK && self->ctx.new_channel_ans.channelFreqOK){
+                if(getAnswer(self, LDL_ANS_NEW_CHANNEL_RATE) && getAnswer(self, LDL_ANS_NEW_CHANNEL_FREQ)){
 
                     (void)setChannel(self, cmd.fields.newChannel.chIndex, cmd.fields.newChannel.freq, cmd.fields.newChannel.minDR, cmd.fields.newChannel.maxDR);
                 }
@@ -2353,10 +2830,10 @@ static void processCommands(struct ldl_mac *self, const uint8_t *in, uint8_t len
                 cmd.fields.dlChannel.freq
             )
 
-            if(LDL_Region_isDynamic(self->ctx.region)){
+            if(LDL_Region_isDynamic(GET_REGION())){
 
-                self->ctx.dl_channel_ans.uplinkFreqOK = true;
-                self->ctx.dl_channel_ans.channelFreqOK = LDL_Region_validateFreq(self->ctx.region, cmd.fields.dlChannel.freq);
+                setAnswer(self, LDL_ANS_DL_CHANNEL_UPLINK_FREQ, true);
+                setAnswer(self, LDL_ANS_DL_CHANNEL_FREQ, LDL_Region_validateFreq(GET_REGION(), cmd.fields.dlChannel.freq));
                 setPendingCommand(self, LDL_CMD_DL_CHANNEL);
             }
             else{
@@ -2373,6 +2850,7 @@ static void processCommands(struct ldl_mac *self, const uint8_t *in, uint8_t len
             )
 
             self->ctx.rx1Delay = cmd.fields.rxTimingSetup.delay;
+            sessionChanged(self, LDL_SESSION_RX);
 
             setPendingCommand(self, LDL_CMD_RX_TIMING_SETUP);
             break;
@@ -2386,9 +2864,10 @@ static void processCommands(struct ldl_mac *self, const uint8_t *in, uint8_t len
                 cmd.fields.txParamSetup & 0xfU
             )
 
-            if(LDL_Region_txParamSetupImplemented(self->ctx.region)){
+            if(LDL_Region_txParamSetupImplemented(GET_REGION())){
 
                 self->ctx.tx_param_setup = cmd.fields.txParamSetup;
+                sessionChanged(self, LDL_SESSION_STATUS);
 
                 setPendingCommand(self, LDL_CMD_TX_PARAM_SETUP);
             }
@@ -2409,7 +2888,7 @@ static void processCommands(struct ldl_mac *self, const uint8_t *in, uint8_t len
             arg.device_time.time <<= 8;
             arg.device_time.time |= U64(cmd.fields.deviceTime.fractions);
 
-            lag = timerDelta(self->ticks_at_tx, self->ticks(self->app));
+            lag = timerDelta(self->ticks_at_tx, now);
 
             arg.device_time.time += (U64(lag) * U64(timeTPS) / U64(GET_TPS()));
 
@@ -2421,7 +2900,7 @@ static void processCommands(struct ldl_mac *self, const uint8_t *in, uint8_t len
                 arg.device_time.fractions
             )
 
-            self->handler(self->app, LDL_MAC_DEVICE_TIME, &arg);
+            NOTIFY(self, LDL_MAC_DEVICE_TIME, &arg);
         }
             break;
 #endif
@@ -2435,6 +2914,7 @@ static void processCommands(struct ldl_mac *self, const uint8_t *in, uint8_t len
 
             self->ctx.adr_ack_limit = U16(1) << cmd.fields.adrParamSetup.limit_exp;
             self->ctx.adr_ack_delay = U16(1) << cmd.fields.adrParamSetup.delay_exp;
+            sessionChanged(self, LDL_SESSION_ADR_PARAM);
 
             setPendingCommand(self, LDL_CMD_ADR_PARAM_SETUP);
             break;
@@ -2475,7 +2955,7 @@ static void processCommands(struct ldl_mac *self, const uint8_t *in, uint8_t len
                 cmd.fields.rejoinParamSetup.maxCountN
             )
 
-            self->ctx.rejoin_param_setup_ans.timeOK = false;
+            setAnswer(self, LDL_ANS_REJOIN_PARAM_TIME, false);
             setPendingCommand(self, LDL_CMD_REJOIN_PARAM_SETUP);
             break;
 #endif
@@ -2493,6 +2973,17 @@ static void processCommands(struct ldl_mac *self, const uint8_t *in, uint8_t len
         self->ctx.power = power;
         self->ctx.nbTrans = nbTrans;
     }
+
+    /* LinkADRReq is compared rather than tracked because of the rollback */
+    if((self->ctx.rate != rate) || (self->ctx.power != power) || (self->ctx.nbTrans != nbTrans)){
+
+        sessionChanged(self, LDL_SESSION_TX);
+    }
+
+    if(memcmp(self->ctx.chMask, chMask, sizeof(chMask)) != 0){
+
+        sessionChanged(self, LDL_SESSION_CH_MASK);
+    }
 }
 
 static void registerTime(struct ldl_mac *self, const struct ldl_mac_tx *tx)
@@ -2500,11 +2991,13 @@ static void registerTime(struct ldl_mac *self, const struct ldl_mac_tx *tx)
     uint8_t band;
     uint32_t offTime;
 
-    if(LDL_Region_getBand(self->ctx.region, tx->freq, &band)){
+    self->time.changed = true;
+
+    if(LDL_Region_getBand(GET_REGION(), tx->freq, &band)){
 
         LDL_PEDANTIC( band < LDL_BAND_MAX )
 
-        offTime = tx->airTime * LDL_Region_getOffTimeFactor(self->ctx.region, band);
+        offTime = tx->airTime * LDL_Region_getOffTimeFactor(GET_REGION(), band);
 
         if((self->band[band] + offTime) < self->band[band]){
 
@@ -2572,24 +3065,24 @@ static void selectJoinChannelAndRate(struct ldl_mac *self, struct ldl_mac_tx *tx
     bool retval;
     uint8_t desired_rate;
 
-    desired_rate = LDL_Region_getJoinRate(self->ctx.region, self->trials);
+    desired_rate = LDL_Region_getJoinRate(GET_REGION(), self->trials);
 #ifndef LDL_DISABLE_TX_PARAM_SETUP
-    desired_rate = LDL_Region_applyUplinkDwell(self->ctx.region, uplinkDwell(self->ctx.tx_param_setup), desired_rate);
+    desired_rate = LDL_Region_applyUplinkDwell(GET_REGION(), uplinkDwell(self->ctx.tx_param_setup), desired_rate);
 #endif
 
     /* dynamic regions join on default channels so select as per usual */
-    if(LDL_Region_isDynamic(self->ctx.region)){
+    if(LDL_Region_isDynamic(GET_REGION())){
 
-        retval = selectChannel(self, desired_rate, timeUntilNextChannel(self), tx);
+        retval = LDL_MAC_selectChannel(self, desired_rate, timeUntilNextChannel(self), tx);
     }
     else{
 
         minRate = 0;
         maxRate = 0;
 
-        tx->chIndex = LDL_Region_getJoinIndex(self->ctx.region, self->trials, self->rand(self->app));
+        tx->chIndex = LDL_Region_getJoinIndex(GET_REGION(), self->trials, GET_RAND(self));
 
-        retval = LDL_Region_getChannel(self->ctx.region, tx->chIndex, &tx->freq, &minRate, &maxRate);
+        retval = LDL_Region_getChannel(GET_REGION(), tx->chIndex, &tx->freq, &minRate, &maxRate);
 
         tx->rate = requiredRate(desired_rate, minRate, maxRate);
     }
@@ -2600,132 +3093,94 @@ static void selectJoinChannelAndRate(struct ldl_mac *self, struct ldl_mac_tx *tx
     LDL_ASSERT(retval);
 }
 
-static bool selectChannel(const struct ldl_mac *self, uint8_t desired_rate, uint32_t limit, struct ldl_mac_tx *tx)
+static void updateChannelBand(struct ldl_mac *self, uint8_t chIndex)
 {
-    bool retval = false;
-    uint8_t i;
-    uint8_t selection;
-    uint32_t available = 0;
-    uint8_t j = 0;
+    uint32_t freq;
     uint8_t minRate;
     uint8_t maxRate;
-    uint8_t except = UINT8_MAX;
-
-    uint8_t mask[sizeof(self->ctx.chMask)];
-
-    (void)memset(mask, 0, sizeof(mask));
-
-    /* count number of available channels for this rate */
-    for(i=0; i < LDL_Region_numChannels(self->ctx.region); i++){
-
-        if(isAvailable(self, i, limit)){
-
-            if(i == self->tx.chIndex){
+    uint8_t band;
+    uint8_t i;
 
-                except = i;
-            }
+    for(i=0U; i < U8(LDL_BAND_GLOBAL); i++){
 
-            (void)maskChannel(mask, sizeof(mask), self->ctx.region, i);
-            available++;
-        }
+        (void)unmaskChannel(self->chBand[i], sizeof(self->chBand[i]), GET_REGION(), chIndex);
     }
 
-    if(available > 0U){
-
-        if(except != U8(UINT8_MAX)){
-
-            if(available == 1U){
-
-                except = UINT8_MAX;
-            }
-            else{
-
-                available--;
-            }
-        }
-
-        selection = U8(self->rand(self->app) % available);
-
-        for(i=0; i < LDL_Region_numChannels(self->ctx.region); i++){
-
-            if(channelIsMasked(mask, sizeof(mask), self->ctx.region, i)){
-
-                if(except != i){
+    if(getChannel(self, chIndex, &freq, &minRate, &maxRate)){
 
-                    if(selection == j){
+        if(freq > 0U){
 
-                        if(getChannel(self, i, &tx->freq, &minRate, &maxRate)){
+            if(LDL_Region_getBand(GET_REGION(), freq, &band)){
 
-                            tx->chIndex = i;
+                LDL_PEDANTIC( band < LDL_BAND_GLOBAL )
 
-                            tx->rate = requiredRate(desired_rate, minRate, maxRate);
-
-                            retval = true;
-                            break;
-                        }
-                    }
-
-                    j++;
-                }
+                (void)maskChannel(self->chBand[band], sizeof(self->chBand[band]), GET_REGION(), chIndex);
             }
         }
     }
-
-    return retval;
 }
 
-static bool isAvailable(const struct ldl_mac *self, uint8_t chIndex, uint32_t limit)
+static void initChannelBands(struct ldl_mac *self)
 {
-    bool retval = false;
-    uint32_t freq;
-    uint8_t minRate;
-    uint8_t maxRate;
-    uint8_t band;
+    uint8_t i;
 
-    if(!channelIsMasked(self->ctx.chMask, sizeof(self->ctx.chMask), self->ctx.region, chIndex)){
+    (void)memset(self->chBand, 0, sizeof(self->chBand));
 
-        if(getChannel(self, chIndex, &freq, &minRate, &maxRate)){
+    for(i=0U; i < LDL_Region_numChannels(GET_REGION()); i++){
 
-            if(freq > 0U){
+        updateChannelBand(self, i);
+    }
+}
 
-                if(LDL_Region_getBand(self->ctx.region, freq, &band)){
+static uint8_t countChannels(const uint8_t *mask, size_t max)
+{
+    uint8_t retval = 0U;
+    uint8_t bits;
+    size_t i;
 
-                    LDL_PEDANTIC( band < LDL_BAND_MAX )
+    for(i=0U; i < max; i++){
 
-                    if(self->band[band] <= limit){
+        /* clear the lowest set bit until none are left */
+        for(bits = mask[i]; bits > 0U; bits &= U8(bits - 1U)){
 
-                        retval = true;
-                    }
-                }
-            }
+            retval++;
         }
     }
 
     return retval;
 }
 
-static uint32_t timeUntilAvailable(const struct ldl_mac *self, uint8_t chIndex)
+static uint8_t nthChannel(const uint8_t *mask, size_t max, uint8_t n)
 {
-    uint32_t retval = UINT32_MAX;
-    uint32_t freq;
-    uint8_t minRate;
-    uint8_t maxRate;
-    uint8_t band;
+    uint8_t retval = UINT8_MAX;
+    uint8_t count;
+    uint8_t i;
+    size_t j;
+
+    for(j=0U; j < max; j++){
+
+        count = countChannels(&mask[j], 1U);
 
-    if(!channelIsMasked(self->ctx.chMask, sizeof(self->ctx.chMask), self->ctx.region, chIndex)){
+        if(n < count){
 
-        if(getChannel(self, chIndex, &freq, &minRate, &maxRate)){
+            for(i=0U; i < 8U; i++){
 
-            if(freq > 0U){
+                if((mask[j] & (1U << i)) > 0U){
 
-                if(LDL_Region_getBand(self->ctx.region, freq, &band)){
+                    if(n == 0U){
 
-                    LDL_PEDANTIC( band < LDL_BAND_MAX )
+                        retval = U8((j * 8U) + i);
+                        break;
+                    }
 
-                    retval = (self->band[band] > self->band[LDL_BAND_GLOBAL]) ? self->band[band] : self->band[LDL_BAND_GLOBAL];
+                    n--;
                 }
             }
+
+            break;
         }
+
+        n -= count;
     }
 
     return retval;
@@ -2733,9 +3188,11 @@ static uint32_t timeUntilAvailable(const struct ldl_mac *self, uint8_t chIndex)
 
 static void initSession(struct ldl_mac *self, enum ldl_region region)
 {
+    /* forgetNetwork() keeps region and uses it to reset the defaults */
+    self->ctx.region = region;
+
     forgetNetwork(self);
 
-    self->ctx.region = region;
     self->ctx.rate = MIN_RATE;
     self->ctx.power = 0U;
     self->ctx.adr = true;
@@ -2754,6 +3211,8 @@ static void forgetNetwork(struct ldl_mac *self)
 
     (void)memset(&self->ctx, 0, sizeof(self->ctx));
 
+    self->changed = U16(LDL_SESSION_ALL);
+
     /* restore the essential fields */
     self->ctx.region = region;
     self->ctx.rate = rate;
@@ -2776,7 +3235,9 @@ static void forgetNetwork(struct ldl_mac *self)
     self->ctx.maxDutyCycle = self->maxDutyCycle;
 
     /* reset the default channels (even though they shouldn't have changed!) */
-    LDL_Region_getDefaultChannels(self->ctx.region, self);
+    LDL_Region_getDefaultChannels(GET_REGION(), self);
+
+    initChannelBands(self);
 }
 
 static bool getChannel(const struct ldl_mac *self, uint8_t chIndex, uint32_t *freq, uint8_t *minRate, uint8_t *maxRate)
@@ -2786,9 +3247,9 @@ static bool getChannel(const struct ldl_mac *self, uint8_t chIndex, uint32_t *fr
 
     retval = false;
 
-    if(LDL_Region_isDynamic(self->ctx.region)){
+    if(LDL_Region_isDynamic(GET_REGION())){
 
-        if(chIndex < LDL_Region_numChannels(self->ctx.region)){
+        if(chIndex < LDL_Region_numChannels(GET_REGION())){
 
             if(chIndex < sizeof(self->ctx.chConfig)/sizeof(*self->ctx.chConfig)){
 
@@ -2804,7 +3265,7 @@ static bool getChannel(const struct ldl_mac *self, uint8_t chIndex, uint32_t *fr
     }
     else{
 
-        retval = LDL_Region_getChannel(self->ctx.region, chIndex, freq, minRate, maxRate);
+        retval = LDL_Region_getChannel(GET_REGION(), chIndex, freq, minRate, maxRate);
     }
 
     return retval;
@@ -2816,7 +3277,7 @@ static bool setChannel(struct ldl_mac *self, uint8_t chIndex, uint32_t freq, uin
 
     retval = false;
 
-    if(chIndex < LDL_Region_numChannels(self->ctx.region)){
+    if(chIndex < LDL_Region_numChannels(GET_REGION())){
 
         if(chIndex < sizeof(self->ctx.chConfig)/sizeof(*self->ctx.chConfig)){
 
@@ -2825,7 +3286,7 @@ static bool setChannel(struct ldl_mac *self, uint8_t chIndex, uint32_t freq, uin
                 self->ctx.chConfig[chIndex].freqAndRate = 0U;
                 retval = true;
             }
-            else if(LDL_Region_validateFreq(self->ctx.region, freq)){
+            else if(LDL_Region_validateFreq(GET_REGION(), freq)){
 
                 self->ctx.chConfig[chIndex].freqAndRate = ((freq/U32(100)) << 8) | (U32(minRate) << 4) | (U32(maxRate) & 0xfU);
                 retval = true;
@@ -2835,6 +3296,13 @@ static bool setChannel(struct ldl_mac *self, uint8_t chIndex, uint32_t freq, uin
                 /* not allowed */
                 LDL_ERROR("channel %" PRIu32 "Hz not allowed in this region", freq)
             }
+
+            if(retval){
+
+                sessionChanged(self, LDL_SESSION_CHANNELS);
+
+                updateChannelBand(self, chIndex);
+            }
         }
     }
 
@@ -2957,6 +3425,85 @@ static uint32_t timerDelta(uint32_t timeout, uint32_t time)
     return (timeout <= time) ? (time - timeout) : (UINT32_MAX - timeout + time);
 }
 
+static void updateNextTimer(struct ldl_mac *self)
+{
+    size_t i;
+    struct ldl_timer next = {.time = 0U, .armed = false};
+#ifdef LDL_ENABLE_ATOMIC_TIMERS
+    unsigned seq;
+#endif
+
+    for(i=0U; i < sizeof(self->timers)/sizeof(*self->timers); i++){
+
+        if(self->timers[i].armed){
+
+            /* deadlines are never more than INT32_MAX apart */
+            if(!next.armed || (timerDelta(self->timers[i].time, next.time) <= U32(INT32_MAX))){
+
+                next = self->timers[i];
+            }
+        }
+    }
+
+#ifdef LDL_ENABLE_ATOMIC_TIMERS
+    /* readers move to copy 1 while copy 0 is written, and then back
+     *
+     * only this context writes seq so it can be read relaxed */
+    seq = atomic_load_explicit(LATCH_SEQ(self), memory_order_relaxed);
+
+    /* release: the copy 1 writes of the previous update must be
+     * visible to a reader that sees this odd value and reads copy 1 */
+    atomic_store_explicit(LATCH_SEQ(self), seq + 1U, memory_order_release);
+
+    /* the odd value must be visible before any of the copy 0 writes
+     * (pairs with the acquire fence in readNextTimer()) */
+    atomic_thread_fence(memory_order_release);
+
+    atomic_store_explicit(LATCH_TIME(self, 0U), next.time, memory_order_relaxed);
+    atomic_store_explicit(LATCH_ARMED(self, 0U), next.armed, memory_order_relaxed);
+
+    /* release: copy 0 is complete before readers are sent to it */
+    atomic_store_explicit(LATCH_SEQ(self), seq + 2U, memory_order_release);
+
+    /* the even value must be visible before any of the copy 1 writes
+     * so that a reader still on copy 1 fails its seq re-check */
+    atomic_thread_fence(memory_order_release);
+
+    atomic_store_explicit(LATCH_TIME(self, 1U), next.time, memory_order_relaxed);
+    atomic_store_explicit(LATCH_ARMED(self, 1U), next.armed, memory_order_relaxed);
+#else
+    self->next = next;
+#endif
+}
+
+static void readNextTimer(const struct ldl_mac *self, struct ldl_timer *next)
+{
+#ifdef LDL_ENABLE_ATOMIC_TIMERS
+    unsigned seq;
+    unsigned copy;
+
+    /* only retries if the mainloop published while this was reading */
+    do{
+
+        /* acquire: pairs with the release stores of seq so the
+         * selected copy is complete */
+        seq = atomic_load_explicit(LATCH_SEQ(self), memory_order_acquire);
+        copy = seq & 1U;
+
+        next->time = atomic_load_explicit(LATCH_TIME(self, copy), memory_order_relaxed);
+        next->armed = atomic_load_explicit(LATCH_ARMED(self, copy), memory_order_relaxed);
+
+        /* the copy is read before seq is checked again (pairs with
+         * the release fences in updateNextTimer()) */
+        atomic_thread_fence(memory_order_acquire);
+    }
+    while(seq != atomic_load_explicit(LATCH_SEQ(self), memory_order_relaxed));
+#else
+    /* only changed by process context so no critical section is needed */
+    *next = self->next;
+#endif
+}
+
 static bool updateDownCounter(uint32_t *counter, uint32_t time)
 {
     bool expired = false;
@@ -2977,7 +3524,7 @@ static bool updateDownCounter(uint32_t *counter, uint32_t time)
     return expired;
 }
 
-static bool processBands(struct ldl_mac *self)
+static bool processBands(struct ldl_mac *self, uint32_t now)
 {
     bool retval = false;
     size_t i;
@@ -2987,23 +3534,28 @@ static bool processBands(struct ldl_mac *self)
 
         /* time tracking via ticks */
         {
-            uint32_t ticks = self->ticks(self->app);
+            uint32_t since = timerDelta(self->time.ticks, now);
+
+            self->time.ticks = now;
 
-            uint32_t since = timerDelta(self->time.ticks, ticks);
+            uint32_t seconds = LDL_DIV_divide(GET_TPS_DIV(), since);
 
-            self->time.ticks = ticks;
+            uint32_t fraction = ((since - (seconds * GET_TPS())) * timeTPS) + self->time.remainder;
 
-            uint32_t fraction = ((since % GET_TPS()) * timeTPS) + self->time.remainder;
+            uint32_t carry = LDL_DIV_divide(GET_TPS_DIV(), fraction);
 
-            time = ((since / GET_TPS()) * timeTPS) + (fraction / GET_TPS());
+            time = (seconds * timeTPS) + carry;
 
-            self->time.remainder = fraction % GET_TPS();
+            self->time.remainder = fraction - (carry * GET_TPS());
         }
 
         bool ready = false;
 
         /* handle the day counter if set */
-        (void)updateDownCounter(&self->day, time);
+        if(updateDownCounter(&self->day, time)){
+
+            self->time.changed = true;
+        }
 
         /* decrement down counters with time */
         for(i=0U; i < sizeof(self->band)/sizeof(*self->band); i++){
@@ -3014,10 +3566,17 @@ static bool processBands(struct ldl_mac *self)
             }
         }
 
+        /* the next band event moves when a counter expires or the
+         * event itself is due */
+        if(ready || (self->timers[LDL_TIMER_BAND].armed && (timerDelta(self->timers[LDL_TIMER_BAND].time, self->time.ticks) <= U32(INT32_MAX)))){
+
+            self->time.changed = true;
+        }
+
         if(ready && (self->band[LDL_BAND_GLOBAL] == 0U)){
 
             LDL_DEBUG("channel is ready")
-            self->handler(self->app, LDL_MAC_CHANNEL_READY, NULL);
+            NOTIFY(self, LDL_MAC_CHANNEL_READY, NULL);
             retval = true;
         }
     }
@@ -3025,12 +3584,14 @@ static bool processBands(struct ldl_mac *self)
     return retval;
 }
 
-static void setNextBandEvent(struct ldl_mac *self)
+static void setNextBandEvent(struct ldl_mac *self, uint32_t now)
 {
     uint32_t time = UINT32_MAX;
     uint32_t ticks;
     size_t i;
 
+    self->time.changed = false;
+
     for(i=0; i < sizeof(self->band)/sizeof(*self->band); i++){
 
         if(self->band[i] > 0U){
@@ -3059,16 +3620,16 @@ static void setNextBandEvent(struct ldl_mac *self)
 
         self->time.parked = false;
 
-        if(time < (U32(INT32_MAX)/GET_TPS()*timeTPS)){
+        if(time < (LDL_DIV_divide(GET_TPS_DIV(), U32(INT32_MAX))*timeTPS)){
 
             ticks = ((time / timeTPS) + (((time % timeTPS) > 0U) ? U32(1) : U32(0))) * GET_TPS();
         }
         else{
 
-            ticks = U32(INT32_MAX)/GET_TPS()*U32(INT32_MAX);
+            ticks = LDL_DIV_divide(GET_TPS_DIV(), U32(INT32_MAX))*U32(INT32_MAX);
         }
 
-        LDL_MAC_timerSet(self, LDL_TIMER_BAND, ticks);
+        LDL_MAC_timerSet(self, LDL_TIMER_BAND, now, ticks);
     }
     else{
 
@@ -3078,7 +3639,7 @@ static void setNextBandEvent(struct ldl_mac *self)
     }
 }
 
-static void downlinkMissingHandler(struct ldl_mac *self)
+static void downlinkMissingHandler(struct ldl_mac *self, uint32_t now)
 {
     uint8_t nbTrans;
     union ldl_mac_response_arg arg;
@@ -3105,24 +3666,36 @@ static void downlinkMissingHandler(struct ldl_mac *self)
     {
         struct ldl_mac_tx tx;
 
-        bool global_band_ok = (self->band[LDL_BAND_GLOBAL] < LDL_Region_getMaxDCycleOffLimit(self->ctx.region));
-        bool channel_ok = selectChannel(self, self->tx.rate, LDL_Region_getMaxDCycleOffLimit(self->ctx.region), &tx);
+        bool global_band_ok = (self->band[LDL_BAND_GLOBAL] < LDL_Region_getMaxDCycleOffLimit(GET_REGION()));
+        bool channel_ok = LDL_MAC_selectChannel(self, self->tx.rate, LDL_Region_getMaxDCycleOffLimit(GET_REGION()), &tx);
 
         if((self->trials < nbTrans) && global_band_ok && channel_ok){
 
-            LDL_OPS_micDataFrame(self, self->buffer, self->bufferLen);
+            /* double back-off with each confirmed trial */
+            uint32_t delay = (self->op == LDL_OP_DATA_CONFIRMED) ? (GET_TPS() << self->trials) : 0U;
 
-            if(self->op == LDL_OP_DATA_CONFIRMED){
+#ifdef LDL_ENABLE_SINGLE_BUFFER
+            /* the receive windows may have overwritten the frame */
+            self->bufferLen = LDL_OPS_prepareData(self, &self->retry, self->buffer, U8(sizeof(self->buffer)));
+#endif
+#ifdef LDL_ENABLE_ASYNC_SM
+            if(beginUplinkMIC(self, RETRY_MIC_STEP, delay)){
 
-                /* double back-off with each trial */
-                LDL_MAC_timerSet(self, LDL_TIMER_WAITA, (GET_TPS() << self->trials));
+                LDL_DEBUG("waiting for SM")
             }
-            else{
+            else
+#endif
+            {
+#ifdef LDL_ENABLE_SINGLE_BUFFER
+                LDL_OPS_micDataFrame(self, self->buffer, self->bufferLen);
+#else
+                LDL_OPS_remicDataFrame(self, self->buffer, self->bufferLen);
+#endif
 
-                LDL_MAC_timerSet(self, LDL_TIMER_WAITA, 0U);
-            }
+                LDL_MAC_timerSet(self, LDL_TIMER_WAITA, now, delay);
 
-            self->state = LDL_STATE_WAIT_TX;
+                self->state = LDL_STATE_WAIT_TX;
+            }
         }
         else{
 
@@ -3131,7 +3704,7 @@ static void downlinkMissingHandler(struct ldl_mac *self)
                 pushSessionUpdate(self);
             }
 
-            self->handler(self->app, (self->op == LDL_OP_DATA_CONFIRMED) ? LDL_MAC_DATA_TIMEOUT : LDL_MAC_DATA_COMPLETE, NULL);
+            NOTIFY(self, (self->op == LDL_OP_DATA_CONFIRMED) ? LDL_MAC_DATA_TIMEOUT : LDL_MAC_DATA_COMPLETE, NULL);
 
             self->state = LDL_STATE_IDLE;
             self->op = LDL_OP_NONE;
@@ -3149,16 +3722,16 @@ static void downlinkMissingHandler(struct ldl_mac *self)
             self->devNonce++;
 
             arg.dev_nonce_updated.nextDevNonce = self->devNonce;
-            self->handler(self->app, LDL_MAC_DEV_NONCE_UPDATED, &arg);
+            NOTIFY(self, LDL_MAC_DEV_NONCE_UPDATED, &arg);
 
             LDL_DEBUG("waiting to retry OTAA")
 
             self->state = LDL_STATE_WAIT_OTAA;
-            LDL_MAC_timerSet(self, LDL_TIMER_WAITA, 0);
+            LDL_MAC_timerSet(self, LDL_TIMER_WAITA, now, 0);
         }
         else{
 
-            self->handler(self->app, LDL_MAC_JOIN_EXHAUSTED, NULL);
+            NOTIFY(self, LDL_MAC_JOIN_EXHAUSTED, NULL);
 
             self->state = LDL_STATE_IDLE;
             self->op = LDL_OP_NONE;
@@ -3171,28 +3744,44 @@ static uint32_t msToTime(uint32_t ms)
 {
     /* round up */
     uint32_t t = ms * timeTPS;
+    uint32_t q = LDL_DIV_divide(&msDiv, t);
 
-    return (t / U32(1000)) + (((t % U32(1000)) > 0U) ? U32(1) : U32(0));
+    return q + ((t > (q * U32(1000))) ? U32(1) : U32(0));
 }
 
 static uint32_t msToTicks(const struct ldl_mac *self, uint32_t ms)
 {
     /* round up */
     uint32_t t = ms * GET_TPS();
+    uint32_t q = LDL_DIV_divide(&msDiv, t);
 
-    return (t / U32(1000)) + (((t % U32(1000)) > 0U) ? U32(1) : U32(0));
+    return q + ((t > (q * U32(1000))) ? U32(1) : U32(0));
 }
 
 static uint32_t timeUntilNextChannel(const struct ldl_mac *self)
 {
-    uint8_t i;
     uint32_t min = UINT32_MAX;
+    uint32_t t;
+    uint8_t mask[sizeof(self->ctx.chMask)];
+    size_t i;
+    size_t j;
 
-    for(i=0; i < LDL_Region_numChannels(self->ctx.region); i++){
+    /* only bands that have at least one unmasked channel count */
+    for(i=0U; i < U8(LDL_BAND_GLOBAL); i++){
 
-        if(min > timeUntilAvailable(self, i)){
+        for(j=0U; j < sizeof(mask); j++){
 
-            min = timeUntilAvailable(self, i);
+            mask[j] = self->chBand[i][j] & U8(~self->ctx.chMask[j]);
+        }
+
+        if(countChannels(mask, sizeof(mask)) > 0U){
+
+            t = (self->band[i] > self->band[LDL_BAND_GLOBAL]) ? self->band[i] : self->band[LDL_BAND_GLOBAL];
+
+            if(min > t){
+
+                min = t;
+            }
         }
     }
 
@@ -3203,11 +3792,38 @@ static void pushSessionUpdate(struct ldl_mac *self)
 {
     union ldl_mac_response_arg arg;
 
-    arg.session_updated.session = &self->ctx;
+    if(self->changed > 0U){
 
-    self->handler(self->app, LDL_MAC_SESSION_UPDATED, &arg);
+        arg.session_updated.session = &self->ctx;
+        arg.session_updated.changed = self->changed;
 
-    debugSession(self);
+        self->changed = 0U;
+
+        NOTIFY(self, LDL_MAC_SESSION_UPDATED, &arg);
+
+        debugSession(self);
+    }
+}
+
+static void sessionChanged(struct ldl_mac *self, enum ldl_mac_session_field field)
+{
+    self->changed |= U16(1) << field;
+}
+
+static void upCounterChanged(struct ldl_mac *self)
+{
+#ifdef LDL_ENABLE_COUNTER_GAP
+    /* only save when a new block is reserved */
+    if(!self->ctx.upReserved || ((self->ctx.up % U32(LDL_COUNTER_GAP)) == 0U)){
+
+        self->ctx.upReserved = true;
+
+        sessionChanged(self, LDL_SESSION_UP);
+        sessionChanged(self, LDL_SESSION_UP_RESERVED);
+    }
+#else
+    sessionChanged(self, LDL_SESSION_UP);
+#endif
 }
 
 static void debugSession(struct ldl_mac *self)
@@ -3220,9 +3836,10 @@ static void debugSession(struct ldl_mac *self)
     LDL_TRACE("adr=%s", self->ctx.adr ? "true" : "false")
     LDL_TRACE("version=%u", SESS_VERSION(self->ctx))
 
-    LDL_TRACE("region=%s", LDL_Region_enumToString(self->ctx.region))
+    LDL_TRACE("region=%s", LDL_Region_enumToString(GET_REGION()))
 
     LDL_TRACE("up=%" PRIu32 "", self->ctx.up)
+    LDL_TRACE("upReserved=%s", self->ctx.upReserved ? "true" : "false")
     LDL_TRACE("appDown=%" PRIu16 "", self->ctx.appDown)
     LDL_TRACE("nwkDown=%" PRIu16 "", self->ctx.nwkDown)
 
@@ -3231,12 +3848,11 @@ static void debugSession(struct ldl_mac *self)
 
     for(i=0U; i < sizeof(self->ctx.chConfig)/sizeof(*self->ctx.chConfig); i++){
 
-        LDL_TRACE("chConfig: chIndex=%u freq=%" PRIu32 " minRate=%u maxRate=%u dlFreq=%" PRIu32 "",
+        LDL_TRACE("chConfig: chIndex=%u freq=%" PRIu32 " minRate=%u maxRate=%u",
             U8(i),
             (self->ctx.chConfig[i].freqAndRate >> 8) * U32(100),
             U8((self->ctx.chConfig[i].freqAndRate >> 4) & 0xfU),
-            U8(self->ctx.chConfig[i].freqAndRate & 0xfU),
-            self->ctx.chConfig[i].dlFreq
+            U8(self->ctx.chConfig[i].freqAndRate & 0xfU)
         )
     }
 
@@ -3261,15 +3877,18 @@ static void debugSession(struct ldl_mac *self)
     LDL_TRACE("joinNonce=%" PRIu32 "", self->ctx.joinNonce)
     LDL_TRACE("devNonce=%" PRIu16 "", self->ctx.devNonce)
     LDL_TRACE("pending_cmds=0x%02X", self->ctx.pending_cmds)
+    LDL_TRACE("answers=0x%04X", self->ctx.answers)
 #endif
 }
 
+#ifndef LDL_ENABLE_CONST_CONFIG
 static void dummyResponseHandler(void *app, enum ldl_mac_response_type type, const union ldl_mac_response_arg *arg)
 {
     (void)app;
     (void)type;
     (void)arg;
 }
+#endif
 
 static bool commandIsPending(const struct ldl_mac *self, enum ldl_mac_cmd_type type)
 {
@@ -3278,14 +3897,45 @@ static bool commandIsPending(const struct ldl_mac *self, enum ldl_mac_cmd_type t
 
 static void clearPendingCommand(struct ldl_mac *self, enum ldl_mac_cmd_type type)
 {
-    self->ctx.pending_cmds &= ~(U16(1) << type);
+    if(commandIsPending(self, type)){
+
+        self->ctx.pending_cmds &= ~(U16(1) << type);
+        sessionChanged(self, LDL_SESSION_PENDING);
+    }
 }
 
 static void setPendingCommand(struct ldl_mac *self, enum ldl_mac_cmd_type type)
 {
-    self->ctx.pending_cmds |= (U16(1) << type);
+    if(!commandIsPending(self, type)){
+
+        self->ctx.pending_cmds |= (U16(1) << type);
+        sessionChanged(self, LDL_SESSION_PENDING);
+    }
+}
+
+static bool getAnswer(const struct ldl_mac *self, enum ldl_mac_answer bit)
+{
+    return ((self->ctx.answers & (U16(1) << bit)) > 0U);
+}
+
+static void setAnswer(struct ldl_mac *self, enum ldl_mac_answer bit, bool value)
+{
+    if(getAnswer(self, bit) != value){
+
+        if(value){
+
+            self->ctx.answers |= (U16(1) << bit);
+        }
+        else{
+
+            self->ctx.answers &= ~(U16(1) << bit);
+        }
+
+        sessionChanged(self, LDL_SESSION_PENDING);
+    }
 }
 
+#ifndef LDL_ENABLE_CONST_CONFIG
 static uint32_t defaultRand(void *app)
 {
     (void)app;
@@ -3300,81 +3950,175 @@ static uint8_t defaultBatteryLevel(void *app)
 
     return 255U;
 }
+#endif
 
+/* interrupt context: only the producer side of the ring is written
+ * so no critical section is required */
 static void inputSignal(struct ldl_mac *self, uint32_t ticks)
 {
-    LDL_SYSTEM_ENTER_CRITICAL(self->app)
+    uint8_t head = self->inputs.head;
 
-    if(!self->inputs.state && self->inputs.armed){
+    /* a full ring keeps the oldest timestamps */
+    if(self->inputs.armed && (U8(head - self->inputs.tail) < U8(LDL_INPUT_RING_SIZE))){
 
-        self->inputs.time = ticks;
-        self->inputs.state = true;
-    }
+        self->inputs.time[head % LDL_INPUT_RING_SIZE] = ticks;
+
+        LDL_SYSTEM_BARRIER()
 
-    LDL_SYSTEM_LEAVE_CRITICAL(self->app)
+        self->inputs.head = head + 1U;
+    }
 }
 
 static void inputArm(struct ldl_mac *self)
 {
-    LDL_SYSTEM_ENTER_CRITICAL(self->app)
+    /* discard anything left over from the previous operation */
+    self->inputs.tail = self->inputs.head;
 
-    self->inputs.state = false;
-    self->inputs.armed = true;
+    LDL_SYSTEM_BARRIER()
 
-    LDL_SYSTEM_LEAVE_CRITICAL(self->app)
+    self->inputs.armed = true;
 }
 
 static void inputDisarm(struct ldl_mac *self)
 {
-    LDL_SYSTEM_ENTER_CRITICAL(self->app)
-
     self->inputs.armed = false;
-
-    LDL_SYSTEM_LEAVE_CRITICAL(self->app)
 }
 
-static bool inputCheck(struct ldl_mac *self, uint32_t *lag)
+static bool inputCheck(struct ldl_mac *self, uint32_t now, uint32_t *lag)
 {
     bool retval = false;
+    uint8_t head = self->inputs.head;
+    uint8_t tail = self->inputs.tail;
 
-    LDL_SYSTEM_ENTER_CRITICAL(self->app)
+    LDL_SYSTEM_BARRIER()
 
-    if(self->inputs.state){
+    if(self->inputs.armed && (head != tail)){
 
         self->inputs.armed = false;
-        self->inputs.state = false;
-        *lag = timerDelta(self->inputs.time, self->ticks(self->app));
+
+        /* the first edge is the one that ended the radio operation */
+        *lag = timerDelta(self->inputs.time[tail % LDL_INPUT_RING_SIZE], now);
+
+        LDL_DEBUG("input: events=%u lag=%" PRIu32 "", U8(head - tail), *lag)
+
+        /* drain */
+        self->inputs.tail = head;
 
         retval = true;
     }
 
-    LDL_SYSTEM_LEAVE_CRITICAL(self->app)
-
     return retval;
 }
 
 static bool inputPending(const struct ldl_mac *self)
 {
-    return self->inputs.state;
+    return (self->inputs.armed && (self->inputs.head != self->inputs.tail));
 }
 
 static void fillJoinBuffer(struct ldl_mac *self, uint16_t devNonce)
 {
     struct ldl_frame_join_request f;
 
-    f.joinEUI = self->joinEUI;
-    f.devEUI = self->devEUI;
+    f.joinEUI = LDL_MAC_CONFIG(self)->joinEUI;
+    f.devEUI = LDL_MAC_CONFIG(self)->devEUI;
 
 #if defined(LDL_ENABLE_L2_1_0_3)
     (void)devNonce;
-    self->ctx.devNonce = self->rand(self->app);
+    self->ctx.devNonce = GET_RAND(self);
 #else
     self->ctx.devNonce = devNonce;
 #endif
     f.devNonce = self->ctx.devNonce;
 
+    sessionChanged(self, LDL_SESSION_DEV_NONCE);
+
     self->bufferLen = LDL_OPS_prepareJoinRequest(self, &f, self->buffer, U8(sizeof(self->buffer)));
 
     selectJoinChannelAndRate(self, &self->tx);
 }
 
+#ifdef LDL_ENABLE_ASYNC_SM
+static void processWaitSM(struct ldl_mac *self, enum ldl_mac_sme event, uint32_t now)
+{
+    struct ldl_frame_down frame;
+
+    if(event == LDL_SME_SM){
+
+        switch(self->async.op){
+        default:
+        case LDL_SM_OP_TX:
+
+            LDL_OPS_finishMicDataFrame(self, self->buffer, self->bufferLen, self->async.step, self->async.mic);
+
+            /* 1.1 needs a second MIC */
+            if(!beginUplinkMIC(self, self->async.step + 1U, self->async.delay)){
+
+                LDL_MAC_timerSet(self, LDL_TIMER_WAITA, now, self->async.delay);
+                self->state = LDL_STATE_WAIT_TX;
+            }
+            break;
+
+        case LDL_SM_OP_RX:
+
+            if(LDL_OPS_finishReceiveFrame(self, &frame, RX_BUFFER(self), self->async.len, self->async.mic)){
+
+                processDownlink(self, &frame, now);
+            }
+            else{
+
+                downlinkMissingHandler(self, now);
+            }
+            break;
+        }
+    }
+}
+
+static bool smAvailable(const struct ldl_mac *self)
+{
+    return (LDL_MAC_CONFIG(self)->sm_interface->begin_mic != NULL) && !self->async.busy;
+}
+
+static bool beginUplinkMIC(struct ldl_mac *self, uint8_t step, uint32_t delay)
+{
+    bool retval = false;
+
+    if(smAvailable(self)){
+
+        if(LDL_OPS_beginMicDataFrame(self, self->buffer, self->bufferLen, step)){
+
+            self->async.op = LDL_SM_OP_TX;
+            self->async.step = step;
+            self->async.delay = delay;
+            self->async.busy = true;
+            self->state = LDL_STATE_WAIT_SM;
+
+            retval = true;
+        }
+    }
+
+    return retval;
+}
+
+static bool smCheck(struct ldl_mac *self)
+{
+    bool retval = false;
+
+    if(self->async.state){
+
+        /* mic is read after the flag */
+        LDL_SYSTEM_BARRIER()
+
+        self->async.state = false;
+        self->async.busy = false;
+
+        retval = true;
+    }
+
+    return retval;
+}
+
+static bool smPending(const struct ldl_mac *self)
+{
+    return self->async.state;
+}
+#endif
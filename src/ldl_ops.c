@@ -40,6 +40,11 @@ static void initA(struct ldl_block *a, uint32_t c, uint32_t devAddr, bool up, ui
 static void initB(struct ldl_block *b, uint16_t confirmCounter, uint8_t rate, uint8_t chIndex, bool up, uint32_t devAddr, uint32_t upCounter, uint8_t len);
 
 static uint32_t deriveDownCounter(struct ldl_mac *self, uint8_t port, uint16_t counter);
+static bool micDecryptData(struct ldl_mac *self, const struct ldl_frame_down *f, const struct ldl_block *B, uint8_t *in, uint8_t len);
+static bool initDataB(struct ldl_mac *self, const struct ldl_frame_down *f, uint8_t len, struct ldl_block *B);
+static void decryptData(struct ldl_mac *self, const struct ldl_frame_down *f);
+static uint32_t getMIC(const void *buffer, uint8_t size);
+static void updateSessionKeys(struct ldl_mac *self, enum ldl_sm_key root, const struct ldl_sm_derivation *keys, uint8_t numKeys);
 
 /* functions **********************************************************/
 
@@ -48,16 +53,24 @@ void LDL_OPS_syncDownCounter(struct ldl_mac *self, uint8_t port, uint16_t counte
     LDL_PEDANTIC(self != NULL)
 
     uint32_t derived;
+    uint16_t *down;
 
     derived = deriveDownCounter(self, port, counter);
 
     if((SESS_VERSION(self->ctx) > 0U) && (port == 0U)){
 
-        self->ctx.nwkDown = U16(derived >> 16);
+        down = &self->ctx.nwkDown;
     }
     else{
 
-        self->ctx.appDown = U16(derived >> 16);
+        down = &self->ctx.appDown;
+    }
+
+    /* only the upper 16 bits are kept so this seldom changes */
+    if(*down != U16(derived >> 16)){
+
+        *down = U16(derived >> 16);
+        self->changed |= U16(1) << LDL_SESSION_DOWN;
     }
 }
 
@@ -65,47 +78,60 @@ void LDL_OPS_deriveKeys(struct ldl_mac *self)
 {
     LDL_PEDANTIC(self != NULL)
 
-    struct ldl_block iv = {0};
+    struct ldl_block iv[4];
     struct ldl_stream s;
+    uint8_t i;
 
-    LDL_Stream_init(&s, &iv, sizeof(iv));
+    (void)memset(iv, 0, sizeof(iv));
+
+    LDL_Stream_init(&s, &iv[0], sizeof(iv[0]));
+
+    (void)LDL_Stream_putU8(&s, 1);
+    (void)LDL_Stream_putU24(&s, self->ctx.joinNonce);
 
     if(SESS_VERSION(self->ctx) == 0U){
 
-        (void)LDL_Stream_putU8(&s, 1);
-        (void)LDL_Stream_putU24(&s, self->ctx.joinNonce);
         (void)LDL_Stream_putU24(&s, self->ctx.netID);
-        (void)LDL_Stream_putU16(&s, self->ctx.devNonce);
+    }
+    else{
 
-        self->sm_interface->update_session_key(self->sm, LDL_SM_KEY_FNWKSINT, LDL_SM_KEY_NWK, &iv);
-        self->sm_interface->update_session_key(self->sm, LDL_SM_KEY_SNWKSINT, LDL_SM_KEY_NWK, &iv);
-        self->sm_interface->update_session_key(self->sm, LDL_SM_KEY_NWKSENC, LDL_SM_KEY_NWK, &iv);
+        (void)LDL_Stream_putEUI(&s, LDL_MAC_CONFIG(self)->joinEUI);
+    }
 
-        LDL_Stream_rewind(&s);
-        (void)LDL_Stream_putU8(&s, 2);
-        self->sm_interface->update_session_key(self->sm, LDL_SM_KEY_APPS, LDL_SM_KEY_NWK, &iv);
+    (void)LDL_Stream_putU16(&s, self->ctx.devNonce);
 
+    /* the other blocks differ only by the first byte */
+    for(i=1U; i < U8(sizeof(iv)/sizeof(*iv)); i++){
+
+        (void)memcpy(&iv[i], &iv[0], sizeof(iv[i]));
+        iv[i].value[0] = i + 1U;
     }
-    else{
 
-        (void)LDL_Stream_putU8(&s, 1);
-        (void)LDL_Stream_putU24(&s, self->ctx.joinNonce);
-        (void)LDL_Stream_putEUI(&s, self->joinEUI);
-        (void)LDL_Stream_putU16(&s, self->ctx.devNonce);
+    if(SESS_VERSION(self->ctx) == 0U){
+
+        const struct ldl_sm_derivation keys[] = {
+            {.desc = LDL_SM_KEY_FNWKSINT, .iv = &iv[0]},
+            {.desc = LDL_SM_KEY_SNWKSINT, .iv = &iv[0]},
+            {.desc = LDL_SM_KEY_NWKSENC, .iv = &iv[0]},
+            {.desc = LDL_SM_KEY_APPS, .iv = &iv[1]}
+        };
 
-        self->sm_interface->update_session_key(self->sm, LDL_SM_KEY_FNWKSINT, LDL_SM_KEY_NWK, &iv);
+        updateSessionKeys(self, LDL_SM_KEY_NWK, keys, U8(sizeof(keys)/sizeof(*keys)));
+    }
+    else{
 
-        LDL_Stream_rewind(&s);
-        (void)LDL_Stream_putU8(&s, 2);
-        self->sm_interface->update_session_key(self->sm, LDL_SM_KEY_APPS, LDL_SM_KEY_APP, &iv);
+        const struct ldl_sm_derivation nwkKeys[] = {
+            {.desc = LDL_SM_KEY_FNWKSINT, .iv = &iv[0]},
+            {.desc = LDL_SM_KEY_SNWKSINT, .iv = &iv[2]},
+            {.desc = LDL_SM_KEY_NWKSENC, .iv = &iv[3]}
+        };
 
-        LDL_Stream_rewind(&s);
-        (void)LDL_Stream_putU8(&s, 3);
-        self->sm_interface->update_session_key(self->sm, LDL_SM_KEY_SNWKSINT, LDL_SM_KEY_NWK, &iv);
+        const struct ldl_sm_derivation appKeys[] = {
+            {.desc = LDL_SM_KEY_APPS, .iv = &iv[1]}
+        };
 
-        LDL_Stream_rewind(&s);
-        (void)LDL_Stream_putU8(&s, 4);
-        self->sm_interface->update_session_key(self->sm, LDL_SM_KEY_NWKSENC, LDL_SM_KEY_NWK, &iv);
+        updateSessionKeys(self, LDL_SM_KEY_NWK, nwkKeys, U8(sizeof(nwkKeys)/sizeof(*nwkKeys)));
+        updateSessionKeys(self, LDL_SM_KEY_APP, appKeys, U8(sizeof(appKeys)/sizeof(*appKeys)));
     }
 }
 
@@ -114,18 +140,25 @@ void LDL_OPS_deriveJoinKeys(struct ldl_mac *self)
 {
     LDL_PEDANTIC(self != NULL)
 
-    struct ldl_block iv = {0};
+    struct ldl_block iv[2];
     struct ldl_stream s;
 
-    LDL_Stream_init(&s, &iv, sizeof(iv));
+    (void)memset(iv, 0, sizeof(iv));
+
+    LDL_Stream_init(&s, &iv[0], sizeof(iv[0]));
 
     (void)LDL_Stream_putU8(&s, 5);
-    (void)LDL_Stream_putEUI(&s, self->devEUI);
-    self->sm_interface->update_session_key(self->sm, LDL_SM_KEY_JSENC, LDL_SM_KEY_NWK, &iv);
+    (void)LDL_Stream_putEUI(&s, LDL_MAC_CONFIG(self)->devEUI);
+
+    (void)memcpy(&iv[1], &iv[0], sizeof(iv[1]));
+    iv[1].value[0] = 6U;
 
-    LDL_Stream_rewind(&s);
-    (void)LDL_Stream_putU8(&s, 6);
-    self->sm_interface->update_session_key(self->sm, LDL_SM_KEY_JSINT, LDL_SM_KEY_NWK, &iv);
+    const struct ldl_sm_derivation keys[] = {
+        {.desc = LDL_SM_KEY_JSENC, .iv = &iv[0]},
+        {.desc = LDL_SM_KEY_JSINT, .iv = &iv[1]}
+    };
+
+    updateSessionKeys(self, LDL_SM_KEY_NWK, keys, U8(sizeof(keys)/sizeof(*keys)));
 }
 #endif
 
@@ -153,14 +186,14 @@ uint8_t LDL_OPS_prepareData(struct ldl_mac *self, const struct ldl_frame_data *f
             /* as per 1.1 spec */
             initA(&A, 0, f->devAddr, true, f->counter, 0);
 #endif
-            self->sm_interface->ctr(self->sm, LDL_SM_KEY_NWKSENC, &A, &out[off.opts], f->optsLen);
+            LDL_MAC_CONFIG(self)->sm_interface->ctr(LDL_MAC_CONFIG(self)->sm, LDL_SM_KEY_NWKSENC, &A, &out[off.opts], f->optsLen);
         }
 #endif
 
         initA(&A, 0, f->devAddr, true, f->counter, 1);
 
         /* encrypt data */
-        self->sm_interface->ctr(self->sm, (f->port == 0U) ? LDL_SM_KEY_NWKSENC : LDL_SM_KEY_APPS, &A, &out[off.data], f->dataLen);
+        LDL_MAC_CONFIG(self)->sm_interface->ctr(LDL_MAC_CONFIG(self)->sm, (f->port == 0U) ? LDL_SM_KEY_NWKSENC : LDL_SM_KEY_APPS, &A, &out[off.data], f->dataLen);
 
     }
 
@@ -177,11 +210,11 @@ void LDL_OPS_micDataFrame(struct ldl_mac *self, void *buffer, uint8_t size)
     initB(&B0, 0U, 0U, 0U, true, self->ctx.devAddr, self->tx.counter, size - U8(sizeof(micF)));
     initB(&B1, 0U, self->tx.rate, self->tx.chIndex, true, self->ctx.devAddr, self->tx.counter, size - U8(sizeof(micS)));
 
-    micF = self->sm_interface->mic(self->sm, LDL_SM_KEY_FNWKSINT, &B0, U8(sizeof(B0.value)), buffer, size - U8(sizeof(micF)));
+    micF = LDL_MAC_CONFIG(self)->sm_interface->mic(LDL_MAC_CONFIG(self)->sm, LDL_SM_KEY_FNWKSINT, &B0, U8(sizeof(B0.value)), buffer, size - U8(sizeof(micF)));
 
     if(SESS_VERSION(self->ctx) == 1U){
 
-        micS = self->sm_interface->mic(self->sm, LDL_SM_KEY_SNWKSINT, &B1, U8(sizeof(B1.value)), buffer, size - U8(sizeof(micS)));
+        micS = LDL_MAC_CONFIG(self)->sm_interface->mic(LDL_MAC_CONFIG(self)->sm, LDL_SM_KEY_SNWKSINT, &B1, U8(sizeof(B1.value)), buffer, size - U8(sizeof(micS)));
 
         LDL_Frame_updateMIC(buffer, size, ((micF << 16) | (micS & U32(0xffff))));
     }
@@ -191,6 +224,24 @@ void LDL_OPS_micDataFrame(struct ldl_mac *self, void *buffer, uint8_t size)
     }
 }
 
+void LDL_OPS_remicDataFrame(struct ldl_mac *self, void *buffer, uint8_t size)
+{
+    struct ldl_block B1;
+    uint32_t micS;
+
+    /* 1.0.x MIC does not depend on channel or rate so the MIC
+     * already in the buffer is still valid */
+    if((SESS_VERSION(self->ctx) == 1U) && (size > U8(sizeof(micS)))){
+
+        initB(&B1, 0U, self->tx.rate, self->tx.chIndex, true, self->ctx.devAddr, self->tx.counter, size - U8(sizeof(micS)));
+
+        micS = LDL_MAC_CONFIG(self)->sm_interface->mic(LDL_MAC_CONFIG(self)->sm, LDL_SM_KEY_SNWKSINT, &B1, U8(sizeof(B1.value)), buffer, size - U8(sizeof(micS)));
+
+        /* micF is not affected by channel or rate so keep it */
+        LDL_Frame_updateMIC(buffer, size, ((getMIC(buffer, size) & U32(0xffff0000)) | (micS & U32(0xffff))));
+    }
+}
+
 uint8_t LDL_OPS_prepareJoinRequest(struct ldl_mac *self, const struct ldl_frame_join_request *f, uint8_t *out, uint8_t max)
 {
     uint32_t mic;
@@ -198,7 +249,7 @@ uint8_t LDL_OPS_prepareJoinRequest(struct ldl_mac *self, const struct ldl_frame_
 
     retval = LDL_Frame_putJoinRequest(f, out, max);
 
-    mic = self->sm_interface->mic(self->sm, LDL_SM_KEY_NWK, NULL, 0U, out, retval - U8(sizeof(mic)));
+    mic = LDL_MAC_CONFIG(self)->sm_interface->mic(LDL_MAC_CONFIG(self)->sm, LDL_SM_KEY_NWK, NULL, 0U, out, retval - U8(sizeof(mic)));
 
     LDL_Frame_updateMIC(out, retval, mic);
 
@@ -227,11 +278,11 @@ bool LDL_OPS_receiveFrame(struct ldl_mac *self, struct ldl_frame_down *f, uint8_
 
                 key = (self->op == LDL_OP_JOINING) ? LDL_SM_KEY_NWK : LDL_SM_KEY_JSENC;
 
-                self->sm_interface->ecb(self->sm, key, &in[1U]);
+                LDL_MAC_CONFIG(self)->sm_interface->ecb(LDL_MAC_CONFIG(self)->sm, key, &in[1U]);
 
                 if(len == LDL_Frame_sizeofJoinAccept(true)){
 
-                    self->sm_interface->ecb(self->sm, key, &in[LDL_Frame_sizeofJoinAccept(false)]);
+                    LDL_MAC_CONFIG(self)->sm_interface->ecb(LDL_MAC_CONFIG(self)->sm, key, &in[LDL_Frame_sizeofJoinAccept(false)]);
                 }
 
                 if(LDL_Frame_decode(f, in, len)){
@@ -263,10 +314,10 @@ bool LDL_OPS_receiveFrame(struct ldl_mac *self, struct ldl_frame_down *f, uint8_
                                 break;
                             }
 
-                            (void)LDL_Stream_putEUI(&s, self->joinEUI);
+                            (void)LDL_Stream_putEUI(&s, LDL_MAC_CONFIG(self)->joinEUI);
                             (void)LDL_Stream_putU16(&s, self->ctx.devNonce);
 
-                            mic = self->sm_interface->mic(self->sm, LDL_SM_KEY_JSINT, &hdr, LDL_Stream_tell(&s), in, len - U8(sizeof(mic)));
+                            mic = LDL_MAC_CONFIG(self)->sm_interface->mic(LDL_MAC_CONFIG(self)->sm, LDL_SM_KEY_JSINT, &hdr, LDL_Stream_tell(&s), in, len - U8(sizeof(mic)));
 
                             if(f->mic == mic){
 
@@ -281,7 +332,7 @@ bool LDL_OPS_receiveFrame(struct ldl_mac *self, struct ldl_frame_down *f, uint8_
                         else
 #endif
                         {
-                            mic = self->sm_interface->mic(self->sm, LDL_SM_KEY_NWK, NULL, 0U, in, len - U8(sizeof(mic)));
+                            mic = LDL_MAC_CONFIG(self)->sm_interface->mic(LDL_MAC_CONFIG(self)->sm, LDL_SM_KEY_NWK, NULL, 0U, in, len - U8(sizeof(mic)));
 
                             if(f->mic == mic){
 
@@ -310,85 +361,141 @@ bool LDL_OPS_receiveFrame(struct ldl_mac *self, struct ldl_frame_down *f, uint8_
 
         case FRAME_TYPE_DATA_UNCONFIRMED_DOWN:
         case FRAME_TYPE_DATA_CONFIRMED_DOWN:
+        {
+            struct ldl_block B;
 
-            if(
-                (self->op == LDL_OP_REJOINING)
-                ||
-                (self->op  == LDL_OP_DATA_UNCONFIRMED)
-                ||
-                (self->op == LDL_OP_DATA_CONFIRMED)
-            ){
+            if(initDataB(self, f, len, &B)){
 
-                if(self->ctx.devAddr == f->devAddr){
+                if(LDL_MAC_CONFIG(self)->sm_interface->mic_decrypt != NULL){
 
-                    uint32_t counter;
+                    retval = micDecryptData(self, f, &B, in, len);
+                }
+                else if(LDL_MAC_CONFIG(self)->sm_interface->mic(LDL_MAC_CONFIG(self)->sm, LDL_SM_KEY_SNWKSINT, &B, U8(sizeof(B.value)), in, len - U8(sizeof(mic))) == f->mic){
 
-                    counter = deriveDownCounter(self, f->port, f->counter);
+                    decryptData(self, f);
+                    retval = true;
+                }
+                else{
 
-                    struct ldl_block B;
-                    struct ldl_block A;
+                    /* retval is false */
+                }
 
-                    if((SESS_VERSION(self->ctx) == 1U) && f->ack){
+                if(!retval){
 
-                        initB(&B, U16(self->ctx.up-1U), 0U, 0U, false, f->devAddr, counter, len - U8(sizeof(mic)));
-                    }
-                    else{
+                    /* MIC failed */
+                    LDL_DEBUG("data MIC failed")
+                }
+            }
+        }
+            break;
+        }
+    }
+    else{
 
-                        initB(&B, 0U, 0U, 0U, false, f->devAddr, counter, len - U8(sizeof(mic)));
-                    }
+        /* invalid frame */
+        LDL_DEBUG("invalid frame")
+    }
 
-                    mic = self->sm_interface->mic(self->sm, LDL_SM_KEY_SNWKSINT, &B, U8(sizeof(B.value)), in, len - U8(sizeof(mic)));
+    return retval;
+}
 
-                    if(mic == f->mic){
+#ifdef LDL_ENABLE_ASYNC_SM
+bool LDL_OPS_beginMicDataFrame(struct ldl_mac *self, const void *buffer, uint8_t size, uint8_t step)
+{
+    struct ldl_block B;
+    bool retval = false;
 
-#if defined(LDL_ENABLE_L2_1_1)
-                        /* V1.1 encrypts the opts */
-                        if(SESS_VERSION(self->ctx) == 1U){
-#ifdef LDL_ENABLE_ERRATA_A1
-                            /* as per errata 26 Jan 2018 */
-                            initA(&A, f->dataPresent ? 2U : 1U, f->devAddr, false, f->counter, 0U);
-#else
-                            /* as per 1.1 spec */
-                            initA(&A, 0U, f->devAddr, false, f->counter, 0U);
-#endif
-                            self->sm_interface->ctr(self->sm, LDL_SM_KEY_NWKSENC, &A, f->opts, f->optsLen);
-                        }
-#endif
-                        initA(&A, 0U, f->devAddr, false, f->counter, 1U);
+    switch(step){
+    case 0U:
 
-                        self->sm_interface->ctr(self->sm, (f->port == 0U) ? LDL_SM_KEY_NWKSENC : LDL_SM_KEY_APPS, &A, f->data, f->dataLen);
+        initB(&B, 0U, 0U, 0U, true, self->ctx.devAddr, self->tx.counter, size - U8(sizeof(uint32_t)));
+        LDL_MAC_CONFIG(self)->sm_interface->begin_mic(LDL_MAC_CONFIG(self)->sm, LDL_SM_KEY_FNWKSINT, &B, U8(sizeof(B.value)), buffer, size - U8(sizeof(uint32_t)));
+        retval = true;
+        break;
 
-                        retval = true;
-                    }
-                    else{
+    case 1U:
 
-                        /* MIC failed */
-                        LDL_DEBUG("data MIC failed")
-                    }
-                }
-                else{
+        if(SESS_VERSION(self->ctx) == 1U){
 
-                    /* devaddr */
-                    LDL_DEBUG("devaddr mismatch")
-                }
-            }
-            else{
+            initB(&B, 0U, self->tx.rate, self->tx.chIndex, true, self->ctx.devAddr, self->tx.counter, size - U8(sizeof(uint32_t)));
+            LDL_MAC_CONFIG(self)->sm_interface->begin_mic(LDL_MAC_CONFIG(self)->sm, LDL_SM_KEY_SNWKSINT, &B, U8(sizeof(B.value)), buffer, size - U8(sizeof(uint32_t)));
+            retval = true;
+        }
+        break;
 
-                /* unexpected frame type */
-                LDL_DEBUG("unexpected frame type")
-            }
+    default:
+        /* no more steps */
+        break;
+    }
 
-            break;
+    return retval;
+}
+
+void LDL_OPS_finishMicDataFrame(struct ldl_mac *self, void *buffer, uint8_t size, uint8_t step, uint32_t mic)
+{
+    uint32_t current = getMIC(buffer, size);
+
+    (void)self;
+
+    if(SESS_VERSION(self->ctx) == 1U){
+
+        if(step == 0U){
+
+            LDL_Frame_updateMIC(buffer, size, ((mic << 16) | (current & U32(0xffff))));
+        }
+        else{
+
+            LDL_Frame_updateMIC(buffer, size, ((current & U32(0xffff0000)) | (mic & U32(0xffff))));
         }
     }
     else{
 
-        /* invalid frame */
-        LDL_DEBUG("invalid frame")
+        LDL_Frame_updateMIC(buffer, size, mic);
+    }
+}
+
+bool LDL_OPS_beginReceiveFrame(struct ldl_mac *self, uint8_t *in, uint8_t len)
+{
+    bool retval = false;
+    struct ldl_frame_down f;
+    struct ldl_block B;
+
+    if(LDL_Frame_decode(&f, in, len)){
+
+        if((f.type == FRAME_TYPE_DATA_UNCONFIRMED_DOWN) || (f.type == FRAME_TYPE_DATA_CONFIRMED_DOWN)){
+
+            if(initDataB(self, &f, len, &B)){
+
+                LDL_MAC_CONFIG(self)->sm_interface->begin_mic(LDL_MAC_CONFIG(self)->sm, LDL_SM_KEY_SNWKSINT, &B, U8(sizeof(B.value)), in, len - U8(sizeof(f.mic)));
+                retval = true;
+            }
+        }
+    }
+
+    return retval;
+}
+
+bool LDL_OPS_finishReceiveFrame(struct ldl_mac *self, struct ldl_frame_down *f, uint8_t *in, uint8_t len, uint32_t mic)
+{
+    bool retval = false;
+
+    if(LDL_Frame_decode(f, in, len)){
+
+        if(mic == f->mic){
+
+            decryptData(self, f);
+            retval = true;
+        }
+        else{
+
+            /* MIC failed */
+            LDL_DEBUG("data MIC failed")
+        }
     }
 
     return retval;
 }
+#endif
 
 /* static functions ***************************************************/
 
@@ -441,3 +548,137 @@ static uint32_t deriveDownCounter(struct ldl_mac *self, uint8_t port, uint16_t c
 
     return mine;
 }
+
+static bool micDecryptData(struct ldl_mac *self, const struct ldl_frame_down *f, const struct ldl_block *B, uint8_t *in, uint8_t len)
+{
+    struct ldl_block A[2];
+    struct ldl_sm_range range[2];
+    uint8_t n = 0U;
+
+#if defined(LDL_ENABLE_L2_1_1)
+    /* V1.1 encrypts the opts */
+    if((SESS_VERSION(self->ctx) == 1U) && (f->optsLen > 0U)){
+
+#ifdef LDL_ENABLE_ERRATA_A1
+        /* as per errata 26 Jan 2018 */
+        initA(&A[n], f->dataPresent ? 2U : 1U, f->devAddr, false, f->counter, 0U);
+#else
+        /* as per 1.1 spec */
+        initA(&A[n], 0U, f->devAddr, false, f->counter, 0U);
+#endif
+        range[n].desc = LDL_SM_KEY_NWKSENC;
+        range[n].iv = &A[n];
+        range[n].offset = U8(f->opts - in);
+        range[n].len = f->optsLen;
+        n++;
+    }
+#endif
+
+    if(f->dataLen > 0U){
+
+        initA(&A[n], 0U, f->devAddr, false, f->counter, 1U);
+
+        range[n].desc = (f->port == 0U) ? LDL_SM_KEY_NWKSENC : LDL_SM_KEY_APPS;
+        range[n].iv = &A[n];
+        range[n].offset = U8(f->data - in);
+        range[n].len = f->dataLen;
+        n++;
+    }
+
+    return LDL_MAC_CONFIG(self)->sm_interface->mic_decrypt(LDL_MAC_CONFIG(self)->sm, LDL_SM_KEY_SNWKSINT, B, U8(sizeof(B->value)), in, len - U8(sizeof(f->mic)), f->mic, range, n);
+}
+
+static bool initDataB(struct ldl_mac *self, const struct ldl_frame_down *f, uint8_t len, struct ldl_block *B)
+{
+    bool retval = false;
+    uint32_t counter;
+
+    if(
+        (self->op == LDL_OP_REJOINING)
+        ||
+        (self->op  == LDL_OP_DATA_UNCONFIRMED)
+        ||
+        (self->op == LDL_OP_DATA_CONFIRMED)
+    ){
+
+        if(self->ctx.devAddr == f->devAddr){
+
+            counter = deriveDownCounter(self, f->port, f->counter);
+
+            if((SESS_VERSION(self->ctx) == 1U) && f->ack){
+
+                initB(B, U16(self->ctx.up-1U), 0U, 0U, false, f->devAddr, counter, len - U8(sizeof(f->mic)));
+            }
+            else{
+
+                initB(B, 0U, 0U, 0U, false, f->devAddr, counter, len - U8(sizeof(f->mic)));
+            }
+
+            retval = true;
+        }
+        else{
+
+            /* devaddr */
+            LDL_DEBUG("devaddr mismatch")
+        }
+    }
+    else{
+
+        /* unexpected frame type */
+        LDL_DEBUG("unexpected frame type")
+    }
+
+    return retval;
+}
+
+static void decryptData(struct ldl_mac *self, const struct ldl_frame_down *f)
+{
+    struct ldl_block A;
+
+#if defined(LDL_ENABLE_L2_1_1)
+    /* V1.1 encrypts the opts */
+    if(SESS_VERSION(self->ctx) == 1U){
+#ifdef LDL_ENABLE_ERRATA_A1
+        /* as per errata 26 Jan 2018 */
+        initA(&A, f->dataPresent ? 2U : 1U, f->devAddr, false, f->counter, 0U);
+#else
+        /* as per 1.1 spec */
+        initA(&A, 0U, f->devAddr, false, f->counter, 0U);
+#endif
+        LDL_MAC_CONFIG(self)->sm_interface->ctr(LDL_MAC_CONFIG(self)->sm, LDL_SM_KEY_NWKSENC, &A, f->opts, f->optsLen);
+    }
+#endif
+    initA(&A, 0U, f->devAddr, false, f->counter, 1U);
+
+    LDL_MAC_CONFIG(self)->sm_interface->ctr(LDL_MAC_CONFIG(self)->sm, (f->port == 0U) ? LDL_SM_KEY_NWKSENC : LDL_SM_KEY_APPS, &A, f->data, f->dataLen);
+}
+
+static uint32_t getMIC(const void *buffer, uint8_t size)
+{
+    struct ldl_stream s;
+    uint32_t mic = 0U;
+
+    LDL_Stream_initReadOnly(&s, buffer, size);
+
+    (void)LDL_Stream_seekSet(&s, size - U8(sizeof(mic)));
+    (void)LDL_Stream_getU32(&s, &mic);
+
+    return mic;
+}
+
+static void updateSessionKeys(struct ldl_mac *self, enum ldl_sm_key root, const struct ldl_sm_derivation *keys, uint8_t numKeys)
+{
+    uint8_t i;
+
+    if(LDL_MAC_CONFIG(self)->sm_interface->update_session_keys != NULL){
+
+        LDL_MAC_CONFIG(self)->sm_interface->update_session_keys(LDL_MAC_CONFIG(self)->sm, root, keys, numKeys);
+    }
+    else{
+
+        for(i=0U; i < numKeys; i++){
+
+            LDL_MAC_CONFIG(self)->sm_interface->update_session_key(LDL_MAC_CONFIG(self)->sm, keys[i].desc, root, keys[i].iv);
+        }
+    }
+}
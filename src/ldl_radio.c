@@ -19,12 +19,82 @@
  *
  * */
 
-#include <string.h>
-
 #include "ldl_debug.h"
 #include "ldl_radio.h"
 #include "ldl_system.h"
 #include "ldl_internal.h"
+#include "ldl_div.h"
+
+#ifdef LDL_ENABLE_AVR
+
+    #include <avr/pgmspace.h>
+
+#else
+
+    #include <string.h>
+
+    #define PROGMEM
+    #define memcpy_P memcpy
+
+#endif
+
+/* static variables ***************************************************/
+
+/* airtime is kept in units of 64us, which is a quarter of the shortest
+ * symbol period (SF7 at 500KHz), so every figure below is a whole number */
+#define AIRTIME_UNIT_US 64U
+
+#define AIRTIME_ENTRY(BW, SF, DE) { \
+    .preamble = U16((U32(324) << ((SF) - 7U)) >> (BW)), \
+    .block = U16((U32(80) << ((SF) - 7U)) >> (BW)), \
+    .k = U8((SF) - ((DE) ? 2U : 0U)), \
+    .div = LDL_DIV_INIT((SF) - ((DE) ? 2U : 0U)) \
+}
+
+/* one entry per bandwidth and spreading factor (low data rate optimise
+ * follows from these for LoRaWAN) */
+static const struct ldl_radio_airtime {
+
+    uint16_t preamble;      /* 12.25 preamble symbols plus the 8 symbol minimum payload */
+    uint16_t block;         /* 5 symbols added for every 4(SF - 2DE) bits of payload */
+    uint8_t k;              /* SF - 2DE */
+    struct ldl_div div;     /* reciprocal of k */
+
+} airtime[3U][6U] PROGMEM = {
+    {
+        AIRTIME_ENTRY(0U, 7U, false),
+        AIRTIME_ENTRY(0U, 8U, false),
+        AIRTIME_ENTRY(0U, 9U, false),
+        AIRTIME_ENTRY(0U, 10U, false),
+        AIRTIME_ENTRY(0U, 11U, true),
+        AIRTIME_ENTRY(0U, 12U, true)
+    },
+    {
+        AIRTIME_ENTRY(1U, 7U, false),
+        AIRTIME_ENTRY(1U, 8U, false),
+        AIRTIME_ENTRY(1U, 9U, false),
+        AIRTIME_ENTRY(1U, 10U, false),
+        AIRTIME_ENTRY(1U, 11U, false),
+        AIRTIME_ENTRY(1U, 12U, false)
+    },
+    {
+        AIRTIME_ENTRY(2U, 7U, false),
+        AIRTIME_ENTRY(2U, 8U, false),
+        AIRTIME_ENTRY(2U, 9U, false),
+        AIRTIME_ENTRY(2U, 10U, false),
+        AIRTIME_ENTRY(2U, 11U, false),
+        AIRTIME_ENTRY(2U, 12U, false)
+    }
+};
+
+static const struct ldl_div msDiv PROGMEM = LDL_DIV_INIT(1000U);
+
+/* 10^6 / 64 */
+static const struct ldl_div unitDiv PROGMEM = LDL_DIV_INIT(15625U);
+
+/* static function prototypes *****************************************/
+
+static uint32_t airTimeUnits(enum ldl_signal_bandwidth bw, enum ldl_spreading_factor sf, uint8_t size, bool crc);
 
 /* functions **********************************************************/
 
@@ -119,59 +189,41 @@ int16_t LDL_Radio_getMinSNR(enum ldl_spreading_factor sf)
 
 uint32_t LDL_Radio_getAirTime(enum ldl_signal_bandwidth bw, enum ldl_spreading_factor sf, uint8_t size, bool crc)
 {
-    /* from 4.1.1.7 of sx1272 datasheet
-     *
-     * Ts (symbol period)
-     * Rs (symbol rate)
-     * PL (payload length)
-     * SF (spreading factor
-     * CRC (presence of trailing CRC)
-     * IH (presence of implicit header)
-     * DE (presence of data rate optimize)
-     * CR (coding rate 1..4)
-     *
-     *
-     * Ts = 1 / Rs
-     * Tpreamble = ( Npreamble x 4.25 ) x Tsym
-     *
-     * Npayload = 8 + max( ceil[( 8PL - 4SF + 28 + 16CRC + 20IH ) / ( 4(SF - 2DE) )] x (CR + 4), 0 )
-     *
-     * Tpayload = Npayload x Ts
-     *
-     * Tpacket = Tpreamble + Tpayload
-     *
-     * */
+    struct ldl_div div;
 
-    bool header;
-    bool lowDataRateOptimize;
-    uint32_t Tpacket;
-    uint32_t Ts;
-    uint32_t Tpreamble;
-    uint32_t numerator;
-    uint32_t denom;
-    uint32_t Npayload;
-    uint32_t Tpayload;
+    (void)memcpy_P(&div, &msDiv, sizeof(div));
 
-    /* optimise this mode according to the datasheet */
-    lowDataRateOptimize = ((bw == LDL_BW_125) && ((sf == LDL_SF_11) || (sf == LDL_SF_12))) ? true : false;
+    /* convert to us to ms and overestimate */
+    return LDL_DIV_divide(&div, airTimeUnits(bw, sf, size, crc) * U32(AIRTIME_UNIT_US)) + U32(1);
+}
 
-    /* lorawan always uses a header */
-    header = true;
+uint32_t LDL_Radio_getAirTimeTicks(enum ldl_signal_bandwidth bw, enum ldl_spreading_factor sf, uint8_t size, bool crc, uint32_t tps)
+{
+    uint32_t units;
+    uint32_t units_s;
+    uint32_t units_r;
+    uint32_t tps_s;
+    uint32_t tps_r;
+    uint32_t part;
+    uint32_t part_s;
+    struct ldl_div div;
 
-    Ts = ((U32(1) << sf) * U32(1000000)) / LDL_Radio_bwToNumber(bw);
-    Tpreamble = (Ts * U32(12)) +  (Ts / U32(4));
+    (void)memcpy_P(&div, &unitDiv, sizeof(div));
 
-    numerator = (U32(8) * U32(size)) - (U32(4) * U32(sf)) + U32(28) + ( crc ? U32(16) : U32(0) ) - ( header ? U32(20) : U32(0) );
-    denom = U32(4) * (U32(sf) - ( lowDataRateOptimize ? U32(2) : U32(0) ));
+    units = airTimeUnits(bw, sf, size, crc);
 
-    Npayload = U32(8) + ((((numerator / denom) + (((numerator % denom) != 0U) ? U32(1) : U32(0))) * (U32(LDL_CR_5) + U32(4))));
+    /* ceil(units x tps / 15625) without a 64 bit product by
+     * splitting both operands into multiples of 15625 and remainders */
+    units_s = LDL_DIV_divide(&div, units);
+    units_r = units - (units_s * U32(15625));
 
-    Tpayload = Npayload * Ts;
+    tps_s = LDL_DIV_divide(&div, tps);
+    tps_r = tps - (tps_s * U32(15625));
 
-    Tpacket = Tpreamble + Tpayload;
+    part = units_r * tps_r;
+    part_s = LDL_DIV_divide(&div, part);
 
-    /* convert to us to ms and overestimate */
-    return (Tpacket / U32(1000)) + U32(1);
+    return (units_s * tps) + (units_r * tps_s) + part_s + ((part > (part_s * U32(15625))) ? U32(1) : U32(0));
 }
 
 uint32_t LDL_Radio_bwToNumber(enum ldl_signal_bandwidth bw)
@@ -194,3 +246,61 @@ uint32_t LDL_Radio_bwToNumber(enum ldl_signal_bandwidth bw)
     return retval;
 }
 
+/* static functions ***************************************************/
+
+static uint32_t airTimeUnits(enum ldl_signal_bandwidth bw, enum ldl_spreading_factor sf, uint8_t size, bool crc)
+{
+    /* from 4.1.1.7 of sx1272 datasheet
+     *
+     * Ts (symbol period)
+     * Rs (symbol rate)
+     * PL (payload length)
+     * SF (spreading factor
+     * CRC (presence of trailing CRC)
+     * IH (presence of implicit header)
+     * DE (presence of data rate optimize)
+     * CR (coding rate 1..4)
+     *
+     *
+     * Ts = 1 / Rs
+     * Tpreamble = ( Npreamble x 4.25 ) x Tsym
+     *
+     * Npayload = 8 + max( ceil[( 8PL - 4SF + 28 + 16CRC + 20IH ) / ( 4(SF - 2DE) )] x (CR + 4), 0 )
+     *
+     * Tpayload = Npayload x Ts
+     *
+     * Tpacket = Tpreamble + Tpayload
+     *
+     * Everything except the number of payload blocks depends only on
+     * bw and sf and comes from the airtime table.
+     *
+     * */
+
+    struct ldl_radio_airtime entry;
+    uint32_t bits;
+    uint32_t offset;
+    uint32_t blocks;
+
+    LDL_PEDANTIC((sf >= LDL_SF_7) && (sf <= LDL_SF_12))
+    LDL_PEDANTIC(bw <= LDL_BW_500)
+
+    (void)memcpy_P(&entry, &airtime[bw][sf - LDL_SF_7], sizeof(entry));
+
+    /* lorawan always uses a header */
+    bits = (U32(8) * U32(size)) + U32(28) + ( crc ? U32(16) : U32(0) );
+    offset = (U32(4) * U32(sf)) + U32(20);
+
+    /* the max( , 0) term */
+    bits = (bits > offset) ? (bits - offset) : U32(0);
+
+    /* ceil(n / 4k) == ceil(ceil(n / 4) / k) */
+    bits = (bits >> 2) + (((bits & U32(3)) != 0U) ? U32(1) : U32(0));
+    blocks = LDL_DIV_divide(&entry.div, bits);
+    blocks += (bits > (blocks * U32(entry.k))) ? U32(1) : U32(0);
+
+    return U32(entry.preamble) + (blocks * U32(entry.block));
+}
+
+#ifndef LDL_ENABLE_AVR
+    #undef memcpy_P
+#endif
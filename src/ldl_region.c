@@ -45,9 +45,287 @@
 
 #include <stddef.h>
 
+/* types **************************************************************/
+
+struct region_rate {
+
+    uint8_t sf;
+    uint8_t bw;
+    uint8_t mtu;        /* 0 if the rate is not defined */
+};
+
+struct region_band {
+
+    uint32_t min;       /* inclusive */
+    uint32_t max;       /* inclusive */
+    uint32_t offTime;
+};
+
+struct region_plan {
+
+    uint8_t first;      /* first channel index in this part of the plan */
+    uint32_t freq;      /* frequency of first channel */
+    uint32_t step;
+    uint8_t minRate;
+    uint8_t maxRate;
+};
+
+/* Everything the MAC needs to know about a region
+ *
+ * The descriptors and the tables they point to are in PROGMEM. On
+ * targets other than AVR a descriptor is read in place.
+ *
+ * */
+struct region_desc {
+
+    const struct region_rate *rates;
+    uint8_t numRates;
+
+    const uint8_t *rx1Rates;
+    uint8_t rx1Offsets;     /* row length of rx1Rates */
+    uint8_t rx1Size;
+
+    /* EU_863_870 has sub-bands, the others are one band */
+    const struct region_band *bands;
+    uint8_t numBands;
+    uint32_t offTime;       /* off time factor if there are no sub-bands */
+
+    uint32_t minFreq;       /* inclusive */
+    uint32_t maxFreq;       /* inclusive */
+
+    /* dynamic channel plan (freq[] are the default channels) */
+    uint32_t defaultFreq[3U];
+    uint8_t minRate;
+    uint8_t maxRate;
+
+    /* fixed channel plan (125KHz channels then 500KHz channels) */
+    struct region_plan plan[2U];
+    uint32_t rx1Freq;
+    uint32_t rx1Step;
+
+    bool dynamic;
+    uint8_t numChannels;
+
+    uint32_t rx2Freq;
+    uint8_t rx2Rate;
+
+    uint8_t maxPower;
+    int16_t eirp;           /* at power index 0 (dBm x 100) */
+
+    uint8_t joinRate;       /* first join rate */
+    uint8_t joinRates;      /* number of rates (descending) to cycle through */
+
+    bool txParamSetup;
+    uint8_t dwellRate;      /* minimum uplink rate when dwell applies */
+
+    const char *name;
+};
+
+/* static variables ***************************************************/
+
+#if defined(LDL_ENABLE_EU_863_870) || defined(LDL_ENABLE_EU_433)
+static const struct region_rate euRates[] PROGMEM = {
+    {.sf = LDL_SF_12, .bw = LDL_BW_125, .mtu = 59U},
+    {.sf = LDL_SF_11, .bw = LDL_BW_125, .mtu = 59U},
+    {.sf = LDL_SF_10, .bw = LDL_BW_125, .mtu = 59U},
+    {.sf = LDL_SF_9, .bw = LDL_BW_125, .mtu = 123U},
+    {.sf = LDL_SF_8, .bw = LDL_BW_125, .mtu = 250U},
+    {.sf = LDL_SF_7, .bw = LDL_BW_125, .mtu = 250U},
+    {.sf = LDL_SF_7, .bw = LDL_BW_250, .mtu = 250U}
+};
+
+static const uint8_t euRX1Rates[] PROGMEM = {
+    0U, 0U, 0U, 0U, 0U, 0U,
+    1U, 0U, 0U, 0U, 0U, 0U,
+    2U, 1U, 0U, 0U, 0U, 0U,
+    3U, 2U, 1U, 0U, 0U, 0U,
+    4U, 3U, 2U, 1U, 0U, 0U,
+    5U, 4U, 3U, 2U, 1U, 0U,
+    6U, 5U, 4U, 3U, 2U, 1U,
+    7U, 6U, 5U, 4U, 3U, 2U,
+};
+#endif
+
+#ifdef LDL_ENABLE_EU_863_870
+static const struct region_band eu868Bands[] PROGMEM = {
+    {.min = U32(863000000), .max = U32(868000000), .offTime = U32(100)},    // 1.0%
+    {.min = U32(868000000), .max = U32(868600000), .offTime = U32(100)},    // 1.0%
+    {.min = U32(868700000), .max = U32(869200000), .offTime = U32(1000)},   // 0.1%
+    {.min = U32(869400000), .max = U32(869650000), .offTime = U32(10)},     // 10.0%
+    {.min = U32(869700000), .max = U32(869999999), .offTime = U32(100)}     // 1.0%
+};
+#endif
+
+#ifdef LDL_ENABLE_US_902_928
+static const struct region_rate usRates[] PROGMEM = {
+    {.sf = LDL_SF_10, .bw = LDL_BW_125, .mtu = 19U},
+    {.sf = LDL_SF_9, .bw = LDL_BW_125, .mtu = 61U},
+    {.sf = LDL_SF_8, .bw = LDL_BW_125, .mtu = 133U},
+    {.sf = LDL_SF_7, .bw = LDL_BW_125, .mtu = 250U},
+    {.sf = LDL_SF_8, .bw = LDL_BW_500, .mtu = 250U},
+    {.mtu = 0U},
+    {.mtu = 0U},
+    {.mtu = 0U},
+    {.sf = LDL_SF_12, .bw = LDL_BW_500, .mtu = 61U},
+    {.sf = LDL_SF_11, .bw = LDL_BW_500, .mtu = 137U},
+    {.sf = LDL_SF_10, .bw = LDL_BW_500, .mtu = 250U},
+    {.sf = LDL_SF_9, .bw = LDL_BW_500, .mtu = 250U},
+    {.sf = LDL_SF_8, .bw = LDL_BW_500, .mtu = 250U},
+    {.sf = LDL_SF_7, .bw = LDL_BW_500, .mtu = 250U}
+};
+
+static const uint8_t usRX1Rates[] PROGMEM = {
+    10U, 9U,  8U,  8U,
+    11U, 10U, 9U,  8U,
+    12U, 11U, 10U, 9U,
+    13U, 12U, 11U, 10U,
+    13U, 13U, 12U, 11U,
+};
+#endif
+
+#ifdef LDL_ENABLE_AU_915_928
+static const struct region_rate auRates[] PROGMEM = {
+    {.sf = LDL_SF_12, .bw = LDL_BW_125, .mtu = 59U},
+    {.sf = LDL_SF_11, .bw = LDL_BW_125, .mtu = 59U},
+    {.sf = LDL_SF_10, .bw = LDL_BW_125, .mtu = 59U},
+    {.sf = LDL_SF_9, .bw = LDL_BW_125, .mtu = 123U},
+    {.sf = LDL_SF_8, .bw = LDL_BW_125, .mtu = 250U},
+    {.sf = LDL_SF_7, .bw = LDL_BW_125, .mtu = 250U},
+    {.sf = LDL_SF_8, .bw = LDL_BW_500, .mtu = 250U},
+    {.mtu = 0U},
+    {.sf = LDL_SF_12, .bw = LDL_BW_500, .mtu = 61U},
+    {.sf = LDL_SF_11, .bw = LDL_BW_500, .mtu = 137U},
+    {.sf = LDL_SF_10, .bw = LDL_BW_500, .mtu = 250U},
+    {.sf = LDL_SF_9, .bw = LDL_BW_500, .mtu = 250U},
+    {.sf = LDL_SF_8, .bw = LDL_BW_500, .mtu = 250U},
+    {.sf = LDL_SF_7, .bw = LDL_BW_500, .mtu = 250U}
+};
+
+static const uint8_t auRX1Rates[] PROGMEM = {
+    8U,  8U,  8U,  8U,  8U,  8U,
+    9U,  8U,  8U,  8U,  8U,  8U,
+    10U, 9U,  8U,  8U,  8U,  8U,
+    11U, 10U, 9U,  8U,  8U,  8U,
+    12U, 11U, 10U, 9U,  8U,  8U,
+    13U, 12U, 11U, 10U, 9U,  8U,
+    13U, 13U, 12U, 11U, 10U, 9U,
+};
+#endif
+
+/* must be in the same order as enum ldl_region */
+static const struct region_desc regions[] PROGMEM = {
+#ifdef LDL_ENABLE_EU_863_870
+    {
+        .rates = euRates,
+        .numRates = U8(sizeof(euRates)/sizeof(*euRates)),
+        .rx1Rates = euRX1Rates,
+        .rx1Offsets = 6U,
+        .rx1Size = U8(sizeof(euRX1Rates)),
+        .bands = eu868Bands,
+        .numBands = U8(sizeof(eu868Bands)/sizeof(*eu868Bands)),
+        .minFreq = U32(863000001),
+        .maxFreq = U32(869999999),
+        .defaultFreq = {U32(868100000), U32(868300000), U32(868500000)},
+        .minRate = 0U,
+        .maxRate = 5U,
+        .dynamic = true,
+        .numChannels = 16U,
+        .rx2Freq = U32(869525000),
+        .rx2Rate = 0U,
+        .maxPower = 7U,
+        .eirp = S16(1600),
+        .joinRate = 5U,
+        .joinRates = U8(6U - U8(MIN_RATE)),
+        .name = "LDL_EU_863_870"
+    },
+#endif
+#ifdef LDL_ENABLE_US_902_928
+    {
+        .rates = usRates,
+        .numRates = U8(sizeof(usRates)/sizeof(*usRates)),
+        .rx1Rates = usRX1Rates,
+        .rx1Offsets = 4U,
+        .rx1Size = U8(sizeof(usRX1Rates)),
+        .minFreq = U32(902000001),
+        .maxFreq = U32(927999999),
+        .plan = {
+            {.first = 0U, .freq = U32(902300000), .step = U32(200000), .minRate = 0U, .maxRate = 3U},
+            {.first = 64U, .freq = U32(903000000), .step = U32(1600000), .minRate = 4U, .maxRate = 4U}
+        },
+        .rx1Freq = U32(923300000),
+        .rx1Step = U32(600000),
+        .numChannels = 72U,
+        .rx2Freq = U32(923300000),
+        .rx2Rate = 8U,
+        .maxPower = 10U,
+        .eirp = S16(3000),
+        .joinRate = MIN_RATE,
+        .joinRates = 1U,
+        .name = "LDL_US_902_928"
+    },
+#endif
+#ifdef LDL_ENABLE_AU_915_928
+    {
+        .rates = auRates,
+        .numRates = U8(sizeof(auRates)/sizeof(*auRates)),
+        .rx1Rates = auRX1Rates,
+        .rx1Offsets = 6U,
+        .rx1Size = U8(sizeof(auRX1Rates)),
+        .minFreq = U32(915000001),
+        .maxFreq = U32(927999999),
+        .plan = {
+            {.first = 0U, .freq = U32(915200000), .step = U32(200000), .minRate = 0U, .maxRate = 5U},
+            {.first = 64U, .freq = U32(915900000), .step = U32(1600000), .minRate = 6U, .maxRate = 6U}
+        },
+        .rx1Freq = U32(923300000),
+        .rx1Step = U32(600000),
+        .numChannels = 72U,
+        .rx2Freq = U32(923300000),
+        .rx2Rate = 8U,
+        .maxPower = 10U,
+        .eirp = S16(3000),
+        .joinRate = 2U,
+        .joinRates = 1U,
+        .txParamSetup = true,
+        .dwellRate = 2U,
+        .name = "LDL_AU_915_928"
+    },
+#endif
+#ifdef LDL_ENABLE_EU_433
+    {
+        .rates = euRates,
+        .numRates = U8(sizeof(euRates)/sizeof(*euRates)),
+        .rx1Rates = euRX1Rates,
+        .rx1Offsets = 6U,
+        .rx1Size = U8(sizeof(euRX1Rates)),
+        .offTime = U32(100),
+        .minFreq = U32(433175000),
+        .maxFreq = U32(434665000),
+        .defaultFreq = {U32(433175000), U32(433375000), U32(433575000)},
+        .minRate = 0U,
+        .maxRate = 5U,
+        .dynamic = true,
+        .numChannels = 16U,
+        .rx2Freq = U32(434665000),
+        .rx2Rate = 0U,
+        .maxPower = 5U,
+        .eirp = S16(1215),
+        .joinRate = 5U,
+        .joinRates = U8(6U - U8(MIN_RATE)),
+        .name = "LDL_EU_433"
+    },
+#endif
+};
+
+#ifdef LDL_ENABLE_AVR
+/* AVR can't read the descriptors in place */
+static struct region_desc avrRegion;
+#endif
+
 /* static function prototypes *****************************************/
 
-static bool upRateRange(enum ldl_region region, uint8_t chIndex, uint8_t *minRate, uint8_t *maxRate);
+static const struct region_desc *getRegion(enum ldl_region region);
+static bool upRateRange(const struct region_desc *desc, uint8_t chIndex, uint8_t *minRate, uint8_t *maxRate);
 
 /* functions **********************************************************/
 
@@ -57,200 +335,28 @@ void LDL_Region_convertRate(enum ldl_region region, uint8_t rate, enum ldl_sprea
     LDL_PEDANTIC(bw != NULL)
     LDL_PEDANTIC(mtu != NULL)
 
-    switch(region){
-#if defined(LDL_ENABLE_EU_863_870) || defined(LDL_ENABLE_EU_433)
-#   ifdef LDL_ENABLE_EU_863_870
-    case LDL_EU_863_870:
-#   endif
-#   ifdef LDL_ENABLE_EU_433
-    case LDL_EU_433:
-#   endif
-        switch(rate){
-        case 0U:
-            *sf = LDL_SF_12;
-            *bw = LDL_BW_125;
-            *mtu = 59U;
-            break;
-        case 1U:
-            *sf = LDL_SF_11;
-            *bw = LDL_BW_125;
-            *mtu = 59U;
-            break;
-        case 2U:
-            *sf = LDL_SF_10;
-            *bw = LDL_BW_125;
-            *mtu = 59U;
-            break;
-        case 3U:
-            *sf = LDL_SF_9;
-            *bw = LDL_BW_125;
-            *mtu = 123U;
-            break;
-        case 4U:
-            *sf = LDL_SF_8;
-            *bw = LDL_BW_125;
-            *mtu = 250U;
-            break;
-        case 5U:
-            *sf = LDL_SF_7;
-            *bw = LDL_BW_125;
-            *mtu = 250U;
-            break;
-        case 6U:
-            *sf = LDL_SF_7;
-            *bw = LDL_BW_250;
-            *mtu = 250U;
-            break;
-        default:
-            *sf = LDL_SF_7;
-            *bw = LDL_BW_125;
-            *mtu = 250U;
-            LDL_INFO("invalid rate")
-            break;
-        }
-        break;
-#endif
-#ifdef LDL_ENABLE_US_902_928
-    case LDL_US_902_928:
-
-        switch(rate){
-        case 0U:
-            *sf = LDL_SF_10;
-            *bw = LDL_BW_125;
-            *mtu = 19U;
-            break;
-        case 1U:
-            *sf = LDL_SF_9;
-            *bw = LDL_BW_125;
-            *mtu = 61U;
-            break;
-        case 2U:
-            *sf = LDL_SF_8;
-            *bw = LDL_BW_125;
-            *mtu = 133U;
-            break;
-        case 3U:
-            *sf = LDL_SF_7;
-            *bw = LDL_BW_125;
-            *mtu = 250U;
-            break;
-        case 4U:
-        case 12U:
-            *sf = LDL_SF_8;
-            *bw = LDL_BW_500;
-            *mtu = 250U;
-            break;
-        case 8U:
-            *sf = LDL_SF_12;
-            *bw = LDL_BW_500;
-            *mtu = 61U;
-            break;
-        case 9U:
-            *sf = LDL_SF_11;
-            *bw = LDL_BW_500;
-            *mtu = 137U;
-            break;
-        case 10U:
-            *sf = LDL_SF_10;
-            *bw = LDL_BW_500;
-            *mtu = 250U;
-            break;
-        case 11U:
-            *sf = LDL_SF_9;
-            *bw = LDL_BW_500;
-            *mtu = 250U;
-            break;
-        case 13U:
-            *sf = LDL_SF_7;
-            *bw = LDL_BW_500;
-            *mtu = 250U;
-            break;
-        default:
-            *sf = LDL_SF_7;
-            *bw = LDL_BW_125;
-            *mtu = 250U;
-            LDL_INFO("invalid rate")
-            break;
-        }
-        break;
-#endif
-#ifdef LDL_ENABLE_AU_915_928
-    case LDL_AU_915_928:
-
-        switch(rate){
-        case 0U:
-            *sf = LDL_SF_12;
-            *bw = LDL_BW_125;
-            *mtu = 59U;
-            break;
-        case 1U:
-            *sf = LDL_SF_11;
-            *bw = LDL_BW_125;
-            *mtu = 59U;
-            break;
-        case 2U:
-            *sf = LDL_SF_10;
-            *bw = LDL_BW_125;
-            *mtu = 59U;
-            break;
-        case 3U:
-            *sf = LDL_SF_9;
-            *bw = LDL_BW_125;
-            *mtu = 123U;
-            break;
-        case 4U:
-            *sf = LDL_SF_8;
-            *bw = LDL_BW_125;
-            *mtu = 250U;
-            break;
-        case 5U:
-            *sf = LDL_SF_7;
-            *bw = LDL_BW_125;
-            *mtu = 250U;
-            break;
-        case 6U:
-        case 12U:
-            *sf = LDL_SF_8;
-            *bw = LDL_BW_500;
-            *mtu = 250U;
-            break;
-        case 8U:
-            *sf = LDL_SF_12;
-            *bw = LDL_BW_500;
-            *mtu = 61U;
-            break;
-        case 9U:
-            *sf = LDL_SF_11;
-            *bw = LDL_BW_500;
-            *mtu = 137U;
-            break;
-        case 10U:
-            *sf = LDL_SF_10;
-            *bw = LDL_BW_500;
-            *mtu = 250U;
-            break;
-        case 11U:
-            *sf = LDL_SF_9;
-            *bw = LDL_BW_500;
-            *mtu = 250U;
-            break;
-        case 13U:
-            *sf = LDL_SF_7;
-            *bw = LDL_BW_500;
-            *mtu = 250U;
-            break;
-        default:
-            *sf = LDL_SF_7;
-            *bw = LDL_BW_125;
-            *mtu = 250U;
-            LDL_INFO("invalid rate")
-            break;
-        }
-        break;
-#endif
-    default:
-        /* impossible */
-        break;
+    const struct region_desc *desc = getRegion(region);
+    struct region_rate entry;
+
+    entry.mtu = 0U;
+
+    if(rate < desc->numRates){
+
+        (void)memcpy_P(&entry, &desc->rates[rate], sizeof(entry));
+    }
+
+    if(entry.mtu > 0U){
+
+        *sf = (enum ldl_spreading_factor)entry.sf;
+        *bw = (enum ldl_signal_bandwidth)entry.bw;
+        *mtu = entry.mtu;
+    }
+    else{
+
+        *sf = LDL_SF_7;
+        *bw = LDL_BW_125;
+        *mtu = 250U;
+        LDL_INFO("invalid rate")
     }
 }
 
@@ -258,44 +364,31 @@ bool LDL_Region_getBand(enum ldl_region region, uint32_t freq, uint8_t *band)
 {
     LDL_PEDANTIC(band != NULL)
 
-    bool retval = false;
-
-    switch(region){
-#ifdef LDL_ENABLE_EU_863_870
-    case LDL_EU_863_870:
-
-        retval = true;
+    const struct region_desc *desc = getRegion(region);
+    struct region_band entry;
+    bool retval;
+    uint8_t i;
 
-        if((freq >= U32(863000000)) && (freq <= U32(868000000))){
+    if(desc->numBands > 0U){
 
-            *band = 0U;
-        }
-        else if((freq >= U32(868000000)) && (freq <= U32(868600000))){
+        retval = false;
 
-            *band = 1U;
-        }
-        else if((freq >= U32(868700000)) && (freq <= U32(869200000))){
+        for(i=0U; i < desc->numBands; i++){
 
-            *band = 2U;
-        }
-        else if((freq >= U32(869400000)) && (freq <= U32(869650000))){
+            (void)memcpy_P(&entry, &desc->bands[i], sizeof(entry));
 
-            *band = 3U;
-        }
-        else if((freq >= U32(869700000)) && (freq < U32(870000000))){
+            if((freq >= entry.min) && (freq <= entry.max)){
 
-            *band = 4U;
+                *band = i;
+                retval = true;
+                break;
+            }
         }
-        else{
+    }
+    else{
 
-            retval = false;
-        }
-        break;
-#endif
-    default:
         *band = 0U;
         retval = true;
-        break;
     }
 
     return retval;
@@ -303,86 +396,24 @@ bool LDL_Region_getBand(enum ldl_region region, uint32_t freq, uint8_t *band)
 
 bool LDL_Region_isDynamic(enum ldl_region region)
 {
-    bool retval;
-
-    switch(region){
-    default:
-        retval = true;
-        break;
-#ifdef LDL_ENABLE_US_902_928
-    case LDL_US_902_928:
-        retval = false;
-        break;
-#endif
-#ifdef LDL_ENABLE_AU_915_928
-    case LDL_AU_915_928:
-        retval = false;
-        break;
-#endif
-    }
-
-    return retval;
+    return getRegion(region)->dynamic;
 }
 
 bool LDL_Region_getChannel(enum ldl_region region, uint8_t chIndex, uint32_t *freq, uint8_t *minRate, uint8_t *maxRate)
 {
+    const struct region_desc *desc = getRegion(region);
+    const struct region_plan *plan;
     bool retval = false;
 
-    (void)chIndex;
-    (void)freq;
-    (void)minRate;
-    (void)maxRate;
-
-    switch(region){
-    default:
-        /* impossible */
-        break;
-#ifdef LDL_ENABLE_US_902_928
-    case LDL_US_902_928:
-
-        retval = true;
+    if(!desc->dynamic && (chIndex < desc->numChannels)){
 
-        if(chIndex < 64U){
+        plan = (chIndex < desc->plan[1].first) ? &desc->plan[0] : &desc->plan[1];
 
-            *freq = U32(902300000) + ( U32(200000) * U32(chIndex));
-            *minRate = 0U;
-            *maxRate = 3U;
-        }
-        else if(chIndex < 72U){
-
-            *freq = U32(903000000) + ( U32(1600000) * U32(chIndex - U32(64)));
-            *minRate = 4U;
-            *maxRate = 4U;
-        }
-        else{
-
-            retval = false;
-        }
-        break;
-#endif
-#ifdef LDL_ENABLE_AU_915_928
-    case LDL_AU_915_928:
+        *freq = plan->freq + (plan->step * U32(chIndex - plan->first));
+        *minRate = plan->minRate;
+        *maxRate = plan->maxRate;
 
         retval = true;
-
-        if(chIndex < 64U){
-
-            *freq = U32(915200000) + ( U32(200000) * U32(chIndex));
-            *minRate = 0U;
-            *maxRate = 5U;
-        }
-        else if(chIndex < 72U){
-
-            *freq = U32(915900000) + ( U32(1600000) * (U32(chIndex) - U32(64)));
-            *minRate = 6U;
-            *maxRate = 6U;
-        }
-        else{
-
-            retval = false;
-        }
-        break;
-#endif
     }
 
     return retval;
@@ -390,59 +421,22 @@ bool LDL_Region_getChannel(enum ldl_region region, uint8_t chIndex, uint32_t *fr
 
 uint8_t LDL_Region_numChannels(enum ldl_region region)
 {
-    uint8_t retval;
-
-    switch(region){
-    default:
-        retval = 16U;
-        break;
-#if defined(LDL_ENABLE_US_902_928)  || defined(LDL_ENABLE_AU_915_928)
-#   ifdef LDL_ENABLE_US_902_928
-    case LDL_US_902_928:
-#   endif
-#   ifdef LDL_ENABLE_AU_915_928
-    case LDL_AU_915_928:
-#   endif
-
-        retval = 72U;
-        break;
-#endif
-    }
-
-    return retval;
+    return getRegion(region)->numChannels;
 }
 
 void LDL_Region_getDefaultChannels(enum ldl_region region, struct ldl_mac *mac)
 {
     LDL_PEDANTIC(mac != NULL)
 
-    uint8_t minRate;
-    uint8_t maxRate;
+    const struct region_desc *desc = getRegion(region);
+    uint8_t i;
 
-    switch(region){
-    default:
-        /* impossible */
-        break;
-#ifdef LDL_ENABLE_EU_863_870
-    case LDL_EU_863_870:
-
-        (void)upRateRange(region, 0U, &minRate, &maxRate);
-
-        (void)LDL_MAC_addChannel(mac, 0U, U32(868100000), minRate, maxRate);
-        (void)LDL_MAC_addChannel(mac, 1U, U32(868300000), minRate, maxRate);
-        (void)LDL_MAC_addChannel(mac, 2U, U32(868500000), minRate, maxRate);
-        break;
-#endif
-#ifdef LDL_ENABLE_EU_433
-    case LDL_EU_433:
+    if(desc->dynamic){
 
-        (void)upRateRange(region, 0U, &minRate, &maxRate);
+        for(i=0U; i < U8(sizeof(desc->defaultFreq)/sizeof(*desc->defaultFreq)); i++){
 
-        (void)LDL_MAC_addChannel(mac, 0U, U32(433175000), minRate, maxRate);
-        (void)LDL_MAC_addChannel(mac, 1U, U32(433375000), minRate, maxRate);
-        (void)LDL_MAC_addChannel(mac, 2U, U32(433575000), minRate, maxRate);
-        break;
-#endif
+            (void)LDL_MAC_addChannel(mac, i, desc->defaultFreq[i], desc->minRate, desc->maxRate);
+        }
     }
 }
 
@@ -474,115 +468,84 @@ static uint8_t unpackCFListMask(const uint8_t *cfList, uint16_t *mask)
 
 void LDL_Region_processCFList(enum ldl_region region, struct ldl_mac *mac, const uint8_t *cfList, uint8_t cfListLen)
 {
-    if(cfListLen == 16U){
+    const struct region_desc *desc = getRegion(region);
 
-        switch(region){
-        default:
-            /* impossible */
-            break;
+    (void)desc;
+    (void)mac;
+    (void)cfList;
 
-#if defined(LDL_ENABLE_EU_863_870) || defined(LDL_ENABLE_EU_433)
+    if(cfListLen == 16U){
 
-#   ifdef LDL_ENABLE_EU_863_870
-        case LDL_EU_863_870:
-#   endif
-#   ifdef LDL_ENABLE_EU_433
-        case LDL_EU_433:
-#   endif
-           /* 0 means frequency list */
-           if(cfList[15] == 0U){
+#if defined(LDL_ENABLE_EU_863_870) || defined(LDL_ENABLE_EU_433)
+        /* 0 means frequency list */
+        if(desc->dynamic && (cfList[15] == 0U)){
 
-                uint8_t minRate;
-                uint8_t maxRate;
-                uint32_t freq;
-                uint8_t i;
-                uint8_t pos;
+            uint8_t minRate;
+            uint8_t maxRate;
+            uint32_t freq;
+            uint8_t i;
+            uint8_t pos;
 
-                for(i=3U,pos=0U; i < 8U; i++){
+            for(i=3U,pos=0U; i < 8U; i++){
 
-                     pos += unpackCFListFreq(&cfList[pos], &freq);
+                 pos += unpackCFListFreq(&cfList[pos], &freq);
 
-                     (void)upRateRange(region, i, &minRate, &maxRate);
+                 (void)upRateRange(desc, i, &minRate, &maxRate);
 
-                     (void)LDL_MAC_addChannel(mac, i, freq, minRate, maxRate);
-                }
+                 (void)LDL_MAC_addChannel(mac, i, freq, minRate, maxRate);
             }
-            break;
+        }
 #endif
-
 #if defined(LDL_ENABLE_US_902_928) || defined(LDL_ENABLE_AU_915_928)
+        /* 1 means mask list */
+        if(!desc->dynamic && (cfList[15] == 1U)){
 
-#   ifdef LDL_ENABLE_US_902_928
-        case LDL_US_902_928:
-#   endif
-#   ifdef LDL_ENABLE_AU_915_928
-        case LDL_AU_915_928:
-#   endif
-            /* 1 means mask list */
-           if(cfList[15] == 1U){
+            uint16_t mask;
+            uint8_t i;
+            uint8_t b;
+            uint8_t pos;
 
-                uint16_t mask;
-                uint8_t i;
-                uint8_t b;
-                uint8_t pos;
+            for(i=0U,pos=0U; i < 5U; i++){
 
-                for(i=0U,pos=0U; i < 5U; i++){
+                pos += unpackCFListMask(&cfList[pos], &mask);
 
-                    pos += unpackCFListMask(&cfList[pos], &mask);
+                 for(b=0U; b < 16U; b++){
 
-                     for(b=0U; b < 16U; b++){
+                    if((mask & (U16(1) << b)) > 0U){
 
-                        if((mask & (U16(1) << b)) > 0U){
-
-                            (void)LDL_MAC_unmaskChannel(mac, (i * 16U) + b);
-                        }
-                        else{
+                        (void)LDL_MAC_unmaskChannel(mac, (i * 16U) + b);
+                    }
+                    else{
 
-                            (void)LDL_MAC_maskChannel(mac, (i * 16U) + b);
-                        }
+                        (void)LDL_MAC_maskChannel(mac, (i * 16U) + b);
                     }
                 }
             }
-            break;
-#endif
         }
+#endif
     }
 }
 
 uint32_t LDL_Region_getOffTimeFactor(enum ldl_region region, uint8_t band)
 {
-    uint32_t retval = 0;
+    const struct region_desc *desc = getRegion(region);
+    struct region_band entry;
+    uint32_t retval;
 
-    switch(region){
-    default:
-        /* impossible */
-        break;
-#ifdef LDL_ENABLE_EU_863_870
-    case LDL_EU_863_870:
-
-        switch(band){
-        case 0U:
-        case 1U:
-        case 4U:
-            retval = U32(100);      // 1.0%
-            break;
-        case 2U:
-            retval = U32(1000);     // 0.1%
-            break;
-        case 3U:
-            retval = U32(10);       // 10.0%
-            break;
-        default:
-            /* impossible */
-            break;
+    if(desc->numBands > 0U){
+
+        retval = 0U;
+
+        if(band < desc->numBands){
+
+            (void)memcpy_P(&entry, &desc->bands[band], sizeof(entry));
+
+            retval = entry.offTime;
         }
-        break;
-#endif
-#ifdef LDL_ENABLE_EU_433
-    case LDL_EU_433:
-        retval = U32(100);
-        break;
-#endif
+    }
+    else{
+
+        retval = desc->offTime;
     }
 
     return retval;
@@ -594,7 +557,7 @@ bool LDL_Region_validateRate(enum ldl_region region, uint8_t chIndex, uint8_t mi
     uint8_t min;
     uint8_t max;
 
-    if(upRateRange(region, chIndex, &min, &max)){
+    if(upRateRange(getRegion(region), chIndex, &min, &max)){
 
         if((minRate >= min) && (maxRate <= max)){
 
@@ -607,7 +570,7 @@ bool LDL_Region_validateRate(enum ldl_region region, uint8_t chIndex, uint8_t mi
 
 bool LDL_Region_validateFreq(enum ldl_region region, uint32_t freq)
 {
-    bool retval;
+    const struct region_desc *desc = getRegion(region);
 
     /* todo: take bw as argument to double check we are actually within bounds
      *
@@ -615,144 +578,40 @@ bool LDL_Region_validateFreq(enum ldl_region region, uint32_t freq)
      *
      * */
 
-    switch(region){
-    default:
-        /* impossible */
-        retval = false;
-        break;
-#ifdef LDL_ENABLE_EU_863_870
-    case LDL_EU_863_870:
-        retval = (freq > U32(863000000)) && (freq < U32(870000000));
-        break;
-#endif
-#ifdef LDL_ENABLE_EU_433
-    case LDL_EU_433:
-        retval = (freq >= U32(433175000)) && (freq <= U32(434665000));
-        break;
-#endif
-#ifdef LDL_ENABLE_US_902_928
-    case LDL_US_902_928:
-        retval = (freq > U32(902000000)) && (freq < U32(928000000));
-        break;
-#endif
-#ifdef LDL_ENABLE_AU_915_928
-    case LDL_AU_915_928:
-        retval = (freq > U32(915000000)) && (freq < U32(928000000));
-        break;
-#endif
-    }
-
-    return retval;
+    return (freq >= desc->minFreq) && (freq <= desc->maxFreq);
 }
 
 void LDL_Region_getRX1DataRate(enum ldl_region region, uint8_t tx_rate, uint8_t rx1_offset, uint8_t *rx1_rate)
 {
     LDL_PEDANTIC(rx1_rate != NULL)
 
-    const uint8_t *ptr = NULL;
-    uint8_t i = 0U;
-    size_t size = 0U;
+    const struct region_desc *desc = getRegion(region);
+    size_t i;
 
-    switch(region){
-    default:
-        /* impossible */
-        break;
-#if defined(LDL_ENABLE_EU_863_870) || defined(LDL_ENABLE_EU_433)
-#   ifdef LDL_ENABLE_EU_863_870
-    case LDL_EU_863_870:
-#   endif
-#   ifdef LDL_ENABLE_EU_433
-    case LDL_EU_433:
-#   endif
-    {
-        static const uint8_t rates[] PROGMEM = {
-            0U, 0U, 0U, 0U, 0U, 0U,
-            1U, 0U, 0U, 0U, 0U, 0U,
-            2U, 1U, 0U, 0U, 0U, 0U,
-            3U, 2U, 1U, 0U, 0U, 0U,
-            4U, 3U, 2U, 1U, 0U, 0U,
-            5U, 4U, 3U, 2U, 1U, 0U,
-            6U, 5U, 4U, 3U, 2U, 1U,
-            7U, 6U, 5U, 4U, 3U, 2U,
-        };
-
-        i = (tx_rate * 6U) + rx1_offset;
-        ptr = rates;
-        size = sizeof(rates);
-    }
-        break;
-#endif
-#ifdef LDL_ENABLE_US_902_928
-    case LDL_US_902_928:
-    {
-        static const uint8_t rates[] PROGMEM = {
-            10U, 9U,  8U,  8U,
-            11U, 10U, 9U,  8U,
-            12U, 11U, 10U, 9U,
-            13U, 12U, 11U, 10U,
-            13U, 13U, 12U, 11U,
-        };
-
-        i = (tx_rate * 4U) + rx1_offset;
-        ptr = rates;
-        size = sizeof(rates);
-    }
-        break;
-#endif
-#ifdef LDL_ENABLE_AU_915_928
-    case LDL_AU_915_928:
-    {
-        static const uint8_t rates[] PROGMEM = {
-            8U,  8U,  8U,  8U,  8U,  8U,
-            9U,  8U,  8U,  8U,  8U,  8U,
-            10U, 9U,  8U,  8U,  8U,  8U,
-            11U, 10U, 9U,  8U,  8U,  8U,
-            12U, 11U, 10U, 9U,  8U,  8U,
-            13U, 12U, 11U, 10U, 9U,  8U,
-            13U, 13U, 12U, 11U, 10U, 9U,
-        };
-
-        i = (tx_rate * 6U) + rx1_offset;
-        ptr = rates;
-        size = sizeof(rates);
-    }
-        break;
-#endif
-    }
+    i = (U32(tx_rate) * U32(desc->rx1Offsets)) + U32(rx1_offset);
 
-    if(ptr != NULL){
+    if(i < desc->rx1Size){
 
-        if(i < size){
-
-            (void)memcpy_P(rx1_rate, &ptr[i], sizeof(*rx1_rate));
-        }
-        else{
+        (void)memcpy_P(rx1_rate, &desc->rx1Rates[i], sizeof(*rx1_rate));
+    }
+    else{
 
-            *rx1_rate = tx_rate;
-            LDL_INFO("out of range error")
-        }
+        *rx1_rate = tx_rate;
+        LDL_INFO("out of range error")
     }
 }
 
 void LDL_Region_getRX1Freq(enum ldl_region region, uint32_t txFreq, uint8_t chIndex, uint32_t *freq)
 {
-    (void)chIndex;
+    const struct region_desc *desc = getRegion(region);
+
+    if(desc->dynamic){
 
-    switch(region){
-    default:
         *freq = txFreq;
-        break;
-#if defined(LDL_ENABLE_US_902_928)  || defined(LDL_ENABLE_AU_915_928)
-#   ifdef LDL_ENABLE_US_902_928
-    case LDL_US_902_928:
-#   endif
-#   ifdef LDL_ENABLE_AU_915_928
-    case LDL_AU_915_928:
-#   endif
-
-        *freq = U32(923300000) + ((U32(chIndex) % U32(8)) * U32(600000));
-        break;
-#endif
+    }
+    else{
+
+        *freq = desc->rx1Freq + (U32(chIndex & 7U) * desc->rx1Step);
     }
 }
 
@@ -779,198 +638,41 @@ uint8_t LDL_Region_getRX1Offset(enum ldl_region region)
 
 uint32_t LDL_Region_getRX2Freq(enum ldl_region region)
 {
-    uint32_t retval;
-
-    switch(region){
-    default:
-#ifdef LDL_ENABLE_EU_863_870
-    case LDL_EU_863_870:
-        retval = U32(869525000);
-        break;
-#endif
-#ifdef LDL_ENABLE_EU_433
-    case LDL_EU_433:
-        retval = U32(434665000);
-        break;
-#endif
-#ifdef LDL_ENABLE_US_902_928
-    case LDL_US_902_928:
-        retval = U32(923300000);
-        break;
-#endif
-#ifdef LDL_ENABLE_AU_915_928
-    case LDL_AU_915_928:
-        retval = U32(923300000);
-        break;
-#endif
-    }
-
-    return retval;
+    return getRegion(region)->rx2Freq;
 }
 
 uint8_t LDL_Region_getRX2Rate(enum ldl_region region)
 {
-    uint8_t retval;
-
-    switch(region){
-    default:
-#ifdef LDL_ENABLE_EU_863_870
-    case LDL_EU_863_870:
-        retval = 0;
-        break;
-#endif
-#ifdef LDL_ENABLE_EU_433
-    case LDL_EU_433:
-        retval = 0;
-        break;
-#endif
-#ifdef LDL_ENABLE_US_902_928
-    case LDL_US_902_928:
-        retval = 8;
-        break;
-#endif
-#ifdef LDL_ENABLE_AU_915_928
-    case LDL_AU_915_928:
-        retval = 8;
-        break;
-#endif
-    }
-
-    return retval;
+    return getRegion(region)->rx2Rate;
 }
 
 bool LDL_Region_validateTXPower(enum ldl_region region, uint8_t power)
 {
-    bool retval = false;
-
-    switch(region){
-#ifdef LDL_ENABLE_EU_863_870
-    case LDL_EU_863_870:
-
-        if(power <= 7U){
-
-            retval = true;
-        }
-        break;
-#endif
-#ifdef LDL_ENABLE_EU_433
-    case LDL_EU_433:
-
-        if(power <= 5U){
-
-            retval = true;
-        }
-        break;
-#endif
-#if defined(LDL_ENABLE_US_902_928)  || defined(LDL_ENABLE_AU_915_928)
-#   ifdef LDL_ENABLE_US_902_928
-    case LDL_US_902_928:
-#   endif
-#   ifdef LDL_ENABLE_AU_915_928
-    case LDL_AU_915_928:
-#   endif
-
-        if(power <= 10U){
-
-            retval = true;
-        }
-        break;
-#endif
-    default:
-        /* impossible */
-        break;
-    }
-
-    return retval;
+    return (power <= getRegion(region)->maxPower);
 }
 
 int16_t LDL_Region_getTXPower(enum ldl_region region, uint8_t power)
 {
-    int16_t retval = 0;
-
-    switch(region){
-#ifdef LDL_ENABLE_EU_863_870
-    case LDL_EU_863_870:
-
-        if(power <= 7U){
-
-            retval = S16(1600) - (S16(power) * S16(200));
-        }
-        else{
-
-            retval = S16(1600 - (7 * 200));
-        }
-        break;
-#endif
-#ifdef LDL_ENABLE_EU_433
-    case LDL_EU_433:
-
-        if(power <= 5U){
-
-            retval = S16(1215) - (S16(power) * S16(200));
-        }
-        else{
-
-            retval = S16(1215 - (5 * 200));
-        }
-        break;
-#endif
-#if defined(LDL_ENABLE_US_902_928)  || defined(LDL_ENABLE_AU_915_928)
-#   ifdef LDL_ENABLE_US_902_928
-    case LDL_US_902_928:
-#   endif
-#   ifdef LDL_ENABLE_AU_915_928
-    case LDL_AU_915_928:
-#   endif
+    const struct region_desc *desc = getRegion(region);
+    uint8_t index;
 
-        if(power <= 10U){
+    index = (power <= desc->maxPower) ? power : desc->maxPower;
 
-            retval = S16(3000) - (S16(power) * S16(200));
-        }
-        else{
-
-            retval = S16(3000 - (10 * 200));
-        }
-        break;
-#endif
-    default:
-        /* impossible */
-        break;
-    }
-
-    return retval;
+    return desc->eirp - (S16(index) * S16(200));
 }
 
 uint8_t LDL_Region_getJoinRate(enum ldl_region region, uint32_t trial)
 {
-    uint8_t retval = 0;
+    const struct region_desc *desc = getRegion(region);
+    uint8_t retval;
 
-    (void)trial;
+    if(desc->joinRates > 1U){
 
-    switch(region){
-#ifdef LDL_ENABLE_EU_863_870
-    case LDL_EU_863_870:
-        retval = U8(5) - U8(trial % U32(6U - U8(MIN_RATE)));
-        break;
-#endif
-#ifdef LDL_ENABLE_EU_433
-    case LDL_EU_433:
-        retval = U8(5) - U8(trial % U32(6U - U8(MIN_RATE)));
-        break;
-#endif
-#ifdef LDL_ENABLE_US_902_928
-    case LDL_US_902_928:
-        retval = MIN_RATE;
-        break;
-#endif
-#ifdef LDL_ENABLE_AU_915_928
-    case LDL_AU_915_928:
-        retval = 2;
-        break;
-#endif
-    default:
-        /* impossible */
-        break;
+        retval = desc->joinRate - U8(trial % U32(desc->joinRates));
+    }
+    else{
+
+        retval = desc->joinRate;
     }
 
     return retval;
@@ -980,39 +682,20 @@ uint8_t LDL_Region_getJoinIndex(enum ldl_region region, uint32_t trial, uint32_t
 {
     uint8_t retval;
 
-    (void)trial;
-    (void)random;
+    if(getRegion(region)->dynamic){
 
-    switch(region){
-    default:
         retval = 0;
-        break;
-#ifdef LDL_ENABLE_US_902_928
-    case LDL_US_902_928:
-
-        if((trial & 1U) > 0U){
-
-            retval = U8(U32(64) + ((trial >> 1) % U32(8)));
-        }
-        else{
-
-            retval = U8((((trial >> 1) % U32(8)) * U32(8)) + (random % U32(8)));
-        }
-        break;
-#endif
-#ifdef LDL_ENABLE_AU_915_928
-    case LDL_AU_915_928:
+    }
+    else{
 
         if((trial & 1U) > 0U){
 
-            retval = U8(U32(64) + ((trial >> 1) % U32(8)));
+            retval = U8(U32(64) + ((trial >> 1) & U32(7)));
         }
         else{
 
-            retval = U8((((trial >> 1) % U32(8)) * U32(8)) + (random % U32(8)));
+            retval = U8((((trial >> 1) & U32(7)) * U32(8)) + (random & U32(7)));
         }
-        break;
-#endif
     }
 
     return retval;
@@ -1037,145 +720,78 @@ uint32_t LDL_Region_getMaxDCycleOffLimit(enum ldl_region region)
 #ifndef LDL_TRACE_DISABLED
 const char *LDL_Region_enumToString(enum ldl_region region)
 {
-    const char *retval;
-
-    switch(region){
-    default:
-        retval = "undefined";
-        break;
-#ifdef LDL_ENABLE_EU_863_870
-    case LDL_EU_863_870:
-        retval = "LDL_EU_863_870";
-        break;
-#endif
-#ifdef LDL_ENABLE_EU_433
-    case LDL_EU_433:
-        retval = "LDL_EU_433";
-        break;
-#endif
-#ifdef LDL_ENABLE_US_902_928
-    case LDL_US_902_928:
-        retval = "LDL_US_902_928";
-        break;
-#endif
-#ifdef LDL_ENABLE_AU_915_928
-    case LDL_AU_915_928:
-        retval = "LDL_AU_915_928";
-        break;
-#endif
-    }
-
-    return retval;
+    return (U32(region) < U32(sizeof(regions)/sizeof(*regions))) ? getRegion(region)->name : "undefined";
 }
 #endif
 
 bool LDL_Region_txParamSetupImplemented(enum ldl_region region)
 {
-    bool retval;
-
-    switch(region){
-#ifdef LDL_ENABLE_AU_915_928
-    case LDL_AU_915_928:
-        retval = true;
-        break;
-#endif
-    default:
-        retval = false;
-        break;
-    }
-
-    return retval;
+    return getRegion(region)->txParamSetup;
 }
 
 uint8_t LDL_Region_applyUplinkDwell(enum ldl_region region, bool dwell, uint8_t rate)
 {
-    uint8_t retval;
-
-    (void)dwell;
-
-    switch(region){
-#ifdef LDL_ENABLE_AU_915_928
-    case LDL_AU_915_928:
+    const struct region_desc *desc = getRegion(region);
 
-        retval = (dwell && (rate < 2U)) ? 2U : rate;
-        break;
-#endif
-    default:
-
-        retval = rate;
-        break;
-    }
-
-    return retval;
+    return (dwell && (rate < desc->dwellRate)) ? desc->dwellRate : rate;
 }
 
 /* static functions ***************************************************/
 
-static bool upRateRange(enum ldl_region region, uint8_t chIndex, uint8_t *minRate, uint8_t *maxRate)
+static const struct region_desc *getRegion(enum ldl_region region)
 {
-    bool retval = false;
+    const struct region_desc *retval;
+    uint32_t index;
 
-    switch(region){
-#if defined(LDL_ENABLE_EU_863_870) || defined(LDL_ENABLE_EU_433)
-#   ifdef LDL_ENABLE_EU_863_870
-    case LDL_EU_863_870:
-#   endif
-#   ifdef LDL_ENABLE_EU_433
-    case LDL_EU_433:
-#   endif
+    LDL_PEDANTIC(U32(region) < U32(sizeof(regions)/sizeof(*regions)))
 
-        if(chIndex < 16U){
+#ifdef LDL_FIXED_REGION
+    (void)region;
 
-            *minRate = 0U;
-            *maxRate = 5U;
-            retval = true;
-        }
-        break;
-#endif
-#ifdef LDL_ENABLE_US_902_928
-    case LDL_US_902_928:
+    index = U32(LDL_FIXED_REGION);
+#else
+    /* single region builds resolve to a constant */
+    if(sizeof(regions) == sizeof(*regions)){
 
-        if(chIndex <= 71U){
+        index = U32(0);
+    }
+    else{
 
-            if(chIndex <= 63U){
+        index = (U32(region) < U32(sizeof(regions)/sizeof(*regions))) ? U32(region) : U32(0);
+    }
+#endif
 
-                *minRate = 0U;
-                *maxRate = 3U;
-            }
-            else{
+#ifdef LDL_ENABLE_AVR
+    (void)memcpy_P(&avrRegion, &regions[index], sizeof(avrRegion));
+    retval = &avrRegion;
+#else
+    retval = &regions[index];
+#endif
 
-                *minRate = 4U;
-                *maxRate = 4U;
-            }
+    return retval;
+}
 
-            retval = true;
-        }
-        break;
-#endif
-#ifdef LDL_ENABLE_AU_915_928
-    case LDL_AU_915_928:
+static bool upRateRange(const struct region_desc *desc, uint8_t chIndex, uint8_t *minRate, uint8_t *maxRate)
+{
+    const struct region_plan *plan;
+    bool retval = false;
 
-        if(chIndex <= 71U){
+    if(chIndex < desc->numChannels){
 
-            if(chIndex <= 63U){
+        if(desc->dynamic){
 
-                *minRate = 0U;
-                *maxRate = 5U;
-            }
-            else{
+            *minRate = desc->minRate;
+            *maxRate = desc->maxRate;
+        }
+        else{
 
-                *minRate = 6U;
-                *maxRate = 6U;
-            }
+            plan = (chIndex < desc->plan[1].first) ? &desc->plan[0] : &desc->plan[1];
 
-            retval = true;
+            *minRate = plan->minRate;
+            *maxRate = plan->maxRate;
         }
-        break;
-#endif
-    default:
-        *minRate = 0U;
-        *maxRate = 0U;
-        break;
+
+        retval = true;
     }
 
     return retval;
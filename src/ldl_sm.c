@@ -29,13 +29,22 @@
 
 #include <string.h>
 
+static uint8_t keyIndex(const struct ldl_sm *self, enum ldl_sm_key desc);
 static void *getKey(struct ldl_sm *self, enum ldl_sm_key desc);
+static uint32_t finishMIC(const struct ldl_cmac_ctx *ctx);
+
+#ifdef LDL_ENABLE_SM_KEY_CACHE
+static const struct ldl_aes_ctx *getSchedule(struct ldl_sm *self, enum ldl_sm_key desc);
+static const struct ldl_cmac_subkeys *getSubkeys(struct ldl_sm *self, enum ldl_sm_key desc);
+#endif
 
 static const struct ldl_sm_interface interface = {
     .update_session_key = LDL_SM_updateSessionKey,
     .mic = LDL_SM_mic,
     .ecb = LDL_SM_ecb,
-    .ctr = LDL_SM_ctr
+    .ctr = LDL_SM_ctr,
+    .update_session_keys = LDL_SM_updateSessionKeys,
+    .mic_decrypt = LDL_SM_micDecrypt
 };
 
 /* functions **********************************************************/
@@ -79,99 +88,230 @@ const struct ldl_sm_interface *LDL_SM_getInterface(void)
 
 void LDL_SM_updateSessionKey(struct ldl_sm *self, enum ldl_sm_key keyDesc, enum ldl_sm_key rootDesc, const void *iv)
 {
+    const struct ldl_sm_derivation key = {
+        .desc = keyDesc,
+        .iv = iv
+    };
+
+    LDL_SM_updateSessionKeys(self, rootDesc, &key, 1U);
+}
+
+void LDL_SM_updateSessionKeys(struct ldl_sm *self, enum ldl_sm_key rootDesc, const struct ldl_sm_derivation *keys, uint8_t numKeys)
+{
+#ifdef LDL_ENABLE_SM_KEY_CACHE
+    const struct ldl_aes_ctx *root = getSchedule(self, rootDesc);
+#else
     struct ldl_aes_ctx ctx;
+    const struct ldl_aes_ctx *root = &ctx;
 
-    switch(keyDesc){
-    case LDL_SM_KEY_FNWKSINT:
-    case LDL_SM_KEY_APPS:
-    case LDL_SM_KEY_SNWKSINT:
-    case LDL_SM_KEY_NWKSENC:
-    case LDL_SM_KEY_JSINT:
-    case LDL_SM_KEY_JSENC:
+    LDL_AES_init(&ctx, getKey(self, rootDesc));
+#endif
+    uint8_t i;
 
-        LDL_AES_init(&ctx, getKey(self, rootDesc));
+    /* root is expanded once and then used for each block */
+    for(i=0U; i < numKeys; i++){
 
-        (void)memcpy(getKey(self, keyDesc), iv, LDL_KEY_SIZE);
+        switch(keys[i].desc){
+        case LDL_SM_KEY_FNWKSINT:
+        case LDL_SM_KEY_APPS:
+        case LDL_SM_KEY_SNWKSINT:
+        case LDL_SM_KEY_NWKSENC:
+        case LDL_SM_KEY_JSINT:
+        case LDL_SM_KEY_JSENC:
 
-        LDL_AES_encrypt(&ctx, getKey(self, keyDesc));
-        break;
+            (void)memcpy(getKey(self, keys[i].desc), keys[i].iv, LDL_KEY_SIZE);
 
-    default:
-        /* not a session key*/
-        break;
+            LDL_AES_encrypt(root, getKey(self, keys[i].desc));
+
+#ifdef LDL_ENABLE_SM_KEY_CACHE
+            /* invalidate the schedule for the key we just changed */
+            self->cached &= ~U8(1U << keyIndex(self, keys[i].desc));
+            self->cachedSubkeys &= ~U8(1U << keyIndex(self, keys[i].desc));
+#endif
+            break;
+
+        default:
+            /* not a session key*/
+            break;
+        }
     }
 }
 
 uint32_t LDL_SM_mic(struct ldl_sm *self, enum ldl_sm_key desc, const void *hdr, uint8_t hdrLen, const void *data, uint8_t dataLen)
 {
-    uint32_t retval;
-    uint8_t mic[sizeof(retval)];
+    struct ldl_cmac_ctx ctx;
+
+#ifdef LDL_ENABLE_SM_KEY_CACHE
+    LDL_CMAC_initWithSubkeys(&ctx, getSchedule(self, desc), getSubkeys(self, desc));
+#else
     struct ldl_aes_ctx aes_ctx;
+
+    LDL_AES_init(&aes_ctx, getKey(self, desc));
+    LDL_CMAC_init(&ctx, &aes_ctx);
+#endif
+    LDL_CMAC_update(&ctx, hdr, hdrLen);
+    LDL_CMAC_update(&ctx, data, dataLen);
+
+    return finishMIC(&ctx);
+}
+
+bool LDL_SM_micDecrypt(struct ldl_sm *self, enum ldl_sm_key desc, const void *hdr, uint8_t hdrLen, void *data, uint8_t dataLen, uint32_t mic, const struct ldl_sm_range *range, uint8_t numRanges)
+{
+    LDL_PEDANTIC((numRanges == 0U) || (range != NULL))
+
+    bool retval;
+    uint8_t i;
+    uint8_t *ptr = (uint8_t *)data;
     struct ldl_cmac_ctx ctx;
+    const struct ldl_aes_ctx *schedule;
+#ifndef LDL_ENABLE_SM_KEY_CACHE
+    struct ldl_aes_ctx aes_ctx;
+    enum ldl_sm_key expanded;
+#endif
 
+#ifdef LDL_ENABLE_SM_KEY_CACHE
+    LDL_CMAC_initWithSubkeys(&ctx, getSchedule(self, desc), getSubkeys(self, desc));
+#else
     LDL_AES_init(&aes_ctx, getKey(self, desc));
     LDL_CMAC_init(&ctx, &aes_ctx);
+    expanded = desc;
+#endif
     LDL_CMAC_update(&ctx, hdr, hdrLen);
     LDL_CMAC_update(&ctx, data, dataLen);
-    LDL_CMAC_finish(&ctx, &mic, U8(sizeof(mic)));
 
-    /* intepret the 4th byte as most significant */
-    retval = mic[3];
-    retval <<= 8;
-    retval |= mic[2];
-    retval <<= 8;
-    retval |= mic[1];
-    retval <<= 8;
-    retval |= mic[0];
+    /* nothing is decrypted until the MIC has been verified */
+    retval = (finishMIC(&ctx) == mic);
+
+    for(i=0U; retval && (i < numRanges); i++){
+
+        LDL_PEDANTIC((i == 0U) || (U16(range[i].offset) >= (U16(range[i-1U].offset) + U16(range[i-1U].len))))
+        LDL_PEDANTIC((U16(range[i].offset) + U16(range[i].len)) <= U16(dataLen))
+
+#ifdef LDL_ENABLE_SM_KEY_CACHE
+        schedule = getSchedule(self, range[i].desc);
+#else
+        /* ranges usually share a key so only expand when it changes */
+        if(range[i].desc != expanded){
+
+            LDL_AES_init(&aes_ctx, getKey(self, range[i].desc));
+            expanded = range[i].desc;
+        }
+
+        schedule = &aes_ctx;
+#endif
+        LDL_CTR_encrypt(schedule, range[i].iv, &ptr[range[i].offset], &ptr[range[i].offset], range[i].len);
+    }
 
-    /* LoRaWAN will encode this least significant byte first */
     return retval;
 }
 
 void LDL_SM_ecb(struct ldl_sm *self, enum ldl_sm_key desc, void *b)
 {
+#ifdef LDL_ENABLE_SM_KEY_CACHE
+    LDL_AES_encrypt(getSchedule(self, desc), b);
+#else
     struct ldl_aes_ctx ctx;
 
     LDL_AES_init(&ctx, getKey(self, desc));
     LDL_AES_encrypt(&ctx, b);
+#endif
 }
 
 void LDL_SM_ctr(struct ldl_sm *self, enum ldl_sm_key desc, const void *iv, void *data, uint8_t len)
 {
+#ifdef LDL_ENABLE_SM_KEY_CACHE
+    LDL_CTR_encrypt(getSchedule(self, desc), iv, data, data, len);
+#else
     struct ldl_aes_ctx ctx;
 
     LDL_AES_init(&ctx, getKey(self, desc));
     LDL_CTR_encrypt(&ctx, iv, data, data, len);
+#endif
 }
 
 /* static functions ***************************************************/
 
-static void *getKey(struct ldl_sm *self, enum ldl_sm_key desc)
+static uint32_t finishMIC(const struct ldl_cmac_ctx *ctx)
 {
-    size_t i = (size_t)desc;
+    uint32_t retval;
+    uint8_t mic[sizeof(retval)];
+
+    LDL_CMAC_finish(ctx, &mic, U8(sizeof(mic)));
+
+    /* intepret the 4th byte as most significant */
+    retval = mic[3];
+    retval <<= 8;
+    retval |= mic[2];
+    retval <<= 8;
+    retval |= mic[1];
+    retval <<= 8;
+    retval |= mic[0];
+
+    /* LoRaWAN will encode this least significant byte first */
+    return retval;
+}
+
+static uint8_t keyIndex(const struct ldl_sm *self, enum ldl_sm_key desc)
+{
+    uint8_t i = U8(desc);
 
 #if defined(LDL_ENABLE_L2_1_0_3) || defined(LDL_ENABLE_L2_1_0_4)
     /* map 1.1.x key set to 1.0.x key set */
     switch(desc){
     case LDL_SM_KEY_APP:
     case LDL_SM_KEY_NWK:
-        i = 0;
+        i = 0U;
         break;
     case LDL_SM_KEY_FNWKSINT:
     case LDL_SM_KEY_SNWKSINT:
     case LDL_SM_KEY_NWKSENC:
     case LDL_SM_KEY_JSINT:
     case LDL_SM_KEY_JSENC:
-        i = 1;
+        i = 1U;
         break;
     case LDL_SM_KEY_APPS:
     default:
-        i = 2;
+        i = 2U;
         break;
     }
 #endif
 
     LDL_PEDANTIC(i < sizeof(self->keys)/sizeof(*self->keys))
 
-    return self->keys[i].value;
+    (void)self;
+
+    return i;
+}
+
+static void *getKey(struct ldl_sm *self, enum ldl_sm_key desc)
+{
+    return self->keys[keyIndex(self, desc)].value;
 }
+
+#ifdef LDL_ENABLE_SM_KEY_CACHE
+static const struct ldl_aes_ctx *getSchedule(struct ldl_sm *self, enum ldl_sm_key desc)
+{
+    uint8_t i = keyIndex(self, desc);
+
+    if((self->cached & U8(1U << i)) == 0U){
+
+        LDL_AES_init(&self->schedule[i], self->keys[i].value);
+        self->cached |= U8(1U << i);
+    }
+
+    return &self->schedule[i];
+}
+
+static const struct ldl_cmac_subkeys *getSubkeys(struct ldl_sm *self, enum ldl_sm_key desc)
+{
+    uint8_t i = keyIndex(self, desc);
+
+    if((self->cachedSubkeys & U8(1U << i)) == 0U){
+
+        LDL_CMAC_initSubkeys(&self->subkeys[i], getSchedule(self, desc));
+        self->cachedSubkeys |= U8(1U << i);
+    }
+
+    return &self->subkeys[i];
+}
+#endif
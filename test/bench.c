@@ -0,0 +1,282 @@
+/* Crypto micro-benchmarks
+ *
+ * Build and run with `make bench`. Each case is repeated until it has
+ * run for at least BENCH_MIN_NS and the result is printed as one CSV
+ * row (or one JSON object per line with --json):
+ *
+ * name,bytes,iterations,ns_per_op,cycles_per_op
+ *
+ * cycles_per_op is left empty (null) where there is no cycle counter.
+ *
+ * */
+
+#include "ldl_aes.h"
+#include "ldl_cmac.h"
+#include "ldl_ctr.h"
+#include "ldl_sm.h"
+#include "cycles.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define BENCH_MIN_NS 20000000ULL
+
+struct bench_case {
+
+    const char *name;
+    void (*fn)(size_t len);
+    const size_t *sizes;    /**< NULL for fixed size operations */
+};
+
+static const uint8_t key[] = {0x2b,0x7e,0x15,0x16,0x28,0xae,0xd2,0xa6,0xab,0xf7,0x15,0x88,0x09,0xcf,0x4f,0x3c};
+static const uint8_t iv[] = {0x01,0x02,0x03,0x04,0x05,0x06,0x07,0x08,0x09,0x0a,0x0b,0x0c,0x0d,0x0e,0x0f,0x10};
+static const uint8_t b0[] = {0x49,0x00,0x00,0x00,0x00,0x00,0x01,0x02,0x03,0x04,0x00,0x00,0x00,0x00,0x00,0x20};
+
+/* frame sizes that follow B0 in a LoRaWAN MIC (smallest frame to largest PHYPayload) */
+static const size_t frame_sizes[] = {13U, 32U, 64U, 128U, 222U, 255U, 0U};
+
+static struct ldl_aes_ctx aes_ctx;
+static struct ldl_sm sm;
+static uint8_t buf[255U];
+static uint8_t frame[255U];
+static volatile uint32_t sink;
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+
+    (void)clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ((uint64_t)ts.tv_sec * 1000000000ULL) + (uint64_t)ts.tv_nsec;
+}
+
+/* cases ******************************************************************/
+
+static void aes_init(size_t len)
+{
+    (void)len;
+
+    LDL_AES_init(&aes_ctx, key);
+}
+
+static void aes_encrypt(size_t len)
+{
+    (void)len;
+
+    LDL_AES_encrypt(&aes_ctx, buf);
+}
+
+static void cmac(size_t len)
+{
+    struct ldl_cmac_ctx ctx;
+    uint8_t mic[4U];
+
+    LDL_CMAC_init(&ctx, &aes_ctx);
+    LDL_CMAC_update(&ctx, b0, sizeof(b0));
+    LDL_CMAC_update(&ctx, buf, (uint8_t)len);
+    LDL_CMAC_finish(&ctx, mic, sizeof(mic));
+
+    sink += mic[0];
+}
+
+static void ctr(size_t len)
+{
+    LDL_CTR_encrypt(&aes_ctx, iv, buf, buf, (uint8_t)len);
+}
+
+static void sm_update_session_key(size_t len)
+{
+    (void)len;
+
+    LDL_SM_updateSessionKey(&sm, LDL_SM_KEY_APPS, LDL_SM_KEY_APP, iv);
+}
+
+static void sm_update_session_keys(size_t len)
+{
+    const struct ldl_sm_derivation keys[] = {
+        {.desc = LDL_SM_KEY_FNWKSINT, .iv = iv},
+        {.desc = LDL_SM_KEY_SNWKSINT, .iv = iv},
+        {.desc = LDL_SM_KEY_NWKSENC, .iv = iv},
+        {.desc = LDL_SM_KEY_APPS, .iv = iv}
+    };
+
+    (void)len;
+
+    LDL_SM_updateSessionKeys(&sm, LDL_SM_KEY_NWK, keys, (uint8_t)(sizeof(keys)/sizeof(*keys)));
+}
+
+static void sm_mic(size_t len)
+{
+    sink += LDL_SM_mic(&sm, LDL_SM_KEY_NWK, b0, sizeof(b0), buf, (uint8_t)len);
+}
+
+static void sm_ecb(size_t len)
+{
+    (void)len;
+
+    LDL_SM_ecb(&sm, LDL_SM_KEY_NWK, buf);
+}
+
+static void sm_ctr(size_t len)
+{
+    LDL_SM_ctr(&sm, LDL_SM_KEY_APPS, iv, buf, (uint8_t)len);
+}
+
+/* MIC of the first len bytes of frame (recalculated when len changes) */
+static uint32_t frame_mic(size_t len)
+{
+    static size_t mic_len;
+    static uint32_t mic;
+
+    if(mic_len != len){
+
+        mic = LDL_SM_mic(&sm, LDL_SM_KEY_NWK, b0, sizeof(b0), frame, (uint8_t)len);
+        mic_len = len;
+    }
+
+    return mic;
+}
+
+static void sm_mic_decrypt(size_t len)
+{
+    const struct ldl_sm_range range = {.desc = LDL_SM_KEY_APPS, .iv = iv, .offset = 0U, .len = (uint8_t)len};
+
+    /* decryption changes buf so start from the frame every time */
+    (void)memcpy(buf, frame, len);
+
+    sink += LDL_SM_micDecrypt(&sm, LDL_SM_KEY_NWK, b0, sizeof(b0), buf, (uint8_t)len, frame_mic(len), &range, 1U) ? 1U : 0U;
+}
+
+static void sm_mic_decrypt_bad_mic(size_t len)
+{
+    const struct ldl_sm_range range = {.desc = LDL_SM_KEY_APPS, .iv = iv, .offset = 0U, .len = (uint8_t)len};
+
+    /* verify only, nothing is decrypted */
+    sink += LDL_SM_micDecrypt(&sm, LDL_SM_KEY_NWK, b0, sizeof(b0), buf, (uint8_t)len, frame_mic(len) ^ 1U, &range, 1U) ? 1U : 0U;
+}
+
+/* what LDL_SM_micDecrypt() replaces */
+static void sm_mic_then_ctr(size_t len)
+{
+    (void)memcpy(buf, frame, len);
+
+    if(LDL_SM_mic(&sm, LDL_SM_KEY_NWK, b0, sizeof(b0), buf, (uint8_t)len) == frame_mic(len)){
+
+        LDL_SM_ctr(&sm, LDL_SM_KEY_APPS, iv, buf, (uint8_t)len);
+    }
+}
+
+static const struct bench_case cases[] = {
+    {.name = "LDL_AES_init", .fn = aes_init},
+    {.name = "LDL_AES_encrypt", .fn = aes_encrypt},
+    {.name = "LDL_CMAC", .fn = cmac, .sizes = frame_sizes},
+    {.name = "LDL_CTR_encrypt", .fn = ctr, .sizes = frame_sizes},
+    {.name = "LDL_SM_updateSessionKey", .fn = sm_update_session_key},
+    {.name = "LDL_SM_updateSessionKeys", .fn = sm_update_session_keys},
+    {.name = "LDL_SM_mic", .fn = sm_mic, .sizes = frame_sizes},
+    {.name = "LDL_SM_ecb", .fn = sm_ecb},
+    {.name = "LDL_SM_ctr", .fn = sm_ctr, .sizes = frame_sizes},
+    {.name = "LDL_SM_micDecrypt", .fn = sm_mic_decrypt, .sizes = frame_sizes},
+    {.name = "LDL_SM_micDecrypt_bad_mic", .fn = sm_mic_decrypt_bad_mic, .sizes = frame_sizes},
+    {.name = "LDL_SM_mic_then_ctr", .fn = sm_mic_then_ctr, .sizes = frame_sizes}
+};
+
+/* runner *****************************************************************/
+
+static void run(const struct bench_case *c, size_t len, int json)
+{
+    uint64_t iterations = 1U;
+    uint64_t i, start_ns, elapsed_ns, start_cycles, elapsed_cycles;
+
+    /* warm up caches and any lazily expanded keys */
+    c->fn(len);
+
+    for(;;){
+
+        start_ns = now_ns();
+        start_cycles = cycles_now();
+
+        for(i=0U; i < iterations; i++){
+
+            c->fn(len);
+        }
+
+        elapsed_cycles = cycles_now() - start_cycles;
+        elapsed_ns = now_ns() - start_ns;
+
+        if(elapsed_ns >= BENCH_MIN_NS){
+
+            break;
+        }
+
+        iterations *= 2U;
+    }
+
+    if(json){
+
+        printf("{\"name\":\"%s\",\"bytes\":%zu,\"iterations\":%llu,\"ns_per_op\":%.1f,\"cycles_per_op\":",
+            c->name, len, (unsigned long long)iterations, (double)elapsed_ns / (double)iterations);
+
+        if(CYCLES_HAVE_TSC){
+
+            printf("%.1f}\n", (double)elapsed_cycles / (double)iterations);
+        }
+        else{
+
+            printf("null}\n");
+        }
+    }
+    else{
+
+        printf("%s,%zu,%llu,%.1f,", c->name, len, (unsigned long long)iterations, (double)elapsed_ns / (double)iterations);
+
+        if(CYCLES_HAVE_TSC){
+
+            printf("%.1f\n", (double)elapsed_cycles / (double)iterations);
+        }
+        else{
+
+            printf("\n");
+        }
+    }
+}
+
+int main(int argc, char **argv)
+{
+    int json = ((argc > 1) && (strcmp(argv[1], "--json") == 0)) ? 1 : 0;
+    size_t i, j;
+
+    (void)memset(buf, 0x5a, sizeof(buf));
+    (void)memset(frame, 0xa5, sizeof(frame));
+
+    LDL_AES_init(&aes_ctx, key);
+
+#if defined(LDL_ENABLE_L2_1_1)
+    LDL_SM_init(&sm, key, key);
+#else
+    LDL_SM_init(&sm, key);
+#endif
+
+    if(!json){
+
+        printf("name,bytes,iterations,ns_per_op,cycles_per_op\n");
+    }
+
+    for(i=0U; i < (sizeof(cases)/sizeof(*cases)); i++){
+
+        if(cases[i].sizes == NULL){
+
+            run(&cases[i], 16U, json);
+        }
+        else{
+
+            for(j=0U; cases[i].sizes[j] != 0U; j++){
+
+                run(&cases[i], cases[i].sizes[j], json);
+            }
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,40 @@
+#ifndef CYCLES_H
+#define CYCLES_H
+
+/* A cycle counter for rough benchmarks
+ *
+ * Uses the time stamp counter on x86 and falls back to a
+ * nanosecond monotonic clock everywhere else.
+ *
+ * */
+
+#include <stdint.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+
+#include <x86intrin.h>
+
+#define CYCLES_HAVE_TSC 1
+
+static inline uint64_t cycles_now(void)
+{
+    return __rdtsc();
+}
+
+#else
+
+#define CYCLES_HAVE_TSC 0
+
+static inline uint64_t cycles_now(void)
+{
+    struct timespec ts;
+
+    (void)clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ((uint64_t)ts.tv_sec * 1000000000ULL) + (uint64_t)ts.tv_nsec;
+}
+
+#endif
+
+#endif
@@ -0,0 +1,151 @@
+/* A platform AES backend for testing LDL_AES_BACKEND_PLATFORM
+ *
+ * This is a straightforward FIPS-197 implementation that derives its
+ * S-box from GF(2^8) arithmetic rather than sharing tables with
+ * ldl_aes.c, so the KAT vectors also serve as a cross-check.
+ *
+ * */
+
+#include "ldl_aes.h"
+
+#include <string.h>
+#include <stdbool.h>
+
+static uint8_t sbox[256];
+static bool sbox_ready;
+
+static uint8_t xtime(uint8_t b)
+{
+    return (uint8_t)((b << 1) ^ (((b & 0x80U) != 0U) ? 0x1bU : 0x00U));
+}
+
+static uint8_t gmul(uint8_t a, uint8_t b)
+{
+    uint8_t p = 0U;
+
+    while(b != 0U){
+
+        if((b & 1U) != 0U){
+
+            p ^= a;
+        }
+
+        a = xtime(a);
+        b >>= 1;
+    }
+
+    return p;
+}
+
+static void init_sbox(void)
+{
+    unsigned x;
+    unsigned i;
+    uint8_t inv;
+    uint8_t s;
+
+    for(x=0U; x < 256U; x++){
+
+        /* x^254 is the multiplicative inverse (and maps 0 to 0) */
+        inv = 1U;
+
+        for(i=0U; i < 254U; i++){
+
+            inv = gmul(inv, (uint8_t)x);
+        }
+
+        s = inv;
+        s ^= (uint8_t)((inv << 1) | (inv >> 7));
+        s ^= (uint8_t)((inv << 2) | (inv >> 6));
+        s ^= (uint8_t)((inv << 3) | (inv >> 5));
+        s ^= (uint8_t)((inv << 4) | (inv >> 4));
+
+        sbox[x] = s ^ 0x63U;
+    }
+
+    sbox_ready = true;
+}
+
+void LDL_AES_init(struct ldl_aes_ctx *ctx, const void *key)
+{
+    uint8_t *w = (uint8_t *)ctx->k;
+    uint8_t rcon = 1U;
+    uint8_t t[4];
+    unsigned i;
+
+    if(!sbox_ready){
+
+        init_sbox();
+    }
+
+    (void)memcpy(w, key, 16U);
+
+    for(i=16U; i < 176U; i += 4U){
+
+        (void)memcpy(t, &w[i - 4U], sizeof(t));
+
+        if((i % 16U) == 0U){
+
+            uint8_t tmp = t[0];
+
+            t[0] = sbox[t[1]] ^ rcon;
+            t[1] = sbox[t[2]];
+            t[2] = sbox[t[3]];
+            t[3] = sbox[tmp];
+
+            rcon = xtime(rcon);
+        }
+
+        w[i] = w[i - 16U] ^ t[0];
+        w[i + 1U] = w[i - 15U] ^ t[1];
+        w[i + 2U] = w[i - 14U] ^ t[2];
+        w[i + 3U] = w[i - 13U] ^ t[3];
+    }
+}
+
+void LDL_AES_encrypt(const struct ldl_aes_ctx *ctx, void *s)
+{
+    const uint8_t *w = (const uint8_t *)ctx->k;
+    uint8_t *state = s;
+    uint8_t tmp[16];
+    unsigned r;
+    unsigned c;
+    unsigned i;
+
+    for(i=0U; i < 16U; i++){
+
+        state[i] ^= w[i];
+    }
+
+    for(r=1U; r <= 10U; r++){
+
+        /* subbytes and shiftrows (state is column major) */
+        for(c=0U; c < 4U; c++){
+
+            for(i=0U; i < 4U; i++){
+
+                tmp[(c * 4U) + i] = sbox[state[(((c + i) % 4U) * 4U) + i]];
+            }
+        }
+
+        /* mixcolumns */
+        if(r < 10U){
+
+            for(c=0U; c < 4U; c++){
+
+                uint8_t *col = &tmp[c * 4U];
+                uint8_t a0 = col[0], a1 = col[1], a2 = col[2], a3 = col[3];
+
+                col[0] = gmul(a0, 2U) ^ gmul(a1, 3U) ^ a2 ^ a3;
+                col[1] = a0 ^ gmul(a1, 2U) ^ gmul(a2, 3U) ^ a3;
+                col[2] = a0 ^ a1 ^ gmul(a2, 2U) ^ gmul(a3, 3U);
+                col[3] = gmul(a0, 3U) ^ a1 ^ a2 ^ gmul(a3, 2U);
+            }
+        }
+
+        for(i=0U; i < 16U; i++){
+
+            state[i] = tmp[i] ^ w[(r * 16U) + i];
+        }
+    }
+}
@@ -0,0 +1,32 @@
+#ifndef REF_LDL_REGION_H
+#define REF_LDL_REGION_H
+
+#include "ldl_region.h"
+
+void REF_Region_convertRate(enum ldl_region region, uint8_t rate, enum ldl_spreading_factor *sf, enum ldl_signal_bandwidth *bw, uint8_t *mtu);
+void REF_Region_getRX1DataRate(enum ldl_region region, uint8_t tx_rate, uint8_t rx1_offset, uint8_t *rx1_rate);
+void REF_Region_getRX1Freq(enum ldl_region region, uint32_t txFreq, uint8_t chIndex, uint32_t *freq);
+bool REF_Region_validateFreq(enum ldl_region region, uint32_t freq);
+bool REF_Region_getBand(enum ldl_region region, uint32_t freq, uint8_t *band);
+bool REF_Region_getChannel(enum ldl_region region, uint8_t chIndex, uint32_t *freq, uint8_t *minRate, uint8_t *maxRate);
+bool REF_Region_validateRate(enum ldl_region region, uint8_t chIndex, uint8_t minRate, uint8_t maxRate);
+bool REF_Region_isDynamic(enum ldl_region region);
+bool REF_Region_validateTXPower(enum ldl_region region, uint8_t power);
+int16_t REF_Region_getTXPower(enum ldl_region region, uint8_t power);
+uint8_t REF_Region_numChannels(enum ldl_region region);
+uint8_t REF_Region_getJA1Delay(enum ldl_region region);
+uint32_t REF_Region_getOffTimeFactor(enum ldl_region region, uint8_t band);
+uint8_t REF_Region_getRX1Delay(enum ldl_region region);
+uint8_t REF_Region_getRX1Offset(enum ldl_region region);
+uint32_t REF_Region_getRX2Freq(enum ldl_region region);
+uint8_t REF_Region_getRX2Rate(enum ldl_region region);
+uint8_t REF_Region_getJoinRate(enum ldl_region region, uint32_t trial);
+uint8_t REF_Region_getJoinIndex(enum ldl_region region, uint32_t trial, uint32_t random);
+void REF_Region_getDefaultChannels(enum ldl_region region, struct ldl_mac *mac);
+void REF_Region_processCFList(enum ldl_region region, struct ldl_mac *mac, const uint8_t *cfList, uint8_t cfListLen);
+uint32_t REF_Region_getMaxDCycleOffLimit(enum ldl_region region);
+const char *REF_Region_enumToString(enum ldl_region region);
+bool REF_Region_txParamSetupImplemented(enum ldl_region region);
+uint8_t REF_Region_applyUplinkDwell(enum ldl_region region, bool dwell, uint8_t rate);
+
+#endif
@@ -5,8 +5,66 @@
 #include "cmocka.h"
 
 #include "ldl_aes.h"
+#include "cycles.h"
 
 #include <string.h>
+#include <stdio.h>
+
+#define BENCH_ITERATIONS 10000U
+
+struct kat {
+
+    uint8_t key[16];
+    uint8_t pt[16];
+    uint8_t ct[16];
+};
+
+/* FIPS-197 appendix B and C.1, and SP800-38A F.1.1 */
+static const struct kat kats[] = {
+    {
+        {0x2b,0x7e,0x15,0x16,0x28,0xae,0xd2,0xa6,0xab,0xf7,0x15,0x88,0x09,0xcf,0x4f,0x3c},
+        {0x32,0x43,0xf6,0xa8,0x88,0x5a,0x30,0x8d,0x31,0x31,0x98,0xa2,0xe0,0x37,0x07,0x34},
+        {0x39,0x25,0x84,0x1d,0x02,0xdc,0x09,0xfb,0xdc,0x11,0x85,0x97,0x19,0x6a,0x0b,0x32}
+    },
+    {
+        {0x00,0x01,0x02,0x03,0x04,0x05,0x06,0x07,0x08,0x09,0x0a,0x0b,0x0c,0x0d,0x0e,0x0f},
+        {0x00,0x11,0x22,0x33,0x44,0x55,0x66,0x77,0x88,0x99,0xaa,0xbb,0xcc,0xdd,0xee,0xff},
+        {0x69,0xc4,0xe0,0xd8,0x6a,0x7b,0x04,0x30,0xd8,0xcd,0xb7,0x80,0x70,0xb4,0xc5,0x5a}
+    },
+    {
+        {0x2b,0x7e,0x15,0x16,0x28,0xae,0xd2,0xa6,0xab,0xf7,0x15,0x88,0x09,0xcf,0x4f,0x3c},
+        {0x6b,0xc1,0xbe,0xe2,0x2e,0x40,0x9f,0x96,0xe9,0x3d,0x7e,0x11,0x73,0x93,0x17,0x2a},
+        {0x3a,0xd7,0x7b,0xb4,0x0d,0x7a,0x36,0x60,0xa8,0x9e,0xca,0xf3,0x24,0x66,0xef,0x97}
+    },
+    {
+        {0x2b,0x7e,0x15,0x16,0x28,0xae,0xd2,0xa6,0xab,0xf7,0x15,0x88,0x09,0xcf,0x4f,0x3c},
+        {0xae,0x2d,0x8a,0x57,0x1e,0x03,0xac,0x9c,0x9e,0xb7,0x6f,0xac,0x45,0xaf,0x8e,0x51},
+        {0xf5,0xd3,0xd5,0x85,0x03,0xb9,0x69,0x9d,0xe7,0x85,0x89,0x5a,0x96,0xfd,0xba,0xaf}
+    },
+    {
+        {0x2b,0x7e,0x15,0x16,0x28,0xae,0xd2,0xa6,0xab,0xf7,0x15,0x88,0x09,0xcf,0x4f,0x3c},
+        {0x30,0xc8,0x1c,0x46,0xa3,0x5c,0xe4,0x11,0xe5,0xfb,0xc1,0x19,0x1a,0x0a,0x52,0xef},
+        {0x43,0xb1,0xcd,0x7f,0x59,0x8e,0xce,0x23,0x88,0x1b,0x00,0xe3,0xed,0x03,0x06,0x88}
+    },
+    {
+        {0x2b,0x7e,0x15,0x16,0x28,0xae,0xd2,0xa6,0xab,0xf7,0x15,0x88,0x09,0xcf,0x4f,0x3c},
+        {0xf6,0x9f,0x24,0x45,0xdf,0x4f,0x9b,0x17,0xad,0x2b,0x41,0x7b,0xe6,0x6c,0x37,0x10},
+        {0x7b,0x0c,0x78,0x5e,0x27,0xe8,0xad,0x3f,0x82,0x23,0x20,0x71,0x04,0x72,0x5d,0xd4}
+    }
+};
+
+static const char *backend_name(void)
+{
+#if defined(LDL_ENABLE_AESNI)
+    return "aesni";
+#elif (LDL_AES_BACKEND == LDL_AES_BACKEND_TTABLE)
+    return "ttable";
+#elif (LDL_AES_BACKEND == LDL_AES_BACKEND_PLATFORM)
+    return "platform";
+#else
+    return "compact";
+#endif
+}
 
 static void test_LDL_AES_init(void **user)
 {
@@ -36,11 +94,78 @@ static void test_LDL_AES_encrypt(void **user)
     assert_memory_equal(ct, out, sizeof(ct));
 }
 
+static void test_LDL_AES_encrypt_kat(void **user)
+{
+    (void)user;
+
+    struct ldl_aes_ctx aes;
+    uint8_t out[16U];
+    size_t i;
+
+    for(i=0U; i < sizeof(kats)/sizeof(*kats); i++){
+
+        memcpy(out, kats[i].pt, sizeof(out));
+        LDL_AES_init(&aes, kats[i].key);
+        LDL_AES_encrypt(&aes, out);
+
+        assert_memory_equal(kats[i].ct, out, sizeof(out));
+    }
+}
+
+static void test_LDL_AES_encrypt_in_place_unaligned(void **user)
+{
+    (void)user;
+
+    struct ldl_aes_ctx aes;
+    uint8_t buf[17U];
+
+    memcpy(&buf[1], kats[0].pt, sizeof(kats[0].pt));
+    LDL_AES_init(&aes, kats[0].key);
+    LDL_AES_encrypt(&aes, &buf[1]);
+
+    assert_memory_equal(kats[0].ct, &buf[1], sizeof(kats[0].ct));
+}
+
+/* not a pass/fail test, prints throughput for the selected backend */
+static void benchmark_LDL_AES(void **user)
+{
+    (void)user;
+
+    struct ldl_aes_ctx aes;
+    uint8_t block[16U];
+    uint64_t start;
+    uint64_t init;
+    uint64_t encrypt;
+    unsigned i;
+
+    memcpy(block, kats[0].pt, sizeof(block));
+
+    LDL_AES_init(&aes, kats[0].key);
+    LDL_AES_encrypt(&aes, block);
+
+    start = cycles_now();
+    for(i=0U; i < BENCH_ITERATIONS; i++){
+        LDL_AES_init(&aes, kats[0].key);
+    }
+    init = (cycles_now() - start) / BENCH_ITERATIONS;
+
+    start = cycles_now();
+    for(i=0U; i < BENCH_ITERATIONS; i++){
+        LDL_AES_encrypt(&aes, block);
+    }
+    encrypt = (cycles_now() - start) / BENCH_ITERATIONS;
+
+    printf("%s backend: LDL_AES_init %llu cycles, LDL_AES_encrypt %llu cycles/block\n", backend_name(), (unsigned long long)init, (unsigned long long)encrypt);
+}
+
 int main(void)
 {
     const struct CMUnitTest tests[] = {
         cmocka_unit_test(test_LDL_AES_init),
-        cmocka_unit_test(test_LDL_AES_encrypt)
+        cmocka_unit_test(test_LDL_AES_encrypt),
+        cmocka_unit_test(test_LDL_AES_encrypt_kat),
+        cmocka_unit_test(test_LDL_AES_encrypt_in_place_unaligned),
+        cmocka_unit_test(benchmark_LDL_AES)
     };
 
     return cmocka_run_group_tests(tests, NULL, NULL);
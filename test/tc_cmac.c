@@ -8,6 +8,38 @@
 #include "ldl_cmac.h"
 
 #include <string.h>
+#include <stdbool.h>
+
+/* when set the vectors are run again with precomputed subkeys */
+static bool use_subkeys;
+static struct ldl_cmac_subkeys subkeys;
+
+static void cmac_init(struct ldl_cmac_ctx *ctx, const struct ldl_aes_ctx *aes_ctx)
+{
+    if(use_subkeys){
+
+        LDL_CMAC_initSubkeys(&subkeys, aes_ctx);
+        LDL_CMAC_initWithSubkeys(ctx, aes_ctx, &subkeys);
+    }
+    else{
+
+        LDL_CMAC_init(ctx, aes_ctx);
+    }
+}
+
+static int setup_subkeys(void **user)
+{
+    (void)user;
+    use_subkeys = true;
+    return 0;
+}
+
+static int teardown_subkeys(void **user)
+{
+    (void)user;
+    use_subkeys = false;
+    return 0;
+}
 
 static void test_LDL_CMAC_mlen0(void **user)
 {
@@ -20,7 +52,7 @@ static void test_LDL_CMAC_mlen0(void **user)
     uint8_t out[16U];
 
     LDL_AES_init(&aes_ctx, key);
-    LDL_CMAC_init(&cmac_ctx, &aes_ctx);
+    cmac_init(&cmac_ctx, &aes_ctx);
     LDL_CMAC_finish(&cmac_ctx, out, sizeof(out));
 
     assert_memory_equal(expectedOut, &out, sizeof(expectedOut));
@@ -38,7 +70,7 @@ static void test_LDL_CMAC_mlen128(void **user)
     uint8_t out[16U];
 
     LDL_AES_init(&aes_ctx, key);
-    LDL_CMAC_init(&cmac_ctx, &aes_ctx);
+    cmac_init(&cmac_ctx, &aes_ctx);
     LDL_CMAC_update(&cmac_ctx, m, sizeof(m));
     LDL_CMAC_finish(&cmac_ctx, out, sizeof(out));
 
@@ -57,7 +89,7 @@ static void test_LDL_CMAC_mlen320(void **user)
     uint8_t out[16U];
 
     LDL_AES_init(&aes_ctx, key);
-    LDL_CMAC_init(&cmac_ctx, &aes_ctx);
+    cmac_init(&cmac_ctx, &aes_ctx);
     LDL_CMAC_update(&cmac_ctx, m, sizeof(m));
     LDL_CMAC_finish(&cmac_ctx, out, sizeof(out));
 
@@ -76,7 +108,7 @@ static void test_LDL_CMAC_mlen320_parts1(void **user)
     uint8_t out[16U];
 
     LDL_AES_init(&aes_ctx, key);
-    LDL_CMAC_init(&cmac_ctx, &aes_ctx);
+    cmac_init(&cmac_ctx, &aes_ctx);
     LDL_CMAC_update(&cmac_ctx, m, 8);
     LDL_CMAC_update(&cmac_ctx, &m[8], sizeof(m)-8);
     LDL_CMAC_finish(&cmac_ctx, out, sizeof(out));
@@ -96,7 +128,7 @@ static void test_LDL_CMAC_mlen320_parts2(void **user)
     uint8_t out[16U];
 
     LDL_AES_init(&aes_ctx, key);
-    LDL_CMAC_init(&cmac_ctx, &aes_ctx);
+    cmac_init(&cmac_ctx, &aes_ctx);
     LDL_CMAC_update(&cmac_ctx, m, 16);
     LDL_CMAC_update(&cmac_ctx, &m[16], sizeof(m)-16);
     LDL_CMAC_finish(&cmac_ctx, out, sizeof(out));
@@ -116,7 +148,7 @@ static void test_LDL_CMAC_mlen320_parts3(void **user)
     uint8_t out[16U];
 
     LDL_AES_init(&aes_ctx, key);
-    LDL_CMAC_init(&cmac_ctx, &aes_ctx);
+    cmac_init(&cmac_ctx, &aes_ctx);
     LDL_CMAC_update(&cmac_ctx, m, 17);
     LDL_CMAC_update(&cmac_ctx, &m[17], sizeof(m)-17);
     LDL_CMAC_finish(&cmac_ctx, out, sizeof(out));
@@ -136,7 +168,7 @@ static void test_LDL_CMAC_mlen512(void **user)
     uint8_t out[16U];
 
     LDL_AES_init(&aes_ctx, key);
-    LDL_CMAC_init(&cmac_ctx, &aes_ctx);
+    cmac_init(&cmac_ctx, &aes_ctx);
     LDL_CMAC_update(&cmac_ctx, m, sizeof(m));
     LDL_CMAC_finish(&cmac_ctx, out, sizeof(out));
 
@@ -155,7 +187,7 @@ static void test_LDL_CMAC_mlen512_parts2(void **user)
     uint8_t out[16U];
 
     LDL_AES_init(&aes_ctx, key);
-    LDL_CMAC_init(&cmac_ctx, &aes_ctx);
+    cmac_init(&cmac_ctx, &aes_ctx);
     LDL_CMAC_update(&cmac_ctx, m, 16);
     LDL_CMAC_update(&cmac_ctx, &m[16], sizeof(m)-16);
     LDL_CMAC_finish(&cmac_ctx, &out, sizeof(out));
@@ -174,6 +206,14 @@ int main(void)
         cmocka_unit_test(test_LDL_CMAC_mlen320_parts3),
         cmocka_unit_test(test_LDL_CMAC_mlen512),
         cmocka_unit_test(test_LDL_CMAC_mlen512_parts2),
+        cmocka_unit_test_setup_teardown(test_LDL_CMAC_mlen0, setup_subkeys, teardown_subkeys),
+        cmocka_unit_test_setup_teardown(test_LDL_CMAC_mlen128, setup_subkeys, teardown_subkeys),
+        cmocka_unit_test_setup_teardown(test_LDL_CMAC_mlen320, setup_subkeys, teardown_subkeys),
+        cmocka_unit_test_setup_teardown(test_LDL_CMAC_mlen320_parts1, setup_subkeys, teardown_subkeys),
+        cmocka_unit_test_setup_teardown(test_LDL_CMAC_mlen320_parts2, setup_subkeys, teardown_subkeys),
+        cmocka_unit_test_setup_teardown(test_LDL_CMAC_mlen320_parts3, setup_subkeys, teardown_subkeys),
+        cmocka_unit_test_setup_teardown(test_LDL_CMAC_mlen512, setup_subkeys, teardown_subkeys),
+        cmocka_unit_test_setup_teardown(test_LDL_CMAC_mlen512_parts2, setup_subkeys, teardown_subkeys),
     };
 
     return cmocka_run_group_tests(tests, NULL, NULL);
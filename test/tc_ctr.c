@@ -0,0 +1,187 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+
+#include "cmocka.h"
+
+#include "ldl_aes.h"
+#include "ldl_ctr.h"
+#include "cycles.h"
+
+#include <string.h>
+#include <stdio.h>
+
+#define BENCH_ITERATIONS 1000U
+
+static const uint8_t key[] = {0x2b,0x7e,0x15,0x16,0x28,0xae,0xd2,0xa6,0xab,0xf7,0x15,0x88,0x09,0xcf,0x4f,0x3c};
+static const uint8_t iv[] = {0x01,0x00,0x00,0x00,0x00,0x00,0x01,0x02,0x03,0x04,0x05,0x00,0x00,0x00,0x00,0x01};
+
+/* the original one block per iteration implementation */
+static void reference_ctr(const struct ldl_aes_ctx *ctx, const void *a_iv, const void *in, void *out, uint8_t len)
+{
+    uint8_t a[16U];
+    uint8_t s[16U];
+    uint8_t pld[16U];
+    uint8_t k;
+    uint8_t i;
+    uint8_t j;
+    uint8_t pos = 0U;
+    uint8_t size;
+
+    k = (len / 16U) + (((len % 16U) != 0U) ? 1U : 0U);
+
+    (void)memcpy(a, a_iv, sizeof(a));
+
+    for(i=0U; i < k; i++){
+
+        size = ((len - pos) >= 16) ? 16U : (uint8_t)(len - pos);
+
+        (void)memset(pld, 0, sizeof(pld));
+        (void)memcpy(pld, &((const uint8_t *)in)[pos], size);
+        (void)memcpy(s, a, sizeof(s));
+
+        a[15U]++;
+
+        LDL_AES_encrypt(ctx, s);
+
+        for(j=0U; j < 16U; j++){
+
+            pld[j] ^= s[j];
+        }
+
+        (void)memcpy(&((uint8_t *)out)[pos], pld, size);
+
+        pos += 16U;
+    }
+}
+
+static void fill(uint8_t *buf, size_t len)
+{
+    size_t i;
+
+    for(i=0U; i < len; i++){
+
+        buf[i] = (uint8_t)((i * 7U) + 3U);
+    }
+}
+
+static void encrypt_matches_reference_for_every_length(void **user)
+{
+    (void)user;
+
+    struct ldl_aes_ctx aes;
+    uint8_t in[UINT8_MAX + 1U];
+    uint8_t expected[UINT8_MAX];
+    uint8_t out[UINT8_MAX + 1U];
+    unsigned len;
+    unsigned offset;
+
+    LDL_AES_init(&aes, key);
+
+    for(len=0U; len <= UINT8_MAX; len++){
+
+        /* exercise unaligned input and output too */
+        for(offset=0U; offset < 2U; offset++){
+
+            fill(&in[offset], len);
+            reference_ctr(&aes, iv, &in[offset], expected, (uint8_t)len);
+
+            LDL_CTR_encrypt(&aes, iv, &in[offset], &out[1U - offset], (uint8_t)len);
+            assert_memory_equal(expected, &out[1U - offset], len);
+
+            LDL_CTR_encrypt(&aes, iv, &in[offset], &in[offset], (uint8_t)len);
+            assert_memory_equal(expected, &in[offset], len);
+        }
+    }
+}
+
+static void keystream_matches_reference_for_every_length(void **user)
+{
+    (void)user;
+
+    struct ldl_aes_ctx aes;
+    uint8_t ks[LDL_CTR_KEYSTREAM_SIZE(UINT8_MAX)];
+    uint8_t data[UINT8_MAX + 1U];
+    uint8_t expected[UINT8_MAX];
+    unsigned len;
+
+    LDL_AES_init(&aes, key);
+
+    for(len=0U; len <= UINT8_MAX; len++){
+
+        fill(&data[1], len);
+        reference_ctr(&aes, iv, &data[1], expected, (uint8_t)len);
+
+        LDL_CTR_keystream(&aes, iv, ks, (uint8_t)len);
+        LDL_CTR_xor(&data[1], ks, (uint8_t)len);
+
+        assert_memory_equal(expected, &data[1], len);
+    }
+}
+
+/* not a pass/fail test, prints cycles per call at typical payload sizes */
+static void benchmark_ctr(void **user)
+{
+    (void)user;
+
+    static const uint8_t sizes[] = {16U, 64U, 222U};
+
+    struct ldl_aes_ctx aes;
+    uint8_t ks[LDL_CTR_KEYSTREAM_SIZE(UINT8_MAX)];
+    uint8_t data[UINT8_MAX];
+    uint64_t start;
+    uint64_t ref, enc, gen, apply;
+    size_t i;
+    unsigned n;
+
+    LDL_AES_init(&aes, key);
+    fill(data, sizeof(data));
+
+    for(i=0U; i < sizeof(sizes); i++){
+
+        reference_ctr(&aes, iv, data, data, sizes[i]);
+
+        start = cycles_now();
+        for(n=0U; n < BENCH_ITERATIONS; n++){
+            reference_ctr(&aes, iv, data, data, sizes[i]);
+        }
+        ref = (cycles_now() - start) / BENCH_ITERATIONS;
+
+        start = cycles_now();
+        for(n=0U; n < BENCH_ITERATIONS; n++){
+            LDL_CTR_encrypt(&aes, iv, data, data, sizes[i]);
+        }
+        enc = (cycles_now() - start) / BENCH_ITERATIONS;
+
+        start = cycles_now();
+        for(n=0U; n < BENCH_ITERATIONS; n++){
+            LDL_CTR_keystream(&aes, iv, ks, sizes[i]);
+        }
+        gen = (cycles_now() - start) / BENCH_ITERATIONS;
+
+        start = cycles_now();
+        for(n=0U; n < BENCH_ITERATIONS; n++){
+            LDL_CTR_xor(data, ks, sizes[i]);
+        }
+        apply = (cycles_now() - start) / BENCH_ITERATIONS;
+
+        printf("%3u bytes: original %llu, LDL_CTR_encrypt %llu, LDL_CTR_keystream %llu + LDL_CTR_xor %llu cycles\n",
+            sizes[i],
+            (unsigned long long)ref,
+            (unsigned long long)enc,
+            (unsigned long long)gen,
+            (unsigned long long)apply
+        );
+    }
+}
+
+int main(void)
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(encrypt_matches_reference_for_every_length),
+        cmocka_unit_test(keystream_matches_reference_for_every_length),
+        cmocka_unit_test(benchmark_ctr)
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
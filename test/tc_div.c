@@ -0,0 +1,154 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+
+#include "cmocka.h"
+
+#include "ldl_div.h"
+#include "ldl_radio.h"
+
+#include <string.h>
+
+/* every quotient changes at a multiple of d so checking both ends of
+ * each step is enough to show the (monotonic) result is exact for every n */
+static void check_every_step(uint32_t d)
+{
+    struct ldl_div div;
+    uint64_t n;
+
+    LDL_DIV_init(&div, d);
+
+    for(n=0U; n <= UINT32_MAX; n += d){
+
+        assert_int_equal(n / d, LDL_DIV_divide(&div, (uint32_t)n));
+
+        if((n + d - 1U) <= UINT32_MAX){
+
+            assert_int_equal((n + d - 1U) / d, LDL_DIV_divide(&div, (uint32_t)(n + d - 1U)));
+        }
+        else{
+
+            assert_int_equal(UINT32_MAX / d, LDL_DIV_divide(&div, UINT32_MAX));
+        }
+    }
+}
+
+/* tests */
+
+static void divide_shall_be_exact_for_timing_divisors(void **user)
+{
+    (void)user;
+
+    check_every_step(1000UL);
+    check_every_step(1024UL);
+    check_every_step(32768UL);
+    check_every_step(125000UL);
+    check_every_step(1000000UL);
+    check_every_step(0x80000001UL);
+    check_every_step(UINT32_MAX);
+}
+
+static void divide_shall_be_exact_at_the_edges_for_any_tps(void **user)
+{
+    struct ldl_div div;
+    uint32_t d, last;
+    size_t i;
+
+    (void)user;
+
+    for(d=1000UL; d <= 1000000UL; d++){
+
+        LDL_DIV_init(&div, d);
+
+        last = (UINT32_MAX / d) * d;
+
+        const uint32_t n[] = {0U, d - 1U, d, d + 1U, last - 1U, last, UINT32_MAX};
+
+        for(i=0U; i < (sizeof(n)/sizeof(*n)); i++){
+
+            assert_int_equal(n[i] / d, LDL_DIV_divide(&div, n[i]));
+        }
+    }
+}
+
+static void divide_shall_be_exact_for_small_divisors(void **user)
+{
+    static const uint32_t divisors[] = {1U, 2U, 3U, 5U, 6U, 7U, 8U, 9U, 10U, 11U, 12U};
+    struct ldl_div div;
+    uint32_t n;
+    size_t i;
+
+    (void)user;
+
+    for(i=0U; i < (sizeof(divisors)/sizeof(*divisors)); i++){
+
+        LDL_DIV_init(&div, divisors[i]);
+
+        for(n=0U; n < 0x100000UL; n++){
+
+            assert_int_equal(n / divisors[i], LDL_DIV_divide(&div, n));
+            assert_int_equal((UINT32_MAX - n) / divisors[i], LDL_DIV_divide(&div, UINT32_MAX - n));
+        }
+    }
+}
+
+static void init_shall_match_constant_initialiser(void **user)
+{
+    static const struct ldl_div constants[] = {
+        LDL_DIV_INIT(1U),
+        LDL_DIV_INIT(7U),
+        LDL_DIV_INIT(1000U),
+        LDL_DIV_INIT(32768U),
+        LDL_DIV_INIT(125000U),
+        LDL_DIV_INIT(1000000U),
+        LDL_DIV_INIT(UINT32_MAX)
+    };
+    static const uint32_t divisors[] = {1U, 7U, 1000U, 32768U, 125000U, 1000000U, UINT32_MAX};
+    struct ldl_div div;
+    size_t i;
+
+    (void)user;
+
+    for(i=0U; i < (sizeof(divisors)/sizeof(*divisors)); i++){
+
+        LDL_DIV_init(&div, divisors[i]);
+
+        assert_int_equal(constants[i].m, div.m);
+        assert_int_equal(constants[i].sh1, div.sh1);
+        assert_int_equal(constants[i].sh2, div.sh2);
+    }
+}
+
+static void symbol_period_shall_match_for_any_tps(void **user)
+{
+    const struct ldl_div div = LDL_DIV_INIT(125000U);
+    uint32_t tps;
+    enum ldl_spreading_factor sf;
+    enum ldl_signal_bandwidth bw;
+
+    (void)user;
+
+    for(tps=1000UL; tps <= 1000000UL; tps++){
+
+        for(sf=LDL_SF_7; sf <= LDL_SF_12; sf++){
+
+            for(bw=LDL_BW_125; bw <= LDL_BW_500; bw++){
+
+                assert_int_equal(((1UL << sf) * tps) / LDL_Radio_bwToNumber(bw), LDL_DIV_divide(&div, (1UL << sf) * tps) >> bw);
+            }
+        }
+    }
+}
+
+int main(void)
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(divide_shall_be_exact_for_timing_divisors),
+        cmocka_unit_test(divide_shall_be_exact_at_the_edges_for_any_tps),
+        cmocka_unit_test(divide_shall_be_exact_for_small_divisors),
+        cmocka_unit_test(init_shall_match_constant_initialiser),
+        cmocka_unit_test(symbol_period_shall_match_for_any_tps),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
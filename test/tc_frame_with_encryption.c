@@ -24,8 +24,8 @@ static void init_mac(struct ldl_mac *mac, const void *key, enum ldl_mac_operatio
     (void)memset(mac, 0, sizeof(*mac));
     (void)memset(&sm, 0, sizeof(sm));
 
-    mac->sm = &sm;
-    mac->sm_interface = LDL_SM_getInterface();;
+    mac->config.sm = &sm;
+    mac->config.sm_interface = LDL_SM_getInterface();;
     mac->op = op;
 
     for(i=0; i < sizeof(sm.keys)/sizeof(*sm.keys); i++){
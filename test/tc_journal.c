@@ -0,0 +1,339 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+
+#include "cmocka.h"
+
+#include "ldl_journal.h"
+
+#include <string.h>
+#include <stdio.h>
+
+#define PAGE_SIZE 512U
+
+/* two flash pages in a temporary file */
+struct file_flash {
+
+    FILE *fd;
+    unsigned erases;
+
+    /* writes are dropped after this many (power cut) */
+    unsigned writes_left;
+};
+
+static void flash_read(void *receiver, uint32_t addr, void *data, size_t size)
+{
+    struct file_flash *self = receiver;
+
+    assert_true((addr + size) <= (2U * PAGE_SIZE));
+
+    assert_int_equal(0, fseek(self->fd, addr, SEEK_SET));
+    assert_int_equal(size, fread(data, 1U, size, self->fd));
+}
+
+static void flash_write(void *receiver, uint32_t addr, const void *data, size_t size)
+{
+    struct file_flash *self = receiver;
+    uint8_t existing[PAGE_SIZE];
+    size_t i;
+
+    assert_true(size <= sizeof(existing));
+
+    flash_read(receiver, addr, existing, size);
+
+    /* NOR can only be programmed once after erase */
+    for(i=0U; i < size; i++){
+
+        assert_int_equal(0xff, existing[i]);
+    }
+
+    if(self->writes_left > 0U){
+
+        self->writes_left--;
+
+        assert_int_equal(0, fseek(self->fd, addr, SEEK_SET));
+        assert_int_equal(size, fwrite(data, 1U, size, self->fd));
+    }
+}
+
+static void flash_erase(void *receiver, uint32_t addr)
+{
+    struct file_flash *self = receiver;
+    uint8_t page[PAGE_SIZE];
+
+    assert_true((addr % PAGE_SIZE) == 0U);
+    assert_true(addr < (2U * PAGE_SIZE));
+
+    (void)memset(page, 0xff, sizeof(page));
+
+    assert_int_equal(0, fseek(self->fd, addr, SEEK_SET));
+    assert_int_equal(sizeof(page), fwrite(page, 1U, sizeof(page), self->fd));
+
+    self->erases++;
+}
+
+static const struct ldl_journal_flash flash_interface = {
+    .read = flash_read,
+    .write = flash_write,
+    .erase = flash_erase
+};
+
+static void init_journal(struct ldl_journal *self, struct file_flash *flash)
+{
+    struct ldl_journal_init_arg arg;
+
+    arg.flash = &flash_interface;
+    arg.receiver = flash;
+    arg.pageSize = PAGE_SIZE;
+
+    assert_true(LDL_Journal_init(self, &arg));
+}
+
+static void init_session(struct ldl_mac_session *session)
+{
+    size_t i;
+
+    for(i=0U; i < sizeof(*session); i++){
+
+        ((uint8_t *)session)[i] = (uint8_t)i;
+    }
+
+    session->up = 0U;
+}
+
+static void assert_restored(struct file_flash *flash, const struct ldl_mac_session *expected)
+{
+    struct ldl_journal journal;
+    struct ldl_mac_session session;
+
+    init_journal(&journal, flash);
+
+    assert_true(LDL_Journal_restore(&journal, &session));
+    assert_memory_equal(expected, &session, sizeof(session));
+}
+
+static int setup_flash(void **user)
+{
+    static struct file_flash flash;
+    uint8_t page[PAGE_SIZE];
+
+    (void)memset(&flash, 0, sizeof(flash));
+    (void)memset(page, 0xff, sizeof(page));
+
+    flash.fd = tmpfile();
+    flash.writes_left = UINT32_MAX;
+
+    assert_non_null(flash.fd);
+
+    assert_int_equal(sizeof(page), fwrite(page, 1U, sizeof(page), flash.fd));
+    assert_int_equal(sizeof(page), fwrite(page, 1U, sizeof(page), flash.fd));
+
+    *user = &flash;
+
+    return 0;
+}
+
+static int teardown_flash(void **user)
+{
+    struct file_flash *flash = *user;
+
+    (void)fclose(flash->fd);
+
+    return 0;
+}
+
+/* tests */
+
+static void restore_shall_return_false_when_empty(void **user)
+{
+    struct file_flash *flash = *user;
+    struct ldl_journal journal;
+    struct ldl_mac_session session;
+
+    init_journal(&journal, flash);
+
+    assert_false(LDL_Journal_restore(&journal, &session));
+}
+
+static void session_shall_be_restored(void **user)
+{
+    struct file_flash *flash = *user;
+    struct ldl_journal journal;
+    struct ldl_mac_session session;
+
+    init_session(&session);
+
+    init_journal(&journal, flash);
+
+    /* first update writes everything whatever has changed */
+    LDL_Journal_update(&journal, &session, 1U << LDL_SESSION_UP);
+
+    assert_int_equal(1, flash->erases);
+
+    assert_restored(flash, &session);
+}
+
+static void changed_fields_shall_be_restored(void **user)
+{
+    struct file_flash *flash = *user;
+    struct ldl_journal journal;
+    struct ldl_mac_session session;
+
+    init_session(&session);
+
+    init_journal(&journal, flash);
+
+    LDL_Journal_update(&journal, &session, LDL_SESSION_ALL);
+
+    session.rate = 5U;
+    session.power = 2U;
+    session.chMask[0] = 0xaaU;
+
+    LDL_Journal_update(&journal, &session, (1U << LDL_SESSION_TX) | (1U << LDL_SESSION_CH_MASK));
+
+    assert_int_equal(1, flash->erases);
+
+    assert_restored(flash, &session);
+}
+
+static void counter_updates_shall_erase_only_when_page_is_full(void **user)
+{
+    struct file_flash *flash = *user;
+    struct ldl_journal journal;
+    struct ldl_mac_session session;
+    unsigned i;
+
+    init_session(&session);
+
+    init_journal(&journal, flash);
+
+    for(i=0U; i < 1000U; i++){
+
+        session.up++;
+
+        LDL_Journal_update(&journal, &session, 1U << LDL_SESSION_UP);
+    }
+
+    printf("1000 counter updates: %u erases\n", flash->erases);
+
+    /* a page holds a session and about 40 counter records */
+    assert_true(flash->erases <= 30U);
+
+    assert_restored(flash, &session);
+}
+
+static void journal_shall_resume_after_restore(void **user)
+{
+    struct file_flash *flash = *user;
+    struct ldl_journal journal;
+    struct ldl_mac_session session;
+    unsigned i;
+
+    init_session(&session);
+
+    /* reboot after every update */
+    for(i=0U; i < 100U; i++){
+
+        init_journal(&journal, flash);
+
+        session.up++;
+
+        LDL_Journal_update(&journal, &session, 1U << LDL_SESSION_UP);
+
+        assert_restored(flash, &session);
+    }
+
+    assert_true(flash->erases <= 4U);
+}
+
+static void power_cut_shall_restore_previous_or_next_session(void **user)
+{
+    struct file_flash *flash = *user;
+    struct ldl_journal journal;
+    struct ldl_mac_session previous;
+    struct ldl_mac_session next;
+    struct ldl_mac_session session;
+    unsigned cut;
+    unsigned i;
+
+    init_session(&previous);
+
+    init_journal(&journal, flash);
+
+    LDL_Journal_update(&journal, &previous, LDL_SESSION_ALL);
+
+    /* cut the power after each write of an update (including one that compacts) */
+    for(i=0U; i < 60U; i++){
+
+        for(cut=0U; cut < 64U; cut++){
+
+            (void)memcpy(&next, &previous, sizeof(next));
+
+            next.up++;
+            next.devNonce++;
+
+            init_journal(&journal, flash);
+
+            flash->writes_left = cut;
+
+            LDL_Journal_update(&journal, &next, (1U << LDL_SESSION_UP) | (1U << LDL_SESSION_DEV_NONCE));
+
+            flash->writes_left = UINT32_MAX;
+
+            init_journal(&journal, flash);
+
+            assert_true(LDL_Journal_restore(&journal, &session));
+
+            if(memcmp(&session, &next, sizeof(session)) == 0){
+
+                break;
+            }
+
+            assert_memory_equal(&previous, &session, sizeof(session));
+        }
+
+        /* unlimited writes always complete */
+        assert_true(cut < 64U);
+
+        (void)memcpy(&previous, &next, sizeof(previous));
+    }
+
+    assert_true(flash->erases > 1U);
+}
+
+static void undersized_page_shall_be_rejected(void **user)
+{
+    struct file_flash *flash = (struct file_flash *)(*user);
+    struct ldl_journal journal;
+    struct ldl_journal_init_arg arg;
+    struct ldl_mac_session session;
+
+    arg.flash = &flash_interface;
+    arg.receiver = flash;
+    /* smaller than one record per field */
+    arg.pageSize = sizeof(session);
+
+    assert_false(LDL_Journal_init(&journal, &arg));
+
+    init_session(&session);
+
+    LDL_Journal_update(&journal, &session, LDL_SESSION_ALL);
+
+    assert_false(LDL_Journal_restore(&journal, &session));
+    assert_int_equal(0U, flash->erases);
+}
+
+int main(void)
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(restore_shall_return_false_when_empty, setup_flash, teardown_flash),
+        cmocka_unit_test_setup_teardown(undersized_page_shall_be_rejected, setup_flash, teardown_flash),
+        cmocka_unit_test_setup_teardown(session_shall_be_restored, setup_flash, teardown_flash),
+        cmocka_unit_test_setup_teardown(changed_fields_shall_be_restored, setup_flash, teardown_flash),
+        cmocka_unit_test_setup_teardown(counter_updates_shall_erase_only_when_page_is_full, setup_flash, teardown_flash),
+        cmocka_unit_test_setup_teardown(journal_shall_resume_after_restore, setup_flash, teardown_flash),
+        cmocka_unit_test_setup_teardown(power_cut_shall_restore_previous_or_next_session, setup_flash, teardown_flash),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,1507 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+
+#include "cmocka.h"
+
+#include "ldl_mac.h"
+#include "ldl_mac_internal.h"
+#include "ldl_region.h"
+#include "ldl_sm.h"
+#include "ldl_sm_internal.h"
+#include "ldl_ops.h"
+#include "ldl_radio.h"
+#include "ldl_frame.h"
+#include "debug_include.h"
+#include "cycles.h"
+
+#include <string.h>
+#include <stdio.h>
+
+/* drives ldl_mac through whole operations against a simulated radio
+ * and a security module that counts how often it is used */
+
+#define TPS 32768U
+#define MAX_STEPS 10000U
+#define BENCH_ITERATIONS 1000U
+
+/* calls to sm_interface->mic needed to send one uplink */
+#if defined(LDL_ENABLE_L2_1_1)
+    #define UPLINK_MIC_CALLS 2U
+#else
+    #define UPLINK_MIC_CALLS 1U
+#endif
+
+/* calls to sm_interface->mic needed to send a retransmission */
+#if defined(LDL_ENABLE_SINGLE_BUFFER)
+    #define RETRY_MIC_CALLS UPLINK_MIC_CALLS
+#elif defined(LDL_ENABLE_L2_1_1)
+    #define RETRY_MIC_CALLS 1U
+#else
+    #define RETRY_MIC_CALLS 0U
+#endif
+
+/* session keys derived from each root key on 1.0 (NWK) and 1.1 (NWK, APP) */
+#if defined(LDL_ENABLE_L2_1_1)
+    #define SESSION_KEY_ROOTS 2U
+#else
+    #define SESSION_KEY_ROOTS 1U
+#endif
+
+struct mock_radio {
+
+    enum ldl_radio_mode mode;
+    bool pending;
+    struct ldl_radio_status status;
+
+    unsigned tx_count;
+    uint8_t tx_buffer[UINT8_MAX];
+    uint8_t tx_len;
+
+    /* answer the next receive window with this frame */
+    uint8_t rx_buffer[UINT8_MAX];
+    uint8_t rx_len;
+};
+
+struct mock_app {
+
+    unsigned complete;
+    unsigned timeout;
+
+    unsigned rx_count;
+    uint8_t rx_port;
+    uint8_t rx_data[UINT8_MAX];
+    uint8_t rx_len;
+
+    unsigned session_updates;
+    uint16_t session_changed;   /* from the last LDL_MAC_SESSION_UPDATED */
+
+    /* as saved by a store that only writes changed fields */
+    struct ldl_mac_session saved;
+    unsigned up_saves;
+};
+
+struct mock_sm_count {
+
+    unsigned mic;
+    unsigned mic_decrypt;
+    unsigned begin_mic;
+    unsigned ecb;
+    unsigned ctr;
+    unsigned update_session_key;
+    unsigned update_session_keys;
+};
+
+/* the SM answers begin_mic after this many ticks */
+#define SM_LATENCY (TPS / 100U)
+
+struct mock_slow_sm {
+
+    bool pending;
+    uint32_t mic;
+};
+
+static uint32_t now;
+static struct mock_slow_sm slow_sm;
+static struct mock_radio radio;
+static struct mock_sm_count sm_count;
+static struct ldl_sm sm;
+static struct mock_app app;
+static const struct ldl_sm_interface *sm_interface;
+static uint32_t rand_value;
+static unsigned ticks_count;
+static unsigned process_count;
+
+static const uint8_t key[] = {0x2b,0x7e,0x15,0x16,0x28,0xae,0xd2,0xa6,0xab,0xf7,0x15,0x88,0x09,0xcf,0x4f,0x3c};
+static const uint8_t eui[] = {0x00,0x01,0x02,0x03,0x04,0x05,0x06,0x07};
+
+/* radio ******************************************************************/
+
+static void radio_set_mode(struct ldl_radio *self, enum ldl_radio_mode mode)
+{
+    (void)self;
+
+    radio.mode = mode;
+}
+
+static uint32_t radio_read_entropy(struct ldl_radio *self)
+{
+    (void)self;
+
+    return 0U;
+}
+
+static uint8_t radio_read_buffer(struct ldl_radio *self, struct ldl_radio_packet_metadata *meta, void *data, uint8_t max)
+{
+    uint8_t len = (radio.rx_len > max) ? max : radio.rx_len;
+
+    (void)self;
+
+    (void)memset(meta, 0, sizeof(*meta));
+    (void)memcpy(data, radio.rx_buffer, len);
+
+    radio.rx_len = 0U;
+
+    return len;
+}
+
+static void radio_transmit(struct ldl_radio *self, const struct ldl_radio_tx_setting *settings, const void *data, uint8_t len)
+{
+    (void)self;
+    (void)settings;
+
+    radio.tx_count++;
+    (void)memcpy(radio.tx_buffer, data, len);
+    radio.tx_len = len;
+
+    (void)memset(&radio.status, 0, sizeof(radio.status));
+    radio.status.tx = true;
+    radio.pending = true;
+}
+
+static void radio_receive(struct ldl_radio *self, const struct ldl_radio_rx_setting *settings)
+{
+    (void)self;
+    (void)settings;
+
+    /* the network only answers if a downlink has been queued */
+    (void)memset(&radio.status, 0, sizeof(radio.status));
+    radio.status.rx = (radio.rx_len > 0U);
+    radio.status.timeout = !radio.status.rx;
+    radio.pending = true;
+}
+
+static void radio_receive_entropy(struct ldl_radio *self)
+{
+    (void)self;
+}
+
+static void radio_get_status(struct ldl_radio *self, struct ldl_radio_status *status)
+{
+    (void)self;
+
+    *status = radio.status;
+}
+
+static const struct ldl_radio_interface radio_interface = {
+    .set_mode = radio_set_mode,
+    .read_entropy = radio_read_entropy,
+    .read_buffer = radio_read_buffer,
+    .transmit = radio_transmit,
+    .receive = radio_receive,
+    .receive_entropy = radio_receive_entropy,
+    .get_status = radio_get_status
+};
+
+/* security module ********************************************************/
+
+static void sm_update_session_key(struct ldl_sm *self, enum ldl_sm_key key_desc, enum ldl_sm_key root_desc, const void *iv)
+{
+    sm_count.update_session_key++;
+    LDL_SM_getInterface()->update_session_key(self, key_desc, root_desc, iv);
+}
+
+static void sm_update_session_keys(struct ldl_sm *self, enum ldl_sm_key root_desc, const struct ldl_sm_derivation *keys, uint8_t numKeys)
+{
+    sm_count.update_session_keys++;
+    LDL_SM_getInterface()->update_session_keys(self, root_desc, keys, numKeys);
+}
+
+static uint32_t sm_mic(struct ldl_sm *self, enum ldl_sm_key desc, const void *hdr, uint8_t hdrLen, const void *data, uint8_t dataLen)
+{
+    sm_count.mic++;
+    return LDL_SM_getInterface()->mic(self, desc, hdr, hdrLen, data, dataLen);
+}
+
+static bool sm_mic_decrypt(struct ldl_sm *self, enum ldl_sm_key desc, const void *hdr, uint8_t hdrLen, void *data, uint8_t dataLen, uint32_t mic, const struct ldl_sm_range *range, uint8_t numRanges)
+{
+    sm_count.mic_decrypt++;
+    return LDL_SM_getInterface()->mic_decrypt(self, desc, hdr, hdrLen, data, dataLen, mic, range, numRanges);
+}
+
+static void sm_ecb(struct ldl_sm *self, enum ldl_sm_key desc, void *b)
+{
+    sm_count.ecb++;
+    LDL_SM_getInterface()->ecb(self, desc, b);
+}
+
+static void sm_ctr(struct ldl_sm *self, enum ldl_sm_key desc, const void *iv, void *data, uint8_t len)
+{
+    sm_count.ctr++;
+    LDL_SM_getInterface()->ctr(self, desc, iv, data, len);
+}
+
+#ifdef LDL_ENABLE_ASYNC_SM
+static void sm_begin_mic(struct ldl_sm *self, enum ldl_sm_key desc, const void *hdr, uint8_t hdrLen, const void *data, uint8_t dataLen)
+{
+    sm_count.begin_mic++;
+
+    /* only one operation at a time */
+    assert_false(slow_sm.pending);
+
+    /* a real SM would start a transaction here */
+    slow_sm.mic = LDL_SM_getInterface()->mic(self, desc, hdr, hdrLen, data, dataLen);
+    slow_sm.pending = true;
+}
+#endif
+
+static const struct ldl_sm_interface sm_interface_split = {
+    .update_session_key = sm_update_session_key,
+    .mic = sm_mic,
+    .ecb = sm_ecb,
+    .ctr = sm_ctr
+};
+
+static const struct ldl_sm_interface sm_interface_fused = {
+    .update_session_key = sm_update_session_key,
+    .mic = sm_mic,
+    .ecb = sm_ecb,
+    .ctr = sm_ctr,
+    .update_session_keys = sm_update_session_keys,
+    .mic_decrypt = sm_mic_decrypt
+};
+
+#ifdef LDL_ENABLE_ASYNC_SM
+static const struct ldl_sm_interface sm_interface_async = {
+    .update_session_key = sm_update_session_key,
+    .mic = sm_mic,
+    .ecb = sm_ecb,
+    .ctr = sm_ctr,
+    .update_session_keys = sm_update_session_keys,
+    .mic_decrypt = sm_mic_decrypt,
+    .begin_mic = sm_begin_mic
+};
+#endif
+
+/* system *****************************************************************/
+
+static uint32_t system_ticks(void *self)
+{
+    (void)self;
+
+    ticks_count++;
+
+    return now;
+}
+
+static uint32_t system_rand(void *self)
+{
+    (void)self;
+
+    return rand_value;
+}
+
+#ifdef LDL_ENABLE_CONST_CONFIG
+static uint8_t system_get_battery_level(void *self)
+{
+    (void)self;
+
+    return 255U;
+}
+#endif
+
+static void save_changed_fields(struct ldl_mac_session *saved, const struct ldl_mac_session *session, uint16_t changed)
+{
+    size_t offset;
+    size_t size;
+    unsigned i;
+
+    for(i=0U; i < LDL_SESSION_FIELD_MAX; i++){
+
+        if((changed & (1U << i)) > 0U){
+
+            assert_true(LDL_MAC_getSessionField((enum ldl_mac_session_field)i, &offset, &size));
+
+            (void)memcpy(&((uint8_t *)saved)[offset], &((const uint8_t *)session)[offset], size);
+        }
+    }
+}
+
+static void handler(void *self, enum ldl_mac_response_type type, const union ldl_mac_response_arg *arg)
+{
+    struct mock_app *a = (struct mock_app *)self;
+
+    switch(type){
+    case LDL_MAC_RX:
+        a->rx_count++;
+        a->rx_port = arg->rx.port;
+        a->rx_len = arg->rx.size;
+        (void)memcpy(a->rx_data, arg->rx.data, arg->rx.size);
+        break;
+    case LDL_MAC_DATA_COMPLETE:
+        a->complete++;
+        break;
+    case LDL_MAC_DATA_TIMEOUT:
+        a->timeout++;
+        break;
+    case LDL_MAC_SESSION_UPDATED:
+        a->session_updates++;
+        a->session_changed = arg->session_updated.changed;
+        a->up_saves += ((arg->session_updated.changed & (1U << LDL_SESSION_UP)) > 0U) ? 1U : 0U;
+        save_changed_fields(&a->saved, arg->session_updated.session, arg->session_updated.changed);
+        break;
+    default:
+        break;
+    }
+}
+
+/* harness ****************************************************************/
+
+/* every invocation must work from a single time snapshot */
+static void process(struct ldl_mac *self)
+{
+    unsigned before = ticks_count;
+
+    LDL_MAC_process(self);
+
+    process_count++;
+
+    assert_int_equal(1U, ticks_count - before);
+}
+
+/* deliver a pending radio interrupt or advance time to the next event */
+static void step(struct ldl_mac *self)
+{
+    uint32_t next;
+
+    if(radio.pending){
+
+        radio.pending = false;
+        now += 1U;
+        LDL_MAC_radioEventWithTicks(self, now);
+    }
+#ifdef LDL_ENABLE_ASYNC_SM
+    else if(slow_sm.pending){
+
+        /* nothing to do but wait for the SM */
+        assert_int_equal(LDL_STATE_WAIT_SM, LDL_MAC_state(self));
+        process(self);
+        assert_int_equal(LDL_STATE_WAIT_SM, LDL_MAC_state(self));
+
+        slow_sm.pending = false;
+        now += SM_LATENCY;
+        LDL_MAC_smEvent(self, slow_sm.mic);
+    }
+#endif
+    else{
+
+        next = LDL_MAC_ticksUntilNextEvent(self);
+
+        if(next != UINT32_MAX){
+
+            now += next;
+        }
+    }
+
+    process(self);
+}
+
+static void run_until_idle(struct ldl_mac *self)
+{
+    unsigned i;
+
+    for(i=0U; (i < MAX_STEPS) && (LDL_MAC_op(self) != LDL_OP_NONE); i++){
+
+        step(self);
+    }
+
+    assert_int_equal(LDL_OP_NONE, LDL_MAC_op(self));
+}
+
+static void run_until_ready(struct ldl_mac *self)
+{
+    unsigned i;
+
+    for(i=0U; (i < MAX_STEPS) && !LDL_MAC_ready(self); i++){
+
+        step(self);
+    }
+
+    assert_true(LDL_MAC_ready(self));
+}
+
+static void run_until_state(struct ldl_mac *self, enum ldl_mac_state state)
+{
+    unsigned i;
+
+    for(i=0U; (i < MAX_STEPS) && (LDL_MAC_state(self) != state); i++){
+
+        step(self);
+    }
+
+    assert_int_equal(state, LDL_MAC_state(self));
+}
+
+/* queue an encrypted and MIC'd data frame for the next receive window */
+static void queue_downlink(uint32_t devAddr, uint32_t counter, uint8_t port, const void *data, uint8_t len)
+{
+    struct ldl_frame_data f;
+    struct ldl_frame_data_offset off;
+    uint8_t A[16U] = {1U, 0U, 0U, 0U, 0U, 1U};
+    uint8_t B[16U] = {0x49U, 0U, 0U, 0U, 0U, 1U};
+    uint8_t i;
+
+    for(i=0U; i < 4U; i++){
+
+        A[6U+i] = B[6U+i] = (uint8_t)(devAddr >> (i*8U));
+        A[10U+i] = B[10U+i] = (uint8_t)(counter >> (i*8U));
+    }
+
+    A[15U] = 1U;
+
+    (void)memset(&f, 0, sizeof(f));
+
+    f.type = FRAME_TYPE_DATA_UNCONFIRMED_DOWN;
+    f.devAddr = devAddr;
+    f.counter = (uint16_t)counter;
+    f.port = port;
+    f.data = data;
+    f.dataLen = len;
+
+    radio.rx_len = LDL_Frame_putData(&f, radio.rx_buffer, sizeof(radio.rx_buffer), &off);
+
+    LDL_SM_ctr(&sm, LDL_SM_KEY_APPS, A, &radio.rx_buffer[off.data], len);
+
+    B[15U] = radio.rx_len - 4U;
+
+    LDL_Frame_updateMIC(radio.rx_buffer, radio.rx_len, LDL_SM_mic(&sm, LDL_SM_KEY_SNWKSINT, B, sizeof(B), radio.rx_buffer, radio.rx_len - 4U));
+}
+
+static void init_mac(struct ldl_mac *mac, enum ldl_region region, const struct ldl_mac_session *session)
+{
+    struct ldl_mac_init_arg arg;
+#ifdef LDL_ENABLE_CONST_CONFIG
+    /* not const here only because sm_interface changes between setups */
+    static struct ldl_mac_config config;
+#endif
+
+    now = 0U;
+    rand_value = 42U;
+    ticks_count = 0U;
+    process_count = 0U;
+    (void)memset(&radio, 0, sizeof(radio));
+    (void)memset(&slow_sm, 0, sizeof(slow_sm));
+    (void)memset(&sm_count, 0, sizeof(sm_count));
+    (void)memset(&app, 0, sizeof(app));
+
+#if defined(LDL_ENABLE_L2_1_1)
+    LDL_SM_init(&sm, key, key);
+#else
+    LDL_SM_init(&sm, key);
+#endif
+
+    (void)memset(&arg, 0, sizeof(arg));
+
+#ifdef LDL_ENABLE_CONST_CONFIG
+    (void)memset(&config, 0, sizeof(config));
+
+    config.app = &app;
+    config.radio_interface = &radio_interface;
+    config.sm = &sm;
+    config.sm_interface = sm_interface;
+    config.handler = handler;
+    (void)memcpy(config.joinEUI, eui, sizeof(config.joinEUI));
+    (void)memcpy(config.devEUI, eui, sizeof(config.devEUI));
+    config.rand = system_rand;
+    config.ticks = system_ticks;
+    config.get_battery_level = system_get_battery_level;
+    config.tps = TPS;
+    config.a = 10U;
+    config.b = 0U;
+    config.advance = 0U;
+
+    arg.config = &config;
+#else
+    arg.app = &app;
+    arg.radio_interface = &radio_interface;
+    arg.sm = &sm;
+    arg.sm_interface = sm_interface;
+    arg.handler = handler;
+    arg.joinEUI = eui;
+    arg.devEUI = eui;
+    arg.rand = system_rand;
+    arg.ticks = system_ticks;
+    arg.tps = TPS;
+    arg.a = 10U;
+    arg.b = 0U;
+    arg.advance = 0U;
+#endif
+    arg.session = session;
+
+    LDL_MAC_init(mac, region, &arg);
+}
+
+static int setup_abp(void **user)
+{
+    static struct ldl_mac mac;
+
+    init_mac(&mac, LDL_EU_863_870, NULL);
+
+    assert_int_equal(LDL_STATUS_OK, LDL_MAC_abp(&mac, 0x01020304U));
+
+#if defined(LDL_ENABLE_L2_1_1)
+    mac.ctx.version = 1U;
+#endif
+
+    run_until_ready(&mac);
+
+    *user = &mac;
+
+    return 0;
+}
+
+static int setup_abp_fused(void **user)
+{
+    sm_interface = &sm_interface_fused;
+
+    return setup_abp(user);
+}
+
+#ifdef LDL_ENABLE_ASYNC_SM
+static int setup_abp_async(void **user)
+{
+    sm_interface = &sm_interface_async;
+
+    return setup_abp(user);
+}
+#endif
+
+static int setup_abp_split(void **user)
+{
+    sm_interface = &sm_interface_split;
+
+    return setup_abp(user);
+}
+
+static int setup_us(void **user)
+{
+    static struct ldl_mac mac;
+
+    sm_interface = &sm_interface_fused;
+
+    init_mac(&mac, LDL_US_902_928, NULL);
+
+    *user = &mac;
+
+    return 0;
+}
+
+static int setup_eu(void **user)
+{
+    static struct ldl_mac mac;
+
+    sm_interface = &sm_interface_fused;
+
+    init_mac(&mac, LDL_EU_863_870, NULL);
+
+    *user = &mac;
+
+    return 0;
+}
+
+/* channel selection the way it was done before channels were tracked per band */
+static bool reference_get_channel(const struct ldl_mac *self, uint8_t chIndex, uint32_t *freq, uint8_t *minRate, uint8_t *maxRate)
+{
+    bool retval = false;
+
+    if(LDL_Region_isDynamic(self->ctx.region)){
+
+        if(chIndex < (sizeof(self->ctx.chConfig)/sizeof(*self->ctx.chConfig))){
+
+            *freq = (self->ctx.chConfig[chIndex].freqAndRate >> 8) * 100U;
+            *minRate = (uint8_t)((self->ctx.chConfig[chIndex].freqAndRate >> 4) & 0xfU);
+            *maxRate = (uint8_t)(self->ctx.chConfig[chIndex].freqAndRate & 0xfU);
+            retval = true;
+        }
+    }
+    else{
+
+        retval = LDL_Region_getChannel(self->ctx.region, chIndex, freq, minRate, maxRate);
+    }
+
+    return retval;
+}
+
+static bool reference_is_available(const struct ldl_mac *self, uint8_t chIndex, uint32_t limit)
+{
+    uint32_t freq;
+    uint8_t minRate, maxRate, band;
+
+    return ((self->ctx.chMask[chIndex / 8U] & (1U << (chIndex % 8U))) == 0U)
+        && reference_get_channel(self, chIndex, &freq, &minRate, &maxRate)
+        && (freq > 0U)
+        && LDL_Region_getBand(self->ctx.region, freq, &band)
+        && (self->band[band] <= limit);
+}
+
+static bool reference_select_channel(const struct ldl_mac *self, uint8_t desired_rate, uint32_t limit, struct ldl_mac_tx *tx)
+{
+    uint8_t i, minRate, maxRate, selection, j = 0U;
+    uint8_t except = UINT8_MAX;
+    uint32_t available = 0U;
+    bool mask[72U];
+
+    for(i=0U; i < LDL_Region_numChannels(self->ctx.region); i++){
+
+        mask[i] = reference_is_available(self, i, limit);
+
+        if(mask[i]){
+
+            except = (i == self->tx.chIndex) ? i : except;
+            available++;
+        }
+    }
+
+    if(available == 0U){
+
+        return false;
+    }
+
+    if(except != UINT8_MAX){
+
+        if(available == 1U){
+
+            except = UINT8_MAX;
+        }
+        else{
+
+            available--;
+        }
+    }
+
+    selection = (uint8_t)(LDL_MAC_CONFIG(self)->rand(LDL_MAC_CONFIG(self)->app) % available);
+
+    for(i=0U; i < LDL_Region_numChannels(self->ctx.region); i++){
+
+        if(mask[i] && (i != except)){
+
+            if(selection == j){
+
+                (void)reference_get_channel(self, i, &tx->freq, &minRate, &maxRate);
+
+                tx->chIndex = i;
+                tx->rate = (desired_rate < minRate) ? minRate : ((desired_rate > maxRate) ? maxRate : desired_rate);
+                return true;
+            }
+
+            j++;
+        }
+    }
+
+    return false;
+}
+
+/* ticks until the next timer the way it was found before it was cached */
+static uint32_t reference_ticks_until_next(const struct ldl_mac *self)
+{
+    uint32_t retval = UINT32_MAX;
+    size_t i;
+
+    for(i=0U; i < (sizeof(self->timers)/sizeof(*self->timers)); i++){
+
+        if(self->timers[i].armed){
+
+            if((uint32_t)(now - self->timers[i].time) <= (uint32_t)INT32_MAX){
+
+                retval = 0U;
+            }
+            else if((uint32_t)(self->timers[i].time - now) < retval){
+
+                retval = self->timers[i].time - now;
+            }
+        }
+    }
+
+    return retval;
+}
+
+static void enable_channels(struct ldl_mac *mac, uint8_t n)
+{
+    uint8_t i;
+
+    for(i=0U; i < LDL_Region_numChannels(mac->ctx.region); i++){
+
+        if(i < n){
+
+            (void)LDL_MAC_unmaskChannel(mac, i);
+        }
+        else{
+
+            (void)LDL_MAC_maskChannel(mac, i);
+        }
+    }
+}
+
+static void assert_selection_matches_reference(struct ldl_mac *mac, uint32_t limit)
+{
+    struct ldl_mac_tx expected, actual;
+    const uint8_t previous[] = {UINT8_MAX, 0U, 1U, 7U, 8U, 15U, 64U, 71U};
+    bool found;
+    size_t i;
+    uint32_t r;
+
+    for(i=0U; i < sizeof(previous); i++){
+
+        mac->tx.chIndex = previous[i];
+
+        for(r=0U; r < 80U; r++){
+
+            rand_value = r;
+
+            (void)memset(&expected, 0, sizeof(expected));
+            (void)memset(&actual, 0, sizeof(actual));
+
+            found = reference_select_channel(mac, 3U, limit, &expected);
+
+            assert_int_equal(found, LDL_MAC_selectChannel(mac, 3U, limit, &actual));
+
+            if(found){
+
+                assert_int_equal(expected.chIndex, actual.chIndex);
+                assert_int_equal(expected.freq, actual.freq);
+                assert_int_equal(expected.rate, actual.rate);
+            }
+        }
+    }
+}
+
+/* tests ******************************************************************/
+
+static void unconfirmed_nbtrans_mic_count(void **user)
+{
+    struct ldl_mac *mac = (struct ldl_mac *)(*user);
+    const uint8_t payload[] = "hello world";
+    struct ldl_mac_data_opts opts = {.nbTrans = 3U};
+    uint8_t expected[sizeof(radio.tx_buffer)];
+
+    assert_int_equal(LDL_STATUS_OK, LDL_MAC_unconfirmedData(mac, 1U, payload, sizeof(payload), &opts));
+
+    run_until_idle(mac);
+
+    assert_int_equal(3U, radio.tx_count);
+    assert_int_equal(1U, app.complete);
+
+    /* the MIC is only computed in full for the first transmission,
+     * 1.1 retransmissions recompute the channel dependent half */
+    assert_int_equal(UPLINK_MIC_CALLS + RETRY_MIC_CALLS + RETRY_MIC_CALLS, sm_count.mic);
+
+    /* last transmission must carry the same MIC as a full recalculation */
+    (void)memcpy(expected, radio.tx_buffer, radio.tx_len);
+    LDL_OPS_micDataFrame(mac, expected, radio.tx_len);
+
+    assert_memory_equal(expected, radio.tx_buffer, radio.tx_len);
+}
+
+static void downlink_is_verified_and_decrypted(void **user)
+{
+    struct ldl_mac *mac = (struct ldl_mac *)(*user);
+    const uint8_t payload[] = "hello world";
+    const uint8_t answer[] = "hello device";
+
+    assert_int_equal(LDL_STATUS_OK, LDL_MAC_unconfirmedData(mac, 1U, payload, sizeof(payload), NULL));
+
+    queue_downlink(mac->ctx.devAddr, 0U, 2U, answer, sizeof(answer));
+
+    run_until_idle(mac);
+
+    assert_int_equal(1U, radio.tx_count);
+    assert_int_equal(1U, app.complete);
+    assert_int_equal(1U, app.rx_count);
+    assert_int_equal(2U, app.rx_port);
+    assert_int_equal(sizeof(answer), app.rx_len);
+    assert_memory_equal(answer, app.rx_data, sizeof(answer));
+
+    if(sm_interface->mic_decrypt != NULL){
+
+        /* one call replaces the downlink mic and ctr */
+        assert_int_equal(1U, sm_count.mic_decrypt);
+        assert_int_equal(UPLINK_MIC_CALLS, sm_count.mic);
+    }
+    else{
+
+        assert_int_equal(0U, sm_count.mic_decrypt);
+        assert_int_equal(UPLINK_MIC_CALLS + 1U, sm_count.mic);
+    }
+}
+
+static void downlink_with_bad_mic_is_dropped(void **user)
+{
+    struct ldl_mac *mac = (struct ldl_mac *)(*user);
+    const uint8_t payload[] = "hello world";
+    const uint8_t answer[] = "hello device";
+
+    assert_int_equal(LDL_STATUS_OK, LDL_MAC_unconfirmedData(mac, 1U, payload, sizeof(payload), NULL));
+
+    queue_downlink(mac->ctx.devAddr, 0U, 2U, answer, sizeof(answer));
+    radio.rx_buffer[radio.rx_len - 1U] ^= 0xffU;
+
+    run_until_idle(mac);
+
+    assert_int_equal(1U, app.complete);
+    assert_int_equal(0U, app.rx_count);
+}
+
+static void retransmission_survives_foreign_downlink(void **user)
+{
+    struct ldl_mac *mac = (struct ldl_mac *)(*user);
+    const uint8_t payload[] = "hello world";
+    const uint8_t answer[] = "hello other device";
+    struct ldl_mac_data_opts opts = {.nbTrans = 2U};
+    uint8_t first[sizeof(radio.tx_buffer)];
+    uint8_t first_len;
+    uint8_t expected[sizeof(radio.tx_buffer)];
+
+    assert_int_equal(LDL_STATUS_OK, LDL_MAC_unconfirmedData(mac, 1U, payload, sizeof(payload), &opts));
+
+    run_until_state(mac, LDL_STATE_WAIT_RX1);
+
+    (void)memcpy(first, radio.tx_buffer, radio.tx_len);
+    first_len = radio.tx_len;
+
+    /* as large as a downlink can be so it overwrites any shared buffer */
+    queue_downlink(mac->ctx.devAddr ^ 1U, 0U, 2U, answer, sizeof(answer));
+    radio.rx_len = sizeof(radio.rx_buffer);
+
+    run_until_idle(mac);
+
+    assert_int_equal(2U, radio.tx_count);
+    assert_int_equal(1U, app.complete);
+    assert_int_equal(0U, app.rx_count);
+
+    /* same frame with a MIC that suits the new channel */
+    assert_int_equal(first_len, radio.tx_len);
+    assert_memory_equal(first, radio.tx_buffer, radio.tx_len - 4U);
+
+    (void)memcpy(expected, radio.tx_buffer, radio.tx_len);
+    LDL_OPS_micDataFrame(mac, expected, radio.tx_len);
+
+    assert_memory_equal(expected, radio.tx_buffer, radio.tx_len);
+}
+
+#ifdef LDL_ENABLE_ASYNC_SM
+static void async_uplink_waits_for_sm(void **user)
+{
+    struct ldl_mac *mac = (struct ldl_mac *)(*user);
+    const uint8_t payload[] = "hello world";
+    struct ldl_mac_data_opts opts = {.nbTrans = 3U};
+    uint8_t expected[sizeof(radio.tx_buffer)];
+
+    assert_int_equal(LDL_STATUS_OK, LDL_MAC_unconfirmedData(mac, 1U, payload, sizeof(payload), &opts));
+
+    /* returns straight away */
+    assert_int_equal(LDL_STATE_WAIT_SM, LDL_MAC_state(mac));
+    assert_true(slow_sm.pending);
+
+    run_until_idle(mac);
+
+    assert_int_equal(3U, radio.tx_count);
+    assert_int_equal(1U, app.complete);
+
+    assert_int_equal(0U, sm_count.mic);
+    assert_int_equal(UPLINK_MIC_CALLS + RETRY_MIC_CALLS + RETRY_MIC_CALLS, sm_count.begin_mic);
+
+    (void)memcpy(expected, radio.tx_buffer, radio.tx_len);
+    LDL_OPS_micDataFrame(mac, expected, radio.tx_len);
+
+    assert_memory_equal(expected, radio.tx_buffer, radio.tx_len);
+}
+
+static void async_downlink_waits_for_sm(void **user)
+{
+    struct ldl_mac *mac = (struct ldl_mac *)(*user);
+    const uint8_t payload[] = "hello world";
+    const uint8_t answer[] = "hello device";
+
+    assert_int_equal(LDL_STATUS_OK, LDL_MAC_unconfirmedData(mac, 1U, payload, sizeof(payload), NULL));
+
+    queue_downlink(mac->ctx.devAddr, 0U, 2U, answer, sizeof(answer));
+
+    run_until_idle(mac);
+
+    assert_int_equal(1U, app.complete);
+    assert_int_equal(1U, app.rx_count);
+    assert_memory_equal(answer, app.rx_data, sizeof(answer));
+
+    assert_int_equal(0U, sm_count.mic);
+    assert_int_equal(0U, sm_count.mic_decrypt);
+    assert_int_equal(UPLINK_MIC_CALLS + 1U, sm_count.begin_mic);
+}
+#endif
+
+static void session_restore_derives_keys_per_root(void **user)
+{
+    struct ldl_mac *mac = (struct ldl_mac *)(*user);
+    struct ldl_mac_session session;
+    struct ldl_sm expected;
+
+    (void)memcpy(&session, &mac->ctx, sizeof(session));
+
+    session.joinNonce = 0x123456U;
+    session.devNonce = 0x4242U;
+    session.netID = 0x000013U;
+
+    /* without update_session_keys each key is derived separately */
+    sm_interface = &sm_interface_split;
+    init_mac(mac, LDL_EU_863_870, &session);
+
+    assert_int_equal(4U, sm_count.update_session_key);
+    assert_int_equal(0U, sm_count.update_session_keys);
+
+    (void)memcpy(&expected, &sm, sizeof(expected));
+
+    /* otherwise one call per root key */
+    sm_interface = &sm_interface_fused;
+    init_mac(mac, LDL_EU_863_870, &session);
+
+    assert_int_equal(0U, sm_count.update_session_key);
+    assert_int_equal(SESSION_KEY_ROOTS, sm_count.update_session_keys);
+
+    assert_memory_equal(expected.keys, sm.keys, sizeof(sm.keys));
+}
+
+static void session_update_reports_changed_fields(void **user)
+{
+    struct ldl_mac *mac = (struct ldl_mac *)(*user);
+    const uint8_t payload[] = "hello world";
+    size_t offset;
+    size_t size;
+    size_t total;
+    unsigned i;
+
+    /* fields are contiguous and cover the session */
+    total = 0U;
+
+    for(i=0U; i < LDL_SESSION_FIELD_MAX; i++){
+
+        assert_true(LDL_MAC_getSessionField((enum ldl_mac_session_field)i, &offset, &size));
+        assert_int_equal(total, offset);
+
+        total += size;
+    }
+
+    assert_int_equal(sizeof(struct ldl_mac_session), total);
+    assert_false(LDL_MAC_getSessionField(LDL_SESSION_FIELD_MAX, &offset, &size));
+
+    app.session_updates = 0U;
+
+    /* everything is new since a session was not restored */
+    assert_int_equal(LDL_STATUS_OK, LDL_MAC_setRate(mac, 2U));
+
+    assert_int_equal(1U, app.session_updates);
+    assert_int_equal(LDL_SESSION_ALL, app.session_changed);
+
+    assert_int_equal(LDL_STATUS_OK, LDL_MAC_setRate(mac, 3U));
+
+    assert_int_equal(2U, app.session_updates);
+    assert_int_equal(1U << LDL_SESSION_TX, app.session_changed);
+
+    LDL_MAC_setADR(mac, false);
+
+    assert_int_equal(3U, app.session_updates);
+    assert_int_equal(1U << LDL_SESSION_STATE, app.session_changed);
+
+    assert_int_equal(LDL_STATUS_OK, LDL_MAC_unconfirmedData(mac, 1U, payload, sizeof(payload), NULL));
+
+    run_until_idle(mac);
+
+#ifdef LDL_ENABLE_COUNTER_GAP
+    /* first uplink reserves a block */
+    assert_int_equal((1U << LDL_SESSION_UP) | (1U << LDL_SESSION_UP_RESERVED), app.session_changed);
+#else
+    assert_int_equal(1U << LDL_SESSION_UP, app.session_changed);
+#endif
+}
+
+static void mask_flags_only_real_changes(void **user)
+{
+    struct ldl_mac *mac = (struct ldl_mac *)(*user);
+
+    mac->changed = 0U;
+
+    assert_true(LDL_MAC_maskChannel(mac, 0U));
+    assert_int_equal(1U << LDL_SESSION_CH_MASK, mac->changed);
+
+    mac->changed = 0U;
+
+    /* already masked and out of range */
+    assert_true(LDL_MAC_maskChannel(mac, 0U));
+    assert_false(LDL_MAC_maskChannel(mac, UINT8_MAX));
+    assert_false(LDL_MAC_unmaskChannel(mac, UINT8_MAX));
+    assert_int_equal(0U, mac->changed);
+
+    assert_true(LDL_MAC_unmaskChannel(mac, 0U));
+    assert_int_equal(1U << LDL_SESSION_CH_MASK, mac->changed);
+
+    mac->changed = 0U;
+
+    /* already unmasked */
+    assert_true(LDL_MAC_unmaskChannel(mac, 0U));
+    assert_int_equal(0U, mac->changed);
+}
+
+static void send_uplinks(struct ldl_mac *mac, unsigned n)
+{
+    const uint8_t payload[] = "hello world";
+    unsigned i;
+
+    for(i=0U; i < n; i++){
+
+        run_until_ready(mac);
+
+        assert_int_equal(LDL_STATUS_OK, LDL_MAC_unconfirmedData(mac, 1U, payload, sizeof(payload), NULL));
+
+        run_until_idle(mac);
+    }
+}
+
+#ifndef LDL_ENABLE_COUNTER_GAP
+static void reserved_session_is_skipped_without_counter_gap(void **user)
+{
+    struct ldl_mac *mac = (struct ldl_mac *)(*user);
+    struct ldl_mac_session saved;
+
+    send_uplinks(mac, 2U);
+
+    /* as saved by a build with LDL_ENABLE_COUNTER_GAP */
+    (void)memcpy(&saved, &app.saved, sizeof(saved));
+    saved.upReserved = true;
+
+    init_mac(mac, LDL_EU_863_870, &saved);
+
+    assert_int_equal(saved.up + LDL_COUNTER_GAP, mac->ctx.up);
+    assert_false(mac->ctx.upReserved);
+
+    /* the skip and the cleared reservation are saved with the next uplink */
+    send_uplinks(mac, 1U);
+
+    assert_int_equal(mac->ctx.up, app.saved.up);
+    assert_false(app.saved.upReserved);
+}
+#endif
+
+#ifdef LDL_ENABLE_COUNTER_GAP
+static void counter_is_saved_once_per_gap(void **user)
+{
+    struct ldl_mac *mac = (struct ldl_mac *)(*user);
+    struct ldl_mac_session saved;
+    uint32_t up;
+
+    send_uplinks(mac, (3U * LDL_COUNTER_GAP) + 2U);
+
+    /* first uplink and then every LDL_COUNTER_GAP */
+    assert_int_equal(4U, app.up_saves);
+    assert_true(app.saved.up < mac->ctx.up);
+
+    /* unclean shutdown */
+    up = mac->ctx.up;
+    (void)memcpy(&saved, &app.saved, sizeof(saved));
+
+    init_mac(mac, LDL_EU_863_870, &saved);
+
+    assert_true(mac->ctx.up >= up);
+    assert_int_equal(saved.up + LDL_COUNTER_GAP, mac->ctx.up);
+
+    /* restored counter is saved before it is used */
+    send_uplinks(mac, 1U);
+
+    assert_int_equal(1U, app.up_saves);
+    assert_int_equal(mac->ctx.up, app.saved.up);
+}
+
+static void save_counters_avoids_skip(void **user)
+{
+    struct ldl_mac *mac = (struct ldl_mac *)(*user);
+    struct ldl_mac_session saved;
+    uint32_t up;
+
+    send_uplinks(mac, LDL_COUNTER_GAP + 1U);
+
+    /* clean shutdown */
+    LDL_MAC_saveCounters(mac);
+
+    up = mac->ctx.up;
+    (void)memcpy(&saved, &app.saved, sizeof(saved));
+
+    init_mac(mac, LDL_EU_863_870, &saved);
+
+    assert_int_equal(up, mac->ctx.up);
+
+    /* next uplink reserves again */
+    send_uplinks(mac, 1U);
+
+    assert_int_equal(1U, app.up_saves);
+    assert_true(app.saved.upReserved);
+}
+#endif
+
+static void imported_bands_survive_reset(void **user)
+{
+    struct ldl_mac *mac = (struct ldl_mac *)(*user);
+    const uint8_t payload[] = "hello world";
+    struct ldl_mac_band_state state;
+    struct ldl_mac_session session;
+    unsigned i;
+
+    assert_int_equal(LDL_STATUS_OK, LDL_MAC_unconfirmedData(mac, 1U, payload, sizeof(payload), NULL));
+
+    run_until_idle(mac);
+
+    /* default channels share a band which is now off */
+    assert_false(LDL_MAC_ready(mac));
+
+    LDL_MAC_exportBands(mac, &state);
+
+    /* reset forgets airtime */
+    (void)memcpy(&session, &mac->ctx, sizeof(session));
+
+    init_mac(mac, LDL_EU_863_870, &session);
+
+    run_until_ready(mac);
+
+    /* with no time elapsed nothing has changed */
+    LDL_MAC_importBands(mac, &state, 0U);
+
+    assert_memory_equal(state.band, mac->band, sizeof(state.band));
+    assert_false(LDL_MAC_ready(mac));
+
+    /* elapsed time counts down */
+    LDL_MAC_importBands(mac, &state, 1U);
+
+    for(i=0U; i < LDL_BAND_MAX; i++){
+
+        assert_int_equal((state.band[i] > 256U) ? (state.band[i] - 256U) : 0U, mac->band[i]);
+    }
+
+    /* off-time is over */
+    LDL_MAC_importBands(mac, &state, UINT32_MAX);
+
+    assert_true(LDL_MAC_ready(mac));
+}
+
+static void imported_day_is_kept_by_otaa(void **user)
+{
+    struct ldl_mac *mac = (struct ldl_mac *)(*user);
+    struct ldl_mac_band_state state;
+
+    (void)memset(&state, 0, sizeof(state));
+
+    /* joining started 20 hours ago */
+    state.day = 4U * 60U * 60U * 256U;
+
+    LDL_MAC_importBands(mac, &state, 60U);
+
+    assert_int_equal(LDL_STATUS_OK, LDL_MAC_otaa(mac));
+
+    assert_int_equal(state.day - (60U * 256U), mac->day);
+}
+
+static void next_event_is_cached(void **user)
+{
+    struct ldl_mac *mac = (struct ldl_mac *)(*user);
+    const uint8_t payload[] = "hello world";
+    uint32_t band_time;
+    unsigned before;
+    unsigned i;
+
+    assert_int_equal(LDL_STATUS_OK, LDL_MAC_unconfirmedData(mac, 1U, payload, sizeof(payload), NULL));
+
+    for(i=0U; (i < MAX_STEPS) && (LDL_MAC_op(mac) != LDL_OP_NONE); i++){
+
+        if(!radio.pending){
+
+            before = ticks_count;
+
+            assert_int_equal(reference_ticks_until_next(mac), LDL_MAC_ticksUntilNextEvent(mac));
+            assert_true((ticks_count - before) <= 1U);
+        }
+
+        step(mac);
+    }
+
+    assert_int_equal(LDL_OP_NONE, LDL_MAC_op(mac));
+
+    /* off-time from the uplink is counting down */
+    assert_true(mac->timers[LDL_TIMER_BAND].armed);
+
+    band_time = mac->timers[LDL_TIMER_BAND].time;
+
+    now += 1U;
+    process(mac);
+
+    /* and the band event doesn't move while it does */
+    assert_true(mac->timers[LDL_TIMER_BAND].armed);
+    assert_int_equal(band_time, mac->timers[LDL_TIMER_BAND].time);
+    assert_int_equal(reference_ticks_until_next(mac), LDL_MAC_ticksUntilNextEvent(mac));
+
+    /* until it is due */
+    run_until_ready(mac);
+
+    assert_int_equal(reference_ticks_until_next(mac), LDL_MAC_ticksUntilNextEvent(mac));
+}
+
+static void process_reads_ticks_once(void **user)
+{
+    struct ldl_mac *mac = (struct ldl_mac *)(*user);
+    const uint8_t payload[] = "hello world";
+    const uint8_t answer[] = "hello device";
+
+    /* confirmed with no answer goes through every retry and the rx2 lockout */
+    assert_int_equal(LDL_STATUS_OK, LDL_MAC_confirmedData(mac, 1U, payload, sizeof(payload), NULL));
+
+    run_until_idle(mac);
+
+    assert_int_equal(1U, app.timeout);
+
+    run_until_ready(mac);
+
+    /* then a downlink is received and processed */
+    assert_int_equal(LDL_STATUS_OK, LDL_MAC_unconfirmedData(mac, 1U, payload, sizeof(payload), NULL));
+
+    queue_downlink(mac->ctx.devAddr, 0U, 2U, answer, sizeof(answer));
+
+    run_until_idle(mac);
+
+    assert_int_equal(1U, app.rx_count);
+
+    /* process() has checked each invocation made exactly one ticks() call */
+    assert_true(process_count > 0U);
+}
+
+static void priority_follows_rx_windows(void **user)
+{
+    struct ldl_mac *mac = (struct ldl_mac *)(*user);
+    const uint8_t payload[] = "hello world";
+
+    /* a long RX1 delay leaves room for other tasks */
+    mac->ctx.rx1Delay = 5U;
+
+    assert_false(LDL_MAC_priority(mac, UINT8_MAX));
+
+    assert_int_equal(LDL_STATUS_OK, LDL_MAC_unconfirmedData(mac, 1U, payload, sizeof(payload), NULL));
+
+    /* uplink is due now */
+    assert_int_equal(LDL_STATE_WAIT_TX, LDL_MAC_state(mac));
+    assert_true(LDL_MAC_priority(mac, 0U));
+
+    run_until_state(mac, LDL_STATE_START_RADIO_FOR_TX);
+    assert_true(LDL_MAC_priority(mac, 0U));
+
+    run_until_state(mac, LDL_STATE_TX);
+    assert_true(LDL_MAC_priority(mac, 0U));
+
+    /* RX1 opens a little before five seconds from now */
+    run_until_state(mac, LDL_STATE_WAIT_RX1);
+    assert_false(LDL_MAC_priority(mac, 0U));
+    assert_false(LDL_MAC_priority(mac, 4U));
+    assert_true(LDL_MAC_priority(mac, 5U));
+
+    run_until_state(mac, LDL_STATE_RX1);
+    assert_true(LDL_MAC_priority(mac, 0U));
+
+    /* RX2 opens a little before one second after RX1 */
+    run_until_state(mac, LDL_STATE_WAIT_RX2);
+    assert_false(LDL_MAC_priority(mac, 0U));
+    assert_true(LDL_MAC_priority(mac, 1U));
+
+    run_until_idle(mac);
+    assert_false(LDL_MAC_priority(mac, UINT8_MAX));
+}
+
+static void priority_follows_scheduled_uplink(void **user)
+{
+    struct ldl_mac *mac = (struct ldl_mac *)(*user);
+    const uint8_t payload[] = "hello world";
+    const struct ldl_mac_data_opts opts = {.nbTrans = 2U};
+
+    assert_int_equal(LDL_STATUS_OK, LDL_MAC_confirmedData(mac, 1U, payload, sizeof(payload), &opts));
+
+    /* no answer so the retry waits out a back-off */
+    run_until_state(mac, LDL_STATE_RX2);
+    run_until_state(mac, LDL_STATE_WAIT_TX);
+
+    assert_false(LDL_MAC_priority(mac, 0U));
+    assert_true(LDL_MAC_priority(mac, UINT8_MAX));
+}
+
+static void radio_event_burst_keeps_first_edge(void **user)
+{
+    struct ldl_mac *mac = (struct ldl_mac *)(*user);
+    const uint8_t payload[] = "hello world";
+    uint32_t edge;
+
+    assert_int_equal(LDL_STATUS_OK, LDL_MAC_unconfirmedData(mac, 1U, payload, sizeof(payload), NULL));
+
+    run_until_state(mac, LDL_STATE_TX);
+
+    /* more edges than the ring holds before the mainloop gets around to it */
+    radio.pending = false;
+    edge = now + 1U;
+
+    LDL_MAC_radioEventWithTicks(mac, edge);
+    LDL_MAC_radioEventWithTicks(mac, edge + 10U);
+    LDL_MAC_radioEventWithTicks(mac, edge + 20U);
+    LDL_MAC_radioEventWithTicks(mac, edge + 30U);
+    LDL_MAC_radioEventWithTicks(mac, edge + 40U);
+
+    assert_int_equal(0U, LDL_MAC_ticksUntilNextEvent(mac));
+
+    now = edge + 100U;
+    process(mac);
+
+    assert_int_equal(LDL_STATE_WAIT_RX1, LDL_MAC_state(mac));
+#ifndef LDL_DISABLE_DEVICE_TIME
+    assert_int_equal(edge, mac->ticks_at_tx);
+#endif
+
+    /* the rest of the burst was drained */
+    assert_int_not_equal(0U, LDL_MAC_ticksUntilNextEvent(mac));
+
+    /* edges outside of a radio operation are ignored */
+    LDL_MAC_radioEventWithTicks(mac, now);
+
+    assert_int_not_equal(0U, LDL_MAC_ticksUntilNextEvent(mac));
+
+    run_until_idle(mac);
+
+    assert_int_equal(1U, radio.tx_count);
+    assert_int_equal(1U, app.complete);
+}
+
+static void select_channel_matches_reference_us(void **user)
+{
+    struct ldl_mac *mac = (struct ldl_mac *)(*user);
+    const uint8_t enabled[] = {0U, 1U, 2U, 8U, 16U, 65U, 72U};
+    size_t i;
+
+    for(i=0U; i < sizeof(enabled); i++){
+
+        enable_channels(mac, enabled[i]);
+        assert_selection_matches_reference(mac, 0U);
+    }
+
+    /* an irregular mask */
+    enable_channels(mac, 72U);
+
+    for(i=0U; i < 72U; i += 3U){
+
+        (void)LDL_MAC_maskChannel(mac, (uint8_t)i);
+    }
+
+    assert_selection_matches_reference(mac, 0U);
+
+    /* band not ready */
+    mac->band[LDL_BAND_1] = 100U;
+
+    assert_selection_matches_reference(mac, 0U);
+    assert_selection_matches_reference(mac, 100U);
+}
+
+static void select_channel_matches_reference_eu(void **user)
+{
+    struct ldl_mac *mac = (struct ldl_mac *)(*user);
+
+    /* default channels are all in band 2, add some to the others */
+    assert_true(LDL_MAC_addChannel(mac, 3U, 867100000U, 0U, 5U));
+    assert_true(LDL_MAC_addChannel(mac, 4U, 867300000U, 0U, 5U));
+    assert_true(LDL_MAC_addChannel(mac, 5U, 868800000U, 0U, 5U));
+    assert_true(LDL_MAC_addChannel(mac, 6U, 869525000U, 0U, 5U));
+    assert_true(LDL_MAC_addChannel(mac, 7U, 869800000U, 2U, 5U));
+
+    assert_selection_matches_reference(mac, 0U);
+
+    mac->band[LDL_BAND_1] = 10U;
+    mac->band[LDL_BAND_2] = 20U;
+    mac->band[LDL_BAND_4] = 30U;
+
+    assert_selection_matches_reference(mac, 0U);
+    assert_selection_matches_reference(mac, 10U);
+    assert_selection_matches_reference(mac, 20U);
+    assert_selection_matches_reference(mac, 30U);
+
+    /* moving a channel to another band */
+    assert_true(LDL_MAC_addChannel(mac, 3U, 868900000U, 0U, 5U));
+    assert_selection_matches_reference(mac, 10U);
+
+    /* removing a channel */
+    assert_true(LDL_MAC_addChannel(mac, 4U, 0U, 0U, 0U));
+    assert_selection_matches_reference(mac, 30U);
+
+    (void)LDL_MAC_maskChannel(mac, 0U);
+    (void)LDL_MAC_maskChannel(mac, 6U);
+    assert_selection_matches_reference(mac, 30U);
+}
+
+static void select_channel_cycles_us(void **user)
+{
+    struct ldl_mac *mac = (struct ldl_mac *)(*user);
+    const uint8_t enabled[] = {8U, 16U, 72U};
+    struct ldl_mac_tx tx;
+    uint64_t start, ref, opt;
+    volatile uint32_t sink = 0U;
+    size_t i;
+    unsigned j;
+
+    for(i=0U; i < sizeof(enabled); i++){
+
+        enable_channels(mac, enabled[i]);
+
+        start = cycles_now();
+        for(j=0U; j < BENCH_ITERATIONS; j++){
+            rand_value = j;
+            sink += reference_select_channel(mac, 0U, 0U, &tx) ? tx.chIndex : 0U;
+        }
+        ref = (cycles_now() - start) / BENCH_ITERATIONS;
+
+        start = cycles_now();
+        for(j=0U; j < BENCH_ITERATIONS; j++){
+            rand_value = j;
+            sink += LDL_MAC_selectChannel(mac, 0U, 0U, &tx) ? tx.chIndex : 0U;
+        }
+        opt = (cycles_now() - start) / BENCH_ITERATIONS;
+
+        printf("LDL_MAC_selectChannel US_902_928 %u enabled: %llu cycles/op (per channel scan: %llu)\n", enabled[i], (unsigned long long)opt, (unsigned long long)ref);
+    }
+
+    (void)sink;
+}
+
+int main(void)
+{
+    trace_desc = stderr;
+
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup(unconfirmed_nbtrans_mic_count, setup_abp_fused),
+        cmocka_unit_test_setup(downlink_is_verified_and_decrypted, setup_abp_fused),
+        cmocka_unit_test_setup(downlink_is_verified_and_decrypted, setup_abp_split),
+        cmocka_unit_test_setup(downlink_with_bad_mic_is_dropped, setup_abp_fused),
+        cmocka_unit_test_setup(downlink_with_bad_mic_is_dropped, setup_abp_split),
+        cmocka_unit_test_setup(retransmission_survives_foreign_downlink, setup_abp_fused),
+        cmocka_unit_test_setup(session_restore_derives_keys_per_root, setup_abp_fused),
+        cmocka_unit_test_setup(session_update_reports_changed_fields, setup_abp_fused),
+        cmocka_unit_test_setup(mask_flags_only_real_changes, setup_abp_fused),
+#ifdef LDL_ENABLE_COUNTER_GAP
+        cmocka_unit_test_setup(counter_is_saved_once_per_gap, setup_abp_fused),
+        cmocka_unit_test_setup(save_counters_avoids_skip, setup_abp_fused),
+#else
+        cmocka_unit_test_setup(reserved_session_is_skipped_without_counter_gap, setup_abp_fused),
+#endif
+        cmocka_unit_test_setup(imported_bands_survive_reset, setup_abp_fused),
+        cmocka_unit_test_setup(imported_day_is_kept_by_otaa, setup_eu),
+        cmocka_unit_test_setup(next_event_is_cached, setup_abp_fused),
+        cmocka_unit_test_setup(process_reads_ticks_once, setup_abp_fused),
+        cmocka_unit_test_setup(priority_follows_rx_windows, setup_abp_fused),
+        cmocka_unit_test_setup(priority_follows_scheduled_uplink, setup_abp_fused),
+        cmocka_unit_test_setup(radio_event_burst_keeps_first_edge, setup_abp_fused),
+        cmocka_unit_test_setup(select_channel_matches_reference_us, setup_us),
+        cmocka_unit_test_setup(select_channel_matches_reference_eu, setup_eu),
+        cmocka_unit_test_setup(select_channel_cycles_us, setup_us),
+#ifdef LDL_ENABLE_ASYNC_SM
+        cmocka_unit_test_setup(async_uplink_waits_for_sm, setup_abp_async),
+        cmocka_unit_test_setup(async_downlink_waits_for_sm, setup_abp_async),
+        cmocka_unit_test_setup(downlink_with_bad_mic_is_dropped, setup_abp_async),
+        cmocka_unit_test_setup(retransmission_survives_foreign_downlink, setup_abp_async),
+#endif
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
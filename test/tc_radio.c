@@ -0,0 +1,113 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+
+#include "cmocka.h"
+
+#include "ldl_radio.h"
+
+#include <string.h>
+
+/* the datasheet formula evaluated directly in microseconds */
+static uint32_t reference_airtime_us(enum ldl_signal_bandwidth bw, enum ldl_spreading_factor sf, uint8_t size, bool crc)
+{
+    bool lowDataRateOptimize = ((bw == LDL_BW_125) && ((sf == LDL_SF_11) || (sf == LDL_SF_12))) ? true : false;
+    uint32_t Ts = ((1UL << sf) * 1000000UL) / LDL_Radio_bwToNumber(bw);
+    uint32_t Tpreamble = (Ts * 12UL) +  (Ts / 4UL);
+    int32_t numerator = (8L * size) - (4L * sf) + 28L + (crc ? 16L : 0L) - 20L;
+    uint32_t denom = 4UL * (sf - (lowDataRateOptimize ? 2UL : 0UL));
+    uint32_t blocks = (numerator > 0) ? (((uint32_t)numerator / denom) + ((((uint32_t)numerator % denom) != 0U) ? 1UL : 0UL)) : 0UL;
+    uint32_t Npayload = 8UL + (blocks * ((uint32_t)LDL_CR_5 + 4UL));
+
+    return Tpreamble + (Npayload * Ts);
+}
+
+/* tests */
+
+static void airtime_shall_match_reference(void **user)
+{
+    enum ldl_spreading_factor sf;
+    enum ldl_signal_bandwidth bw;
+    uint32_t size;
+
+    (void)user;
+
+    for(bw=LDL_BW_125; bw <= LDL_BW_500; bw++){
+
+        for(sf=LDL_SF_7; sf <= LDL_SF_12; sf++){
+
+            for(size=0U; size <= UINT8_MAX; size++){
+
+                assert_int_equal((reference_airtime_us(bw, sf, (uint8_t)size, true) / 1000UL) + 1UL, LDL_Radio_getAirTime(bw, sf, (uint8_t)size, true));
+                assert_int_equal((reference_airtime_us(bw, sf, (uint8_t)size, false) / 1000UL) + 1UL, LDL_Radio_getAirTime(bw, sf, (uint8_t)size, false));
+            }
+        }
+    }
+}
+
+static void airtime_shall_include_minimum_payload_symbols(void **user)
+{
+    (void)user;
+
+    /* 12.25 + 8 symbols of 1.024ms */
+    assert_int_equal(20736UL / 1000UL + 1UL, LDL_Radio_getAirTime(LDL_BW_125, LDL_SF_7, 0U, false));
+}
+
+static void airtime_ticks_shall_match_reference(void **user)
+{
+    static const uint32_t tps[] = {256UL, 1000UL, 1024UL, 15625UL, 32768UL, 1000000UL, 8000000UL};
+    enum ldl_spreading_factor sf;
+    enum ldl_signal_bandwidth bw;
+    uint32_t size;
+    uint64_t us;
+    size_t i;
+
+    (void)user;
+
+    for(i=0U; i < (sizeof(tps)/sizeof(*tps)); i++){
+
+        for(bw=LDL_BW_125; bw <= LDL_BW_500; bw++){
+
+            for(sf=LDL_SF_7; sf <= LDL_SF_12; sf++){
+
+                for(size=0U; size <= UINT8_MAX; size++){
+
+                    us = reference_airtime_us(bw, sf, (uint8_t)size, true);
+
+                    assert_int_equal(((us * tps[i]) + 999999U) / 1000000U, LDL_Radio_getAirTimeTicks(bw, sf, (uint8_t)size, true, tps[i]));
+
+                    us = reference_airtime_us(bw, sf, (uint8_t)size, false);
+
+                    assert_int_equal(((us * tps[i]) + 999999U) / 1000000U, LDL_Radio_getAirTimeTicks(bw, sf, (uint8_t)size, false, tps[i]));
+                }
+            }
+        }
+    }
+}
+
+static void airtime_ticks_shall_match_reference_for_any_tps(void **user)
+{
+    uint32_t tps;
+    uint64_t us;
+
+    (void)user;
+
+    us = reference_airtime_us(LDL_BW_125, LDL_SF_12, UINT8_MAX, true);
+
+    for(tps=1000UL; tps <= 1000000UL; tps++){
+
+        assert_int_equal(((us * tps) + 999999U) / 1000000U, LDL_Radio_getAirTimeTicks(LDL_BW_125, LDL_SF_12, UINT8_MAX, true, tps));
+    }
+}
+
+int main(void)
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(airtime_shall_match_reference),
+        cmocka_unit_test(airtime_shall_include_minimum_payload_symbols),
+        cmocka_unit_test(airtime_ticks_shall_match_reference),
+        cmocka_unit_test(airtime_ticks_shall_match_reference_for_any_tps),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
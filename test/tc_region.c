@@ -0,0 +1,368 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+
+#include "cmocka.h"
+
+#include "ldl_region.h"
+#include "ldl_mac.h"
+#include "ldl_mac_internal.h"
+#include "ldl_internal.h"
+#include "ref_ldl_region.h"
+
+#include <string.h>
+
+/* every region in the build is compared with the switch based
+ * implementation in ref_ldl_region.c */
+static const enum ldl_region regions[] = {
+#ifdef LDL_ENABLE_EU_863_870
+    LDL_EU_863_870,
+#endif
+#ifdef LDL_ENABLE_US_902_928
+    LDL_US_902_928,
+#endif
+#ifdef LDL_ENABLE_AU_915_928
+    LDL_AU_915_928,
+#endif
+#ifdef LDL_ENABLE_EU_433
+    LDL_EU_433,
+#endif
+};
+
+/* mocks **************************************************************/
+
+/* LDL_MAC_* calls made by the region are recorded here (the region
+ * passes the mac pointer through without looking at it) */
+struct channel_log {
+
+    struct {
+
+        char op;
+        uint8_t chIndex;
+        uint32_t freq;
+        uint8_t minRate;
+        uint8_t maxRate;
+
+    } call[128U];
+
+    size_t size;
+};
+
+static void log_call(struct ldl_mac *self, char op, uint8_t chIndex, uint32_t freq, uint8_t minRate, uint8_t maxRate)
+{
+    struct channel_log *log = (struct channel_log *)self;
+
+    assert_true(log->size < (sizeof(log->call)/sizeof(*log->call)));
+
+    log->call[log->size].op = op;
+    log->call[log->size].chIndex = chIndex;
+    log->call[log->size].freq = freq;
+    log->call[log->size].minRate = minRate;
+    log->call[log->size].maxRate = maxRate;
+    log->size++;
+}
+
+bool LDL_MAC_addChannel(struct ldl_mac *self, uint8_t chIndex, uint32_t freq, uint8_t minRate, uint8_t maxRate)
+{
+    log_call(self, 'a', chIndex, freq, minRate, maxRate);
+
+    return true;
+}
+
+bool LDL_MAC_maskChannel(struct ldl_mac *self, uint8_t chIndex)
+{
+    log_call(self, 'm', chIndex, 0U, 0U, 0U);
+
+    return true;
+}
+
+bool LDL_MAC_unmaskChannel(struct ldl_mac *self, uint8_t chIndex)
+{
+    log_call(self, 'u', chIndex, 0U, 0U, 0U);
+
+    return true;
+}
+
+static void assert_log_equal(const struct channel_log *expected, const struct channel_log *actual)
+{
+    size_t i;
+
+    assert_int_equal(expected->size, actual->size);
+
+    for(i=0U; i < expected->size; i++){
+
+        assert_int_equal(expected->call[i].op, actual->call[i].op);
+        assert_int_equal(expected->call[i].chIndex, actual->call[i].chIndex);
+        assert_int_equal(expected->call[i].freq, actual->call[i].freq);
+        assert_int_equal(expected->call[i].minRate, actual->call[i].minRate);
+        assert_int_equal(expected->call[i].maxRate, actual->call[i].maxRate);
+    }
+}
+
+/* tests **************************************************************/
+
+static void data_rates_shall_match(void **user)
+{
+    (void)user;
+
+    enum ldl_region region;
+    size_t r;
+    enum ldl_spreading_factor sf[2U];
+    enum ldl_signal_bandwidth bw[2U];
+    uint8_t mtu[2U];
+    uint8_t rate;
+    uint8_t chIndex;
+    uint8_t maxRate;
+    bool dwell;
+
+    for(r=0U; r < (sizeof(regions)/sizeof(*regions)); r++){
+
+        region = regions[r];
+
+        for(rate=0U; rate < 16U; rate++){
+
+            sf[0] = sf[1] = LDL_SF_7;
+            bw[0] = bw[1] = LDL_BW_125;
+            mtu[0] = mtu[1] = 0U;
+
+            REF_Region_convertRate(region, rate, &sf[0], &bw[0], &mtu[0]);
+            LDL_Region_convertRate(region, rate, &sf[1], &bw[1], &mtu[1]);
+
+            assert_int_equal(sf[0], sf[1]);
+            assert_int_equal(bw[0], bw[1]);
+            assert_int_equal(mtu[0], mtu[1]);
+
+            for(dwell=false; ; dwell=true){
+
+                assert_int_equal(REF_Region_applyUplinkDwell(region, dwell, rate), LDL_Region_applyUplinkDwell(region, dwell, rate));
+
+                if(dwell){
+
+                    break;
+                }
+            }
+        }
+
+        for(chIndex=0U; chIndex < 80U; chIndex++){
+
+            for(rate=0U; rate < 16U; rate++){
+
+                for(maxRate=0U; maxRate < 16U; maxRate++){
+
+                    assert_int_equal(REF_Region_validateRate(region, chIndex, rate, maxRate), LDL_Region_validateRate(region, chIndex, rate, maxRate));
+                }
+            }
+        }
+    }
+}
+
+static void rx1_data_rate_offsets_shall_match(void **user)
+{
+    (void)user;
+
+    enum ldl_region region;
+    size_t r;
+    uint8_t rate;
+    uint8_t offset;
+    uint8_t rx1_rate[2U];
+
+    for(r=0U; r < (sizeof(regions)/sizeof(*regions)); r++){
+
+        region = regions[r];
+
+        assert_int_equal(REF_Region_getRX1Offset(region), LDL_Region_getRX1Offset(region));
+
+        for(rate=0U; rate < 16U; rate++){
+
+            for(offset=0U; offset < 8U; offset++){
+
+                rx1_rate[0] = rx1_rate[1] = 0xffU;
+
+                REF_Region_getRX1DataRate(region, rate, offset, &rx1_rate[0]);
+                LDL_Region_getRX1DataRate(region, rate, offset, &rx1_rate[1]);
+
+                assert_int_equal(rx1_rate[0], rx1_rate[1]);
+            }
+        }
+    }
+}
+
+static void bands_shall_match(void **user)
+{
+    (void)user;
+
+    enum ldl_region region;
+    size_t r;
+    uint32_t freq;
+    uint8_t band[2U];
+    uint8_t i;
+
+    for(r=0U; r < (sizeof(regions)/sizeof(*regions)); r++){
+
+        region = regions[r];
+
+        assert_int_equal(REF_Region_getMaxDCycleOffLimit(region), LDL_Region_getMaxDCycleOffLimit(region));
+
+        for(i=0U; i < LDL_BAND_MAX; i++){
+
+            assert_int_equal(REF_Region_getOffTimeFactor(region, i), LDL_Region_getOffTimeFactor(region, i));
+        }
+
+        /* 5KHz steps hit both sides of every band edge */
+        for(freq=U32(400000000); freq <= U32(1000000000); freq += U32(5000)){
+
+            band[0] = band[1] = 0xffU;
+
+            assert_int_equal(REF_Region_getBand(region, freq, &band[0]), LDL_Region_getBand(region, freq, &band[1]));
+            assert_int_equal(band[0], band[1]);
+
+            assert_int_equal(REF_Region_validateFreq(region, freq), LDL_Region_validateFreq(region, freq));
+        }
+    }
+}
+
+static void default_channels_shall_match(void **user)
+{
+    (void)user;
+
+    enum ldl_region region;
+    size_t r;
+    static struct channel_log log[2U];
+    uint8_t cfList[16U];
+    uint32_t freq[2U];
+    uint8_t minRate[2U];
+    uint8_t maxRate[2U];
+    uint16_t chIndex;
+    uint8_t i;
+
+    for(r=0U; r < (sizeof(regions)/sizeof(*regions)); r++){
+
+        region = regions[r];
+
+        assert_int_equal(REF_Region_isDynamic(region), LDL_Region_isDynamic(region));
+        assert_int_equal(REF_Region_numChannels(region), LDL_Region_numChannels(region));
+        assert_int_equal(REF_Region_getRX1Delay(region), LDL_Region_getRX1Delay(region));
+        assert_int_equal(REF_Region_getJA1Delay(region), LDL_Region_getJA1Delay(region));
+        assert_int_equal(REF_Region_getRX2Freq(region), LDL_Region_getRX2Freq(region));
+        assert_int_equal(REF_Region_getRX2Rate(region), LDL_Region_getRX2Rate(region));
+        assert_string_equal(REF_Region_enumToString(region), LDL_Region_enumToString(region));
+        assert_int_equal(REF_Region_txParamSetupImplemented(region), LDL_Region_txParamSetupImplemented(region));
+
+        (void)memset(log, 0, sizeof(log));
+
+        REF_Region_getDefaultChannels(region, (struct ldl_mac *)&log[0]);
+        LDL_Region_getDefaultChannels(region, (struct ldl_mac *)&log[1]);
+
+        assert_log_equal(&log[0], &log[1]);
+
+        for(chIndex=0U; chIndex <= UINT8_MAX; chIndex++){
+
+            freq[0] = freq[1] = 0U;
+            minRate[0] = minRate[1] = 0xffU;
+            maxRate[0] = maxRate[1] = 0xffU;
+
+            assert_int_equal(
+                REF_Region_getChannel(region, U8(chIndex), &freq[0], &minRate[0], &maxRate[0]),
+                LDL_Region_getChannel(region, U8(chIndex), &freq[1], &minRate[1], &maxRate[1])
+            );
+
+            assert_int_equal(freq[0], freq[1]);
+            assert_int_equal(minRate[0], minRate[1]);
+            assert_int_equal(maxRate[0], maxRate[1]);
+
+            if(chIndex < U16(LDL_Region_numChannels(region))){
+
+                freq[0] = freq[1] = 0U;
+
+                REF_Region_getRX1Freq(region, U32(868100000), U8(chIndex), &freq[0]);
+                LDL_Region_getRX1Freq(region, U32(868100000), U8(chIndex), &freq[1]);
+
+                assert_int_equal(freq[0], freq[1]);
+            }
+        }
+
+        /* a frequency list and a mask list */
+        for(i=0U; i < 2U; i++){
+
+            (void)memset(cfList, 0, sizeof(cfList));
+
+            cfList[0] = 0x18U;
+            cfList[1] = 0x4fU;
+            cfList[2] = 0x84U;
+            cfList[3] = 0xe8U;
+            cfList[4] = 0x56U;
+            cfList[5] = 0x84U;
+            cfList[6] = 0x55U;
+            cfList[7] = 0xaaU;
+            cfList[15] = i;
+
+            (void)memset(log, 0, sizeof(log));
+
+            REF_Region_processCFList(region, (struct ldl_mac *)&log[0], cfList, sizeof(cfList));
+            LDL_Region_processCFList(region, (struct ldl_mac *)&log[1], cfList, sizeof(cfList));
+
+            assert_log_equal(&log[0], &log[1]);
+        }
+    }
+}
+
+static void tx_power_shall_match(void **user)
+{
+    (void)user;
+
+    enum ldl_region region;
+    size_t r;
+    uint8_t power;
+
+    for(r=0U; r < (sizeof(regions)/sizeof(*regions)); r++){
+
+        region = regions[r];
+
+        for(power=0U; power < 16U; power++){
+
+            assert_int_equal(REF_Region_validateTXPower(region, power), LDL_Region_validateTXPower(region, power));
+            assert_int_equal(REF_Region_getTXPower(region, power), LDL_Region_getTXPower(region, power));
+        }
+    }
+}
+
+static void join_plan_shall_match(void **user)
+{
+    (void)user;
+
+    enum ldl_region region;
+    size_t r;
+    uint32_t trial;
+    uint32_t random;
+
+    for(r=0U; r < (sizeof(regions)/sizeof(*regions)); r++){
+
+        region = regions[r];
+
+        for(trial=0U; trial < 256U; trial++){
+
+            assert_int_equal(REF_Region_getJoinRate(region, trial), LDL_Region_getJoinRate(region, trial));
+
+            for(random=0U; random < 256U; random += 7U){
+
+                assert_int_equal(REF_Region_getJoinIndex(region, trial, random), LDL_Region_getJoinIndex(region, trial, random));
+            }
+
+            assert_int_equal(REF_Region_getJoinIndex(region, trial, UINT32_MAX), LDL_Region_getJoinIndex(region, trial, UINT32_MAX));
+        }
+    }
+}
+
+int main(void)
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(data_rates_shall_match),
+        cmocka_unit_test(rx1_data_rate_offsets_shall_match),
+        cmocka_unit_test(bands_shall_match),
+        cmocka_unit_test(default_channels_shall_match),
+        cmocka_unit_test(tx_power_shall_match),
+        cmocka_unit_test(join_plan_shall_match),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
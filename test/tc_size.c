@@ -0,0 +1,85 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+
+#include "cmocka.h"
+
+#include "ldl_mac.h"
+
+#include <string.h>
+#include <stdio.h>
+
+/* reports the size of MAC state and fails if it grows
+ *
+ * budgets are for the configuration this target is built with and
+ * should only be raised on purpose */
+
+/* state before ldl_mac.ctx (used on every LDL_MAC_process()) */
+#define HOT_BUDGET 208U
+
+/* saved and restored by the application */
+#define SESSION_BUDGET 128U
+
+/* function and object pointers plus tps, a, b, advance and EUIs */
+#define CONFIG_BUDGET ((9U * sizeof(void *)) + 32U)
+
+/* mask of changed session fields (padded to pointer alignment) */
+#define CHANGED_BUDGET 8U
+
+/* all of the above plus the frame buffer */
+#define MAC_BUDGET (HOT_BUDGET + SESSION_BUDGET + CHANGED_BUDGET + CONFIG_BUDGET + LDL_MAX_PACKET + 1U)
+
+static void report(const char *name, size_t size, size_t budget)
+{
+    printf("%s: %u bytes (budget %u)\n", name, (unsigned)size, (unsigned)budget);
+}
+
+/* tests */
+
+static void hot_state_shall_not_grow(void **user)
+{
+    (void)user;
+
+    report("ldl_mac (hot)", offsetof(struct ldl_mac, ctx), HOT_BUDGET);
+
+    assert_true(offsetof(struct ldl_mac, ctx) <= HOT_BUDGET);
+}
+
+static void session_shall_not_grow(void **user)
+{
+    (void)user;
+
+    report("ldl_mac_session", sizeof(struct ldl_mac_session), SESSION_BUDGET);
+
+    assert_true(sizeof(struct ldl_mac_session) <= SESSION_BUDGET);
+}
+
+static void config_shall_not_grow(void **user)
+{
+    (void)user;
+
+    report("ldl_mac_config", sizeof(struct ldl_mac_config), CONFIG_BUDGET);
+
+    assert_true(sizeof(struct ldl_mac_config) <= CONFIG_BUDGET);
+}
+
+static void mac_shall_not_grow(void **user)
+{
+    (void)user;
+
+    report("ldl_mac", sizeof(struct ldl_mac), MAC_BUDGET);
+
+    assert_true(sizeof(struct ldl_mac) <= MAC_BUDGET);
+}
+
+int main(void)
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(hot_state_shall_not_grow),
+        cmocka_unit_test(session_shall_not_grow),
+        cmocka_unit_test(config_shall_not_grow),
+        cmocka_unit_test(mac_shall_not_grow),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
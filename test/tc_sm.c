@@ -0,0 +1,370 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+
+#include "cmocka.h"
+
+#include "ldl_sm.h"
+#include "ldl_aes.h"
+#include "ldl_cmac.h"
+#include "ldl_ctr.h"
+#include "cycles.h"
+
+#include <string.h>
+#include <stdio.h>
+
+#define BENCH_ITERATIONS 1000U
+
+static const uint8_t key[] = {0x2b,0x7e,0x15,0x16,0x28,0xae,0xd2,0xa6,0xab,0xf7,0x15,0x88,0x09,0xcf,0x4f,0x3c};
+static const uint8_t iv[] = {0x01,0x02,0x03,0x04,0x05,0x06,0x07,0x08,0x09,0x0a,0x0b,0x0c,0x0d,0x0e,0x0f,0x10};
+static const uint8_t hdr[] = {0x49,0x00,0x00,0x00,0x00,0x00,0x01,0x02,0x03,0x04,0x00,0x00,0x00,0x00,0x00,0x20};
+static const uint8_t msg[] = "an uplink frame of about the usual size";
+
+static void init_sm(struct ldl_sm *sm)
+{
+#if defined(LDL_ENABLE_L2_1_1)
+    LDL_SM_init(sm, key, key);
+#else
+    LDL_SM_init(sm, key);
+#endif
+}
+
+/* MIC computed the way LDL_SM_mic() did before keys were cached */
+static uint32_t reference_mic(const uint8_t *k, const void *h, uint8_t hLen, const void *data, uint8_t dataLen)
+{
+    struct ldl_aes_ctx aes_ctx;
+    struct ldl_cmac_ctx ctx;
+    uint8_t mic[4];
+
+    LDL_AES_init(&aes_ctx, k);
+    LDL_CMAC_init(&ctx, &aes_ctx);
+    LDL_CMAC_update(&ctx, h, hLen);
+    LDL_CMAC_update(&ctx, data, dataLen);
+    LDL_CMAC_finish(&ctx, mic, sizeof(mic));
+
+    return ((uint32_t)mic[3] << 24) | ((uint32_t)mic[2] << 16) | ((uint32_t)mic[1] << 8) | (uint32_t)mic[0];
+}
+
+static void derive(uint8_t *out, const uint8_t *root, const uint8_t *block)
+{
+    struct ldl_aes_ctx aes_ctx;
+
+    (void)memcpy(out, block, 16U);
+    LDL_AES_init(&aes_ctx, root);
+    LDL_AES_encrypt(&aes_ctx, out);
+}
+
+static void mic_is_unchanged_by_repeat(void **user)
+{
+    (void)user;
+
+    struct ldl_sm sm;
+    uint32_t expected;
+
+    init_sm(&sm);
+
+    expected = reference_mic(key, hdr, sizeof(hdr), msg, sizeof(msg));
+
+    assert_int_equal(expected, LDL_SM_mic(&sm, LDL_SM_KEY_NWK, hdr, sizeof(hdr), msg, sizeof(msg)));
+    assert_int_equal(expected, LDL_SM_mic(&sm, LDL_SM_KEY_NWK, hdr, sizeof(hdr), msg, sizeof(msg)));
+}
+
+static void ecb_and_ctr_match_reference(void **user)
+{
+    (void)user;
+
+    struct ldl_sm sm;
+    struct ldl_aes_ctx aes_ctx;
+    uint8_t expected[sizeof(msg)];
+    uint8_t out[sizeof(msg)];
+    int i;
+
+    init_sm(&sm);
+    LDL_AES_init(&aes_ctx, key);
+
+    for(i=0; i < 2; i++){
+
+        (void)memcpy(expected, iv, 16U);
+        LDL_AES_encrypt(&aes_ctx, expected);
+        (void)memcpy(out, iv, 16U);
+        LDL_SM_ecb(&sm, LDL_SM_KEY_NWK, out);
+        assert_memory_equal(expected, out, 16U);
+
+        LDL_CTR_encrypt(&aes_ctx, iv, msg, expected, sizeof(msg));
+        (void)memcpy(out, msg, sizeof(msg));
+        LDL_SM_ctr(&sm, LDL_SM_KEY_NWK, iv, out, sizeof(out));
+        assert_memory_equal(expected, out, sizeof(msg));
+    }
+}
+
+static void session_key_update_replaces_schedule(void **user)
+{
+    (void)user;
+
+    struct ldl_sm sm;
+    uint8_t apps[16U];
+    uint8_t next_iv[16U];
+    uint32_t before;
+
+    init_sm(&sm);
+
+    derive(apps, key, iv);
+
+    LDL_SM_updateSessionKey(&sm, LDL_SM_KEY_APPS, LDL_SM_KEY_APP, iv);
+
+    before = LDL_SM_mic(&sm, LDL_SM_KEY_APPS, hdr, sizeof(hdr), msg, sizeof(msg));
+    assert_int_equal(reference_mic(apps, hdr, sizeof(hdr), msg, sizeof(msg)), before);
+
+    /* derive a different key into the same slot */
+    (void)memcpy(next_iv, iv, sizeof(next_iv));
+    next_iv[0] ^= 0xffU;
+    derive(apps, key, next_iv);
+
+    LDL_SM_updateSessionKey(&sm, LDL_SM_KEY_APPS, LDL_SM_KEY_APP, next_iv);
+
+    assert_int_equal(reference_mic(apps, hdr, sizeof(hdr), msg, sizeof(msg)), LDL_SM_mic(&sm, LDL_SM_KEY_APPS, hdr, sizeof(hdr), msg, sizeof(msg)));
+    assert_int_not_equal(before, LDL_SM_mic(&sm, LDL_SM_KEY_APPS, hdr, sizeof(hdr), msg, sizeof(msg)));
+}
+
+static void batch_update_matches_individual_updates(void **user)
+{
+    (void)user;
+
+    struct ldl_sm batch, single;
+    uint8_t blocks[4U][16U];
+    uint8_t expected[16U];
+    struct ldl_sm_derivation keys[4U];
+    const enum ldl_sm_key desc[] = {LDL_SM_KEY_FNWKSINT, LDL_SM_KEY_SNWKSINT, LDL_SM_KEY_NWKSENC, LDL_SM_KEY_APPS};
+    size_t i;
+
+    init_sm(&batch);
+    init_sm(&single);
+
+    for(i=0U; i < 4U; i++){
+
+        (void)memcpy(blocks[i], iv, sizeof(blocks[i]));
+        blocks[i][0] = (uint8_t)(i + 1U);
+
+        keys[i].desc = desc[i];
+        keys[i].iv = blocks[i];
+
+        LDL_SM_updateSessionKey(&single, desc[i], LDL_SM_KEY_NWK, blocks[i]);
+    }
+
+    LDL_SM_updateSessionKeys(&batch, LDL_SM_KEY_NWK, keys, 4U);
+
+    /* 1.0.x network keys share a slot so only compare against the individual updates */
+    for(i=0U; i < 4U; i++){
+
+        assert_int_equal(LDL_SM_mic(&single, desc[i], hdr, sizeof(hdr), msg, sizeof(msg)), LDL_SM_mic(&batch, desc[i], hdr, sizeof(hdr), msg, sizeof(msg)));
+    }
+
+    derive(expected, key, blocks[3]);
+
+    assert_int_equal(reference_mic(expected, hdr, sizeof(hdr), msg, sizeof(msg)), LDL_SM_mic(&batch, LDL_SM_KEY_APPS, hdr, sizeof(hdr), msg, sizeof(msg)));
+}
+
+static void mic_decrypt_matches_mic_then_ctr(void **user)
+{
+    (void)user;
+
+    struct ldl_sm sm;
+    uint8_t expected[sizeof(msg)];
+    uint8_t out[sizeof(msg)];
+    uint32_t mic;
+    const struct ldl_sm_range range[] = {
+        {.desc = LDL_SM_KEY_NWKSENC, .iv = iv, .offset = 3U, .len = 5U},
+        {.desc = LDL_SM_KEY_APPS, .iv = hdr, .offset = 9U, .len = sizeof(msg) - 9U}
+    };
+
+    init_sm(&sm);
+
+    LDL_SM_updateSessionKey(&sm, LDL_SM_KEY_NWKSENC, LDL_SM_KEY_NWK, iv);
+    LDL_SM_updateSessionKey(&sm, LDL_SM_KEY_APPS, LDL_SM_KEY_APP, hdr);
+
+    mic = LDL_SM_mic(&sm, LDL_SM_KEY_NWK, hdr, sizeof(hdr), msg, sizeof(msg));
+
+    (void)memcpy(expected, msg, sizeof(msg));
+    LDL_SM_ctr(&sm, range[0].desc, range[0].iv, &expected[range[0].offset], range[0].len);
+    LDL_SM_ctr(&sm, range[1].desc, range[1].iv, &expected[range[1].offset], range[1].len);
+
+    (void)memcpy(out, msg, sizeof(msg));
+    assert_true(LDL_SM_micDecrypt(&sm, LDL_SM_KEY_NWK, hdr, sizeof(hdr), out, sizeof(out), mic, range, 2U));
+    assert_memory_equal(expected, out, sizeof(out));
+
+    /* no ranges is the same as LDL_SM_mic() */
+    (void)memcpy(out, msg, sizeof(msg));
+    assert_true(LDL_SM_micDecrypt(&sm, LDL_SM_KEY_NWK, hdr, sizeof(hdr), out, sizeof(out), mic, NULL, 0U));
+    assert_memory_equal(msg, out, sizeof(out));
+}
+
+static void mic_decrypt_shall_switch_keys_between_ranges(void **user)
+{
+    (void)user;
+
+    struct ldl_sm sm;
+    uint8_t expected[sizeof(msg)];
+    uint8_t out[sizeof(msg)];
+    uint32_t mic;
+    size_t i;
+    /* same key as the MIC, then a change of key, then the same key again */
+    const struct ldl_sm_range range[] = {
+        {.desc = LDL_SM_KEY_NWK, .iv = iv, .offset = 0U, .len = 2U},
+        {.desc = LDL_SM_KEY_APPS, .iv = hdr, .offset = 2U, .len = 3U},
+        {.desc = LDL_SM_KEY_APPS, .iv = iv, .offset = 6U, .len = sizeof(msg) - 6U}
+    };
+
+    init_sm(&sm);
+
+    LDL_SM_updateSessionKey(&sm, LDL_SM_KEY_APPS, LDL_SM_KEY_APP, hdr);
+
+    mic = LDL_SM_mic(&sm, LDL_SM_KEY_NWK, hdr, sizeof(hdr), msg, sizeof(msg));
+
+    (void)memcpy(expected, msg, sizeof(msg));
+
+    for(i=0U; i < (sizeof(range)/sizeof(*range)); i++){
+
+        LDL_SM_ctr(&sm, range[i].desc, range[i].iv, &expected[range[i].offset], range[i].len);
+    }
+
+    (void)memcpy(out, msg, sizeof(msg));
+    assert_true(LDL_SM_micDecrypt(&sm, LDL_SM_KEY_NWK, hdr, sizeof(hdr), out, sizeof(out), mic, range, 3U));
+    assert_memory_equal(expected, out, sizeof(out));
+}
+
+static void mic_decrypt_failure_leaves_data(void **user)
+{
+    (void)user;
+
+    struct ldl_sm sm;
+    uint8_t out[sizeof(msg)];
+    uint32_t mic;
+    const struct ldl_sm_range range[] = {
+        {.desc = LDL_SM_KEY_APPS, .iv = iv, .offset = 0U, .len = sizeof(msg)}
+    };
+
+    init_sm(&sm);
+
+    mic = LDL_SM_mic(&sm, LDL_SM_KEY_NWK, hdr, sizeof(hdr), msg, sizeof(msg));
+
+    (void)memcpy(out, msg, sizeof(msg));
+    assert_false(LDL_SM_micDecrypt(&sm, LDL_SM_KEY_NWK, hdr, sizeof(hdr), out, sizeof(out), mic ^ 1U, range, 1U));
+    assert_memory_equal(msg, out, sizeof(out));
+}
+
+/* not a pass/fail test, prints cycles per operation for the SM
+ * entry points next to the same operation with a key expansion */
+static void cycles_per_operation(void **user)
+{
+    (void)user;
+
+    struct ldl_sm sm;
+    struct ldl_aes_ctx aes_ctx;
+    uint8_t buf[sizeof(msg)];
+    uint64_t start;
+    uint64_t sm_mic, ref_mic, sm_ctr, ref_ctr, sm_fused, sm_split, sm_batch, sm_single;
+    uint32_t mic;
+    const struct ldl_sm_range range = {.desc = LDL_SM_KEY_APPS, .iv = iv, .offset = 0U, .len = sizeof(msg)};
+    const struct ldl_sm_derivation keys[] = {
+        {.desc = LDL_SM_KEY_FNWKSINT, .iv = iv},
+        {.desc = LDL_SM_KEY_SNWKSINT, .iv = iv},
+        {.desc = LDL_SM_KEY_NWKSENC, .iv = iv},
+        {.desc = LDL_SM_KEY_APPS, .iv = iv}
+    };
+    volatile uint32_t sink = 0U;
+    unsigned i;
+
+    init_sm(&sm);
+
+    /* warm up */
+    sink += LDL_SM_mic(&sm, LDL_SM_KEY_NWK, hdr, sizeof(hdr), msg, sizeof(msg));
+    sink += reference_mic(key, hdr, sizeof(hdr), msg, sizeof(msg));
+
+    start = cycles_now();
+    for(i=0U; i < BENCH_ITERATIONS; i++){
+        sink += LDL_SM_mic(&sm, LDL_SM_KEY_NWK, hdr, sizeof(hdr), msg, sizeof(msg));
+    }
+    sm_mic = (cycles_now() - start) / BENCH_ITERATIONS;
+
+    start = cycles_now();
+    for(i=0U; i < BENCH_ITERATIONS; i++){
+        sink += reference_mic(key, hdr, sizeof(hdr), msg, sizeof(msg));
+    }
+    ref_mic = (cycles_now() - start) / BENCH_ITERATIONS;
+
+    start = cycles_now();
+    for(i=0U; i < BENCH_ITERATIONS; i++){
+        (void)memcpy(buf, msg, sizeof(buf));
+        LDL_SM_ctr(&sm, LDL_SM_KEY_NWK, iv, buf, sizeof(buf));
+    }
+    sm_ctr = (cycles_now() - start) / BENCH_ITERATIONS;
+
+    start = cycles_now();
+    for(i=0U; i < BENCH_ITERATIONS; i++){
+        (void)memcpy(buf, msg, sizeof(buf));
+        LDL_AES_init(&aes_ctx, key);
+        LDL_CTR_encrypt(&aes_ctx, iv, buf, buf, sizeof(buf));
+    }
+    ref_ctr = (cycles_now() - start) / BENCH_ITERATIONS;
+
+    mic = LDL_SM_mic(&sm, LDL_SM_KEY_NWK, hdr, sizeof(hdr), msg, sizeof(msg));
+
+    start = cycles_now();
+    for(i=0U; i < BENCH_ITERATIONS; i++){
+        (void)memcpy(buf, msg, sizeof(buf));
+        sink += LDL_SM_micDecrypt(&sm, LDL_SM_KEY_NWK, hdr, sizeof(hdr), buf, sizeof(buf), mic, &range, 1U) ? 1U : 0U;
+    }
+    sm_fused = (cycles_now() - start) / BENCH_ITERATIONS;
+
+    start = cycles_now();
+    for(i=0U; i < BENCH_ITERATIONS; i++){
+        (void)memcpy(buf, msg, sizeof(buf));
+        if(LDL_SM_mic(&sm, LDL_SM_KEY_NWK, hdr, sizeof(hdr), buf, sizeof(buf)) == mic){
+            LDL_SM_ctr(&sm, LDL_SM_KEY_APPS, iv, buf, sizeof(buf));
+        }
+    }
+    sm_split = (cycles_now() - start) / BENCH_ITERATIONS;
+
+    start = cycles_now();
+    for(i=0U; i < BENCH_ITERATIONS; i++){
+        LDL_SM_updateSessionKeys(&sm, LDL_SM_KEY_NWK, keys, 4U);
+    }
+    sm_batch = (cycles_now() - start) / BENCH_ITERATIONS;
+
+    start = cycles_now();
+    for(i=0U; i < BENCH_ITERATIONS; i++){
+        unsigned j;
+        for(j=0U; j < 4U; j++){
+            LDL_SM_updateSessionKey(&sm, keys[j].desc, LDL_SM_KEY_NWK, keys[j].iv);
+        }
+    }
+    sm_single = (cycles_now() - start) / BENCH_ITERATIONS;
+
+    (void)sink;
+
+#ifdef LDL_ENABLE_SM_KEY_CACHE
+    printf("key cache enabled\n");
+#else
+    printf("key cache disabled\n");
+#endif
+    printf("LDL_SM_mic: %llu cycles/op (expand every call: %llu)\n", (unsigned long long)sm_mic, (unsigned long long)ref_mic);
+    printf("LDL_SM_ctr: %llu cycles/op (expand every call: %llu)\n", (unsigned long long)sm_ctr, (unsigned long long)ref_ctr);
+    printf("LDL_SM_micDecrypt: %llu cycles/op (LDL_SM_mic then LDL_SM_ctr: %llu)\n", (unsigned long long)sm_fused, (unsigned long long)sm_split);
+    printf("LDL_SM_updateSessionKeys(4): %llu cycles/op (LDL_SM_updateSessionKey x4: %llu)\n", (unsigned long long)sm_batch, (unsigned long long)sm_single);
+}
+
+int main(void)
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(mic_is_unchanged_by_repeat),
+        cmocka_unit_test(ecb_and_ctr_match_reference),
+        cmocka_unit_test(session_key_update_replaces_schedule),
+        cmocka_unit_test(batch_update_matches_individual_updates),
+        cmocka_unit_test(mic_decrypt_matches_mic_then_ctr),
+        cmocka_unit_test(mic_decrypt_shall_switch_keys_between_ranges),
+        cmocka_unit_test(mic_decrypt_failure_leaves_data),
+        cmocka_unit_test(cycles_per_operation)
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
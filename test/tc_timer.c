@@ -11,6 +11,16 @@
 #include <stdlib.h>
 #include <time.h>
 
+#ifdef LDL_ENABLE_ATOMIC_TIMERS
+#include <pthread.h>
+
+#ifdef LDL_ENABLE_ATOMIC_TIMERS
+#include <stdatomic.h>
+#endif
+
+#define STRESS_ITERATIONS 100000U
+#endif
+
 extern uint32_t system_time;
 
 /* setups */
@@ -21,8 +31,8 @@ static int setup(void **user)
     (void)memset(&state, 0, sizeof(state));
     *user = (void *)&state;
 
-    state.tps = 1000000UL;
-    state.ticks = LDL_System_ticks;
+    state.config.tps = 1000000UL;
+    state.config.ticks = LDL_System_ticks;
 
     return 0;
 }
@@ -36,7 +46,7 @@ static void timerCheck_shall_return_false_for_unset_timer(void **user)
     struct ldl_mac *self = (struct ldl_mac *)(*user);
     uint32_t error;
 
-    assert_false( LDL_MAC_timerCheck(self, LDL_TIMER_WAITA, &error) );
+    assert_false( LDL_MAC_timerCheck(self, LDL_TIMER_WAITA, system_time, &error) );
 }
 
 static void timerCheck_shall_return_true_for_immediate(void **user)
@@ -44,9 +54,9 @@ static void timerCheck_shall_return_true_for_immediate(void **user)
     struct ldl_mac *self = (struct ldl_mac *)(*user);
     uint32_t error;
 
-    LDL_MAC_timerSet(self, LDL_TIMER_WAITA, 0U);
+    LDL_MAC_timerSet(self, LDL_TIMER_WAITA, system_time, 0U);
 
-    assert_true( LDL_MAC_timerCheck(self, LDL_TIMER_WAITA, &error) );
+    assert_true( LDL_MAC_timerCheck(self, LDL_TIMER_WAITA, system_time, &error) );
     assert_int_equal(0, error);
 }
 
@@ -55,12 +65,12 @@ static void timerCheck_shall_return_true_only_first_time_only(void **user)
     struct ldl_mac *self = (struct ldl_mac *)(*user);
     uint32_t error;
 
-    LDL_MAC_timerSet(self, LDL_TIMER_WAITA, 0U);
+    LDL_MAC_timerSet(self, LDL_TIMER_WAITA, system_time, 0U);
 
-    assert_true( LDL_MAC_timerCheck(self, LDL_TIMER_WAITA, &error) );
+    assert_true( LDL_MAC_timerCheck(self, LDL_TIMER_WAITA, system_time, &error) );
     assert_int_equal(0, error);
 
-    assert_false( LDL_MAC_timerCheck(self, LDL_TIMER_WAITA, &error) );
+    assert_false( LDL_MAC_timerCheck(self, LDL_TIMER_WAITA, system_time, &error) );
 }
 
 static void timerCheck_shall_return_false_for_future(void **user)
@@ -68,9 +78,9 @@ static void timerCheck_shall_return_false_for_future(void **user)
     struct ldl_mac *self = (struct ldl_mac *)(*user);
     uint32_t error;
 
-    LDL_MAC_timerSet(self, LDL_TIMER_WAITA, 1U);
+    LDL_MAC_timerSet(self, LDL_TIMER_WAITA, system_time, 1U);
 
-    assert_false( LDL_MAC_timerCheck(self, LDL_TIMER_WAITA, &error) );
+    assert_false( LDL_MAC_timerCheck(self, LDL_TIMER_WAITA, system_time, &error) );
 }
 
 static void timerCheck_shall_return_true_after_time_moves_forward(void **user)
@@ -78,13 +88,13 @@ static void timerCheck_shall_return_true_after_time_moves_forward(void **user)
     struct ldl_mac *self = (struct ldl_mac *)(*user);
     uint32_t error;
 
-    LDL_MAC_timerSet(self, LDL_TIMER_WAITA, 1U);
+    LDL_MAC_timerSet(self, LDL_TIMER_WAITA, system_time, 1U);
 
-    assert_false( LDL_MAC_timerCheck(self, LDL_TIMER_WAITA, &error) );
+    assert_false( LDL_MAC_timerCheck(self, LDL_TIMER_WAITA, system_time, &error) );
 
     system_time++;
 
-    assert_true( LDL_MAC_timerCheck(self, LDL_TIMER_WAITA, &error) );
+    assert_true( LDL_MAC_timerCheck(self, LDL_TIMER_WAITA, system_time, &error) );
     assert_int_equal(0, error);
 }
 
@@ -93,13 +103,13 @@ static void timerCheck_shall_return_true_and_error_after_time_moves_forward(void
     struct ldl_mac *self = (struct ldl_mac *)(*user);
     uint32_t error;
 
-    LDL_MAC_timerSet(self, LDL_TIMER_WAITA, 1U);
+    LDL_MAC_timerSet(self, LDL_TIMER_WAITA, system_time, 1U);
 
     system_time++;
     system_time++;
     system_time++;
 
-    assert_true( LDL_MAC_timerCheck(self, LDL_TIMER_WAITA, &error) );
+    assert_true( LDL_MAC_timerCheck(self, LDL_TIMER_WAITA, system_time, &error) );
     assert_int_equal(2, error);
 }
 
@@ -118,7 +128,7 @@ static void timerTicksUntil_shall_return_zero_for_immediate(void **user)
     struct ldl_mac *self = (struct ldl_mac *)(*user);
     uint32_t error;
 
-    LDL_MAC_timerSet(self, LDL_TIMER_WAITA, 0);
+    LDL_MAC_timerSet(self, LDL_TIMER_WAITA, system_time, 0);
 
     assert_int_equal( 0, LDL_MAC_timerTicksUntil(self, LDL_TIMER_WAITA, &error) );
 }
@@ -128,7 +138,7 @@ static void timerTicksUntil_shall_return_zero_for_past(void **user)
     struct ldl_mac *self = (struct ldl_mac *)(*user);
     uint32_t error;
 
-    LDL_MAC_timerSet(self, LDL_TIMER_WAITA, 0);
+    LDL_MAC_timerSet(self, LDL_TIMER_WAITA, system_time, 0);
 
     system_time++;
 
@@ -140,7 +150,7 @@ static void timerTicksUntil_shall_return_positive_for_future(void **user)
     struct ldl_mac *self = (struct ldl_mac *)(*user);
     uint32_t error;
 
-    LDL_MAC_timerSet(self, LDL_TIMER_WAITA, 42);
+    LDL_MAC_timerSet(self, LDL_TIMER_WAITA, system_time, 42);
 
     assert_int_equal( 42, LDL_MAC_timerTicksUntil(self, LDL_TIMER_WAITA, &error) );
 }
@@ -158,11 +168,75 @@ static void timerTicksUntilNext_shall_return_positive_for_future(void **user)
 {
     struct ldl_mac *self = (struct ldl_mac *)(*user);
 
-    LDL_MAC_timerSet(self, LDL_TIMER_WAITA, 42);
+    LDL_MAC_timerSet(self, LDL_TIMER_WAITA, system_time, 42);
 
     assert_int_equal( 42, LDL_MAC_timerTicksUntilNext(self) );
 }
 
+#ifdef LDL_ENABLE_ATOMIC_TIMERS
+/* stress ******************************************************************/
+
+struct stress_reader {
+
+    const struct ldl_mac *self;
+    atomic_bool stop;
+    unsigned long reads;
+    unsigned long torn;
+};
+
+/* stands in for an ISR calling LDL_MAC_ticksUntilNextEvent() */
+static void *stress_reader_thread(void *arg)
+{
+    struct stress_reader *r = (struct stress_reader *)arg;
+    uint32_t ticks;
+
+    while(!atomic_load(&r->stop)){
+
+        ticks = LDL_MAC_timerTicksUntilNext(r->self);
+
+        /* every deadline the writer publishes is 7 mod 1000 and a
+         * cleared timer is published with time zero */
+        if((ticks != UINT32_MAX) && ((ticks % 1000U) != 7U)){
+
+            r->torn++;
+        }
+
+        r->reads++;
+    }
+
+    return NULL;
+}
+
+static void timerTicksUntilNext_shall_not_tear_with_concurrent_reader(void **user)
+{
+    struct ldl_mac *self = (struct ldl_mac *)(*user);
+    struct stress_reader r;
+    pthread_t thread;
+    uint32_t i;
+
+    (void)memset(&r, 0, sizeof(r));
+    r.self = self;
+    atomic_init(&r.stop, false);
+
+    assert_int_equal(0, pthread_create(&thread, NULL, stress_reader_thread, &r));
+
+    for(i=0U; i < STRESS_ITERATIONS; i++){
+
+        LDL_MAC_timerSet(self, LDL_TIMER_WAITA, system_time, ((i % 1000U) * 1000U) + 1007U);
+        LDL_MAC_timerSet(self, LDL_TIMER_WAITB, system_time, ((i % 1000U) * 1000U) + 2007U);
+        LDL_MAC_timerClear(self, LDL_TIMER_WAITA);
+        LDL_MAC_timerClear(self, LDL_TIMER_WAITB);
+    }
+
+    atomic_store(&r.stop, true);
+
+    assert_int_equal(0, pthread_join(thread, NULL));
+
+    assert_true(r.reads > 0U);
+    assert_int_equal(0U, r.torn);
+}
+#endif
+
 /* runner */
 
 int main(void)
@@ -225,7 +299,16 @@ int main(void)
         cmocka_unit_test_setup(
             timerTicksUntilNext_shall_return_positive_for_future,
             setup
-        )
+        ),
+#ifdef LDL_ENABLE_ATOMIC_TIMERS
+
+        /* stress **********************************************************/
+
+        cmocka_unit_test_setup(
+            timerTicksUntilNext_shall_not_tear_with_concurrent_reader,
+            setup
+        ),
+#endif
     };
 
     return cmocka_run_group_tests(tests, NULL, NULL);